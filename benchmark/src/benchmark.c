@@ -0,0 +1,710 @@
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#include "low_pass_filter.h"
+
+enum errors
+{
+    NO_ERROR,
+    COMMAND_LINE_ARGS_ERROR,
+    OUTPUT_FILE_ERROR,
+    BENCHMARK_ERROR,
+};
+
+// Sample rate of the generated signal, and the cutoff every filter uses.
+#define BENCH_SAMPLE_RATE 48000.0f
+#define BENCH_CUTOFF 5000.0f
+
+// Length of the generated signal. Long enough to be past the caches at every
+// channel count, so blocks are read from memory as they would be from a file.
+#define BENCH_SIGNAL_FRAMES 262144
+
+// The point every sweep varies one setting away from: the command line's
+// defaults.
+#define BENCH_DEFAULT_ORDER 126
+#define BENCH_DEFAULT_CHANNELS 2
+#define BENCH_DEFAULT_BLOCK 512
+#define BENCH_DEFAULT_IIR_ORDER 4
+
+// Most thread counts -t takes, and the files the thread sweep filters through
+// lpf_filter_file, written to the working directory and removed afterwards.
+#define BENCH_MAX_THREAD_COUNTS 16
+#define BENCH_THREAD_INPUT "benchmark_threads_in.wav"
+#define BENCH_THREAD_OUTPUT "benchmark_threads_out.wav"
+
+// -----------------------------------------------------------------------------
+// One way of running the filter: an engine, and for direct form the tap
+// kernel's instruction set and whether channels are deinterleaved.
+// -----------------------------------------------------------------------------
+typedef struct bench_engine
+{
+    const char* name;
+    enum lpf_engine engine;
+    enum lpf_simd simd;
+    bool planar;
+} bench_engine_t;
+
+// -----------------------------------------------------------------------------
+// Settings of one measurement.
+// -----------------------------------------------------------------------------
+typedef struct bench_case
+{
+    const char* sweep;
+    const bench_engine_t* engine;
+    int order;
+    enum window_t window_type;
+    int channels;
+    size_t block_frames;
+} bench_case_t;
+
+static const bench_engine_t engines[] = {
+    {"direct-scalar", LPF_ENGINE_DIRECT, LPF_SIMD_SCALAR, false},
+    {"direct-sse", LPF_ENGINE_DIRECT, LPF_SIMD_SSE, false},
+    {"direct-avx2", LPF_ENGINE_DIRECT, LPF_SIMD_AVX2, false},
+    {"direct-avx512", LPF_ENGINE_DIRECT, LPF_SIMD_AVX512, false},
+    {"direct-neon", LPF_ENGINE_DIRECT, LPF_SIMD_NEON, false},
+    {"planar", LPF_ENGINE_DIRECT, LPF_SIMD_AUTO, true},
+    {"fft", LPF_ENGINE_FFT, LPF_SIMD_AUTO, false},
+    {"iir", LPF_ENGINE_IIR, LPF_SIMD_AUTO, false},
+};
+
+static const int fir_orders[] = {16, 32, 64, 126, 256, 512, 1024, 2048};
+static const int iir_orders[] = {2, 4, 8, 16};
+static const int channel_counts[] = {1, 2, 4, 8};
+static const size_t block_sizes[] = {32, 64, 128, 256, 512, 1024, 4096, 16384};
+static const enum window_t window_types[] = {
+    KAISER, BLACKMAN, HAMMING, HANNING, BARTLETT, RECTANGULAR};
+
+// Channel counts of the thread sweep, including ones that do not divide
+// evenly between threads.
+static const int thread_sweep_channels[] = {1, 2, 3, 8, 33};
+
+// Written with the last output of every pass, so none can be elided.
+static volatile float benchmark_sink;
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+void print_usage(const char* prog_name);
+int run_engine(const bench_engine_t* engine,
+               const float* signal,
+               float min_seconds,
+               FILE* results);
+bool run_case(const bench_case_t* bench,
+              const float* signal,
+              float min_seconds,
+              FILE* results);
+float* generate_signal(int channels);
+int get_thread_counts(const char* list, int* thread_counts);
+int run_thread_sweep(const int* thread_counts,
+                     int count,
+                     float min_seconds,
+                     FILE* results);
+bool time_file(int thread_count, float min_seconds, lpf_stats_t* best);
+bool write_signal_file(const char* file_name, int channels);
+bool engine_supported(const bench_engine_t* engine);
+double now_seconds(void);
+const char* window_name(enum window_t window_type);
+
+int main(int argc, const char** argv)
+{
+    if ((argc - 1) % 2)
+    {
+        eprintf("invalid arguments\n\n");
+        print_usage(argv[0]);
+        return COMMAND_LINE_ARGS_ERROR;
+    }
+
+    const char* output_file_name = NULL;
+    const char* only_engine = NULL;
+    int thread_counts[BENCH_MAX_THREAD_COUNTS];
+    int thread_count_count = 0;
+    float min_seconds = 0.25f;
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "-o"))
+        {
+            output_file_name = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "-e"))
+        {
+            only_engine = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "-t"))
+        {
+            thread_count_count = get_thread_counts(argv[i + 1], thread_counts);
+            if (!thread_count_count)
+            {
+                eprintf("thread counts must be a comma separated list of at "
+                        "most %d positive integers.\n",
+                        BENCH_MAX_THREAD_COUNTS);
+                return COMMAND_LINE_ARGS_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-s"))
+        {
+            min_seconds = (float)atof(argv[i + 1]);
+            if (min_seconds <= 0.0f)
+            {
+                eprintf("seconds per case must be positive.\n");
+                return COMMAND_LINE_ARGS_ERROR;
+            }
+        }
+        else
+        {
+            eprintf("unknown command line option %s.\n", argv[i]);
+            print_usage(argv[0]);
+            return COMMAND_LINE_ARGS_ERROR;
+        }
+    }
+
+    FILE* results = output_file_name ? fopen(output_file_name, "w") : stdout;
+    if (!results)
+    {
+        eprintf("unable to open output file %s\n", output_file_name);
+        return OUTPUT_FILE_ERROR;
+    }
+
+    if (thread_count_count)
+    {
+        const int retcode = run_thread_sweep(
+            thread_counts, thread_count_count, min_seconds, results);
+        if (results != stdout)
+            fclose(results);
+        return retcode;
+    }
+
+    // every case reads the channels it needs from the widest signal
+    const int max_channels = channel_counts[COUNT(channel_counts) - 1];
+    float* signal = generate_signal(max_channels);
+    if (!signal)
+    {
+        eprintf("unable to allocate the test signal\n");
+        if (results != stdout)
+            fclose(results);
+        return BENCHMARK_ERROR;
+    }
+
+    fprintf(results,
+            "sweep,engine,order,window,channels,block_frames,frames,"
+            "seconds,samples_per_sec,ns_per_sample\n");
+
+    int retcode = NO_ERROR;
+    for (size_t i = 0; i < COUNT(engines) && retcode == NO_ERROR; ++i)
+    {
+        if (!only_engine || !strcmp(only_engine, engines[i].name))
+            retcode = run_engine(&engines[i], signal, min_seconds, results);
+    }
+
+    free(signal);
+    if (results != stdout)
+        fclose(results);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Prints usage instructions.
+// -----------------------------------------------------------------------------
+void print_usage(const char* prog_name)
+{
+    printf("usage: %s [-o <results_file>] [-e <engine>] ", prog_name);
+    printf("[-s <seconds_per_case>]\n       [-t <thread_counts>]\n\n");
+    printf("Measures how fast each engine filters a synthetic signal held ");
+    printf("in memory, through\nlpf_prepare and lpf_process, so no file ");
+    printf("I/O is timed. From a default of\norder %d, ", BENCH_DEFAULT_ORDER);
+    printf("%d channels, %d frame blocks and a kaiser window, each sweep\n",
+           BENCH_DEFAULT_CHANNELS,
+           BENCH_DEFAULT_BLOCK);
+    printf("varies one of order, channel count, block size and window. ");
+    printf("Results are written\nas CSV to <results_file>, or stdout. ");
+    printf("Each case runs for at least\n<seconds_per_case> seconds, ");
+    printf("0.25 by default. Instruction sets the CPU lacks\nare skipped. ");
+    printf("[-e <engine>] runs only one of direct-scalar, direct-sse,\n");
+    printf("direct-avx2, direct-avx512, direct-neon, planar, fft or iir.\n");
+    printf("The block-auto case lets the filter pick its block size for ");
+    printf("the cache and reports\nthe size it picked. The tests ");
+    printf("program checks each engine's accuracy.\n\n");
+    printf("[-t <thread_counts>], a comma separated list such as 1,2,4,8, ");
+    printf("instead times\nlpf_filter_file on a float WAV file of %d ",
+           BENCH_SIGNAL_FRAMES);
+    printf("frames at each thread count, for\n1, 2, 3, 8 and 33 channels, ");
+    printf("keeping the fastest run of at least\n<seconds_per_case>. The ");
+    printf("speedup and efficiency are against the first count.\n");
+    printf("The files are written to the working directory and removed ");
+    printf("afterwards.\n");
+}
+
+// -----------------------------------------------------------------------------
+// Runs every sweep for one engine. The IIR engine sweeps its own orders and
+// has no window.
+//
+// Returns:
+//     NO_ERROR, or BENCHMARK_ERROR if a filter could not be prepared
+// -----------------------------------------------------------------------------
+int run_engine(const bench_engine_t* engine,
+               const float* signal,
+               float min_seconds,
+               FILE* results)
+{
+    const bool iir = engine->engine == LPF_ENGINE_IIR;
+
+    bench_case_t bench;
+    bench.engine = engine;
+    bench.order = iir ? BENCH_DEFAULT_IIR_ORDER : BENCH_DEFAULT_ORDER;
+    bench.window_type = KAISER;
+    bench.channels = BENCH_DEFAULT_CHANNELS;
+    bench.block_frames = BENCH_DEFAULT_BLOCK;
+
+    // an instruction set this machine lacks is skipped, not failed
+    if (!engine_supported(engine))
+    {
+        eprintf("%s: not supported on this CPU, skipped\n", engine->name);
+        return NO_ERROR;
+    }
+
+    bool ok = true;
+
+    bench.sweep = "order";
+    const int* orders = iir ? iir_orders : fir_orders;
+    const size_t order_count = iir ? COUNT(iir_orders) : COUNT(fir_orders);
+    for (size_t i = 0; i < order_count && ok; ++i)
+    {
+        bench.order = orders[i];
+        ok = run_case(&bench, signal, min_seconds, results);
+    }
+    bench.order = iir ? BENCH_DEFAULT_IIR_ORDER : BENCH_DEFAULT_ORDER;
+
+    bench.sweep = "channels";
+    for (size_t i = 0; i < COUNT(channel_counts) && ok; ++i)
+    {
+        bench.channels = channel_counts[i];
+        ok = run_case(&bench, signal, min_seconds, results);
+    }
+    bench.channels = BENCH_DEFAULT_CHANNELS;
+
+    bench.sweep = "block";
+    for (size_t i = 0; i < COUNT(block_sizes) && ok; ++i)
+    {
+        bench.block_frames = block_sizes[i];
+        ok = run_case(&bench, signal, min_seconds, results);
+    }
+    bench.block_frames = BENCH_DEFAULT_BLOCK;
+
+    // the size the filter picks for itself, reported as the size picked
+    bench.sweep = "block-auto";
+    bench.block_frames = LPF_BLOCK_AUTO;
+    if (ok)
+        ok = run_case(&bench, signal, min_seconds, results);
+    bench.block_frames = BENCH_DEFAULT_BLOCK;
+
+    bench.sweep = "window";
+    for (size_t i = 0; i < COUNT(window_types) && ok && !iir; ++i)
+    {
+        bench.window_type = window_types[i];
+        ok = run_case(&bench, signal, min_seconds, results);
+    }
+
+    return ok ? NO_ERROR : BENCHMARK_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Prepares a filter for one case and times lpf_process over the signal, one
+// block per call, until min_seconds have passed. One untimed pass first warms
+// the caches and the filter history.
+//
+// Arguments:
+//     bench       - settings to measure
+//     signal      - BENCH_SIGNAL_FRAMES frames of the widest channel count
+//     min_seconds - least time to measure for
+//     results     - file the CSV row is written to
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool run_case(const bench_case_t* bench,
+              const float* signal,
+              float min_seconds,
+              FILE* results)
+{
+    const bench_engine_t* engine = bench->engine;
+    const int channels = bench->channels;
+    const int max_channels = channel_counts[COUNT(channel_counts) - 1];
+    size_t block_frames = bench->block_frames;
+
+    low_pass_filter_t* lpf =
+        lpf_create(BENCH_CUTOFF, bench->window_type, bench->block_frames);
+    if (!lpf)
+        return false;
+
+    lpf_set_engine(lpf, engine->engine);
+    if (engine->engine == LPF_ENGINE_IIR)
+        lpf_set_iir_design(lpf, LPF_IIR_BUTTERWORTH, bench->order);
+    else
+        lpf_set_order(lpf, bench->order);
+    lpf_set_simd(lpf, engine->simd);
+    lpf_set_planar(lpf, engine->planar);
+
+    const bool prepared =
+        lpf_prepare(lpf, BENCH_SAMPLE_RATE, channels) == LPF_NO_ERROR;
+    if (prepared)
+        block_frames = lpf_get_block_size(lpf);
+
+    float* input =
+        (float*)malloc((size_t)BENCH_SIGNAL_FRAMES * channels * sizeof(float));
+    float* output = (float*)malloc(block_frames * channels * sizeof(float));
+
+    if (!input || !output || !prepared)
+    {
+        eprintf("%s: unable to prepare order %d, %d channels\n",
+                engine->name,
+                bench->order,
+                channels);
+        free(input);
+        free(output);
+        lpf_destroy(lpf);
+        return false;
+    }
+
+    for (size_t i = 0; i < BENCH_SIGNAL_FRAMES; ++i)
+        memcpy(input + i * channels,
+               signal + i * max_channels,
+               channels * sizeof(float));
+
+    const size_t blocks = BENCH_SIGNAL_FRAMES / block_frames;
+    long long frames = 0;
+    double elapsed = 0.0;
+
+    for (int pass = 0; elapsed < min_seconds; ++pass)
+    {
+        const double start = now_seconds();
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            lpf_process(lpf,
+                        input + b * block_frames * channels,
+                        output,
+                        block_frames);
+        }
+        const double stop = now_seconds();
+
+        // keeps the work from being optimised away
+        benchmark_sink = output[0];
+
+        if (pass > 0)
+        {
+            elapsed += stop - start;
+            frames += (long long)(blocks * block_frames);
+        }
+    }
+
+    const double samples = (double)frames * channels;
+    fprintf(results,
+            "%s,%s,%d,%s,%d,%zu,%lld,%.6f,%.0f,%.4f\n",
+            bench->sweep,
+            engine->name,
+            bench->order,
+            engine->engine == LPF_ENGINE_IIR ? "none"
+                                             : window_name(bench->window_type),
+            channels,
+            block_frames,
+            frames,
+            elapsed,
+            samples / elapsed,
+            elapsed * 1e9 / samples);
+    fflush(results);
+
+    free(input);
+    free(output);
+    lpf_destroy(lpf);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Generates BENCH_SIGNAL_FRAMES interleaved frames of a sine per channel, at
+// a different frequency in each and either side of the cutoff, plus noise
+// from a fixed seed, so every run filters the same signal.
+//
+// Arguments:
+//     channels - number of channels
+//
+// Returns:
+//     pointer to the signal, or NULL on failure
+// -----------------------------------------------------------------------------
+float* generate_signal(int channels)
+{
+    float* signal =
+        (float*)malloc((size_t)BENCH_SIGNAL_FRAMES * channels * sizeof(float));
+    if (!signal)
+        return NULL;
+
+    unsigned int seed = 1;
+    for (size_t i = 0; i < BENCH_SIGNAL_FRAMES; ++i)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const double frequency = 440.0 * (c + 1) * (c % 2 ? 7.0 : 1.0);
+            const double noise = (double)(seed >> 8) / (1 << 24) - 0.5;
+            signal[i * channels + c] =
+                (float)(0.5 * sin(2.0 * M_PI * frequency * i /
+                                  BENCH_SAMPLE_RATE) +
+                        0.1 * noise);
+        }
+    }
+
+    return signal;
+}
+
+// -----------------------------------------------------------------------------
+// Parses a comma separated list of positive thread counts.
+//
+// Arguments:
+//     list          - list as a string
+//     thread_counts - receives at most BENCH_MAX_THREAD_COUNTS counts
+//
+// Returns:
+//     number of counts, or 0 if the list is not valid
+// -----------------------------------------------------------------------------
+int get_thread_counts(const char* list, int* thread_counts)
+{
+    int count = 0;
+
+    for (const char* item = list;; ++item)
+    {
+        char* end = NULL;
+        const long value = strtol(item, &end, 10);
+
+        if (end == item || value <= 0 || value > 1024 ||
+            count == BENCH_MAX_THREAD_COUNTS)
+            return 0;
+
+        thread_counts[count++] = (int)value;
+        item = end;
+
+        if (*item == '\0')
+            return count;
+        else if (*item != ',')
+            return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Times lpf_filter_file at each thread count for each channel count of the
+// thread sweep, writing a CSV row per count. Speedup is the first count's time
+// over each count's, and efficiency the speedup per thread beyond it.
+//
+// Arguments:
+//     thread_counts - thread counts to time
+//     count         - length of thread_counts
+//     min_seconds   - least time to measure each count for
+//     results       - file the CSV rows are written to
+//
+// Returns:
+//     NO_ERROR, or BENCHMARK_ERROR if a file could not be written or filtered
+// -----------------------------------------------------------------------------
+int run_thread_sweep(const int* thread_counts,
+                     int count,
+                     float min_seconds,
+                     FILE* results)
+{
+    fprintf(results,
+            "channels,threads,order,frames,seconds,filter_seconds,"
+            "samples_per_sec,speedup,efficiency\n");
+
+    int retcode = NO_ERROR;
+    for (size_t c = 0; c < COUNT(thread_sweep_channels) && !retcode; ++c)
+    {
+        const int channels = thread_sweep_channels[c];
+        if (!write_signal_file(BENCH_THREAD_INPUT, channels))
+        {
+            eprintf("unable to write %s\n", BENCH_THREAD_INPUT);
+            retcode = BENCHMARK_ERROR;
+            break;
+        }
+
+        double first_seconds = 0.0;
+        for (int i = 0; i < count && !retcode; ++i)
+        {
+            lpf_stats_t stats;
+            if (!time_file(thread_counts[i], min_seconds, &stats))
+            {
+                eprintf("unable to filter %d channels on %d threads\n",
+                        channels,
+                        thread_counts[i]);
+                retcode = BENCHMARK_ERROR;
+                break;
+            }
+
+            const double seconds = (double)stats.total_ns * 1e-9;
+            if (i == 0)
+                first_seconds = seconds;
+
+            const double speedup = first_seconds / seconds;
+            fprintf(results,
+                    "%d,%d,%d,%d,%.6f,%.6f,%.0f,%.3f,%.3f\n",
+                    channels,
+                    thread_counts[i],
+                    BENCH_DEFAULT_ORDER,
+                    BENCH_SIGNAL_FRAMES,
+                    seconds,
+                    (double)stats.filter_ns * 1e-9,
+                    (double)BENCH_SIGNAL_FRAMES * channels / seconds,
+                    speedup,
+                    speedup * thread_counts[0] / thread_counts[i]);
+            fflush(results);
+        }
+    }
+
+    remove(BENCH_THREAD_INPUT);
+    remove(BENCH_THREAD_OUTPUT);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters the thread sweep's input file on thread_count threads, once untimed
+// to start the threads and warm the caches, then until min_seconds have
+// passed, keeping the stats of the fastest run.
+//
+// Arguments:
+//     thread_count - number of threads to filter on
+//     min_seconds  - least time to measure for
+//     best         - receives the stats of the fastest run
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool time_file(int thread_count, float min_seconds, lpf_stats_t* best)
+{
+    low_pass_filter_t* lpf = lpf_create(BENCH_CUTOFF, KAISER, LPF_BLOCK_AUTO);
+    if (!lpf)
+        return false;
+
+    lpf_set_order(lpf, BENCH_DEFAULT_ORDER);
+    lpf_set_thread_count(lpf, thread_count);
+    lpf_set_stats(lpf, true);
+
+    bool ok = true;
+    double elapsed = 0.0;
+    for (int pass = 0; ok && elapsed < min_seconds; ++pass)
+    {
+        sf_count_t frames = 0;
+        ok = lpf_filter_file(lpf,
+                             BENCH_THREAD_INPUT,
+                             BENCH_THREAD_OUTPUT,
+                             KAISER,
+                             &frames) == LPF_NO_ERROR &&
+             frames == BENCH_SIGNAL_FRAMES;
+
+        lpf_stats_t stats;
+        lpf_get_stats(lpf, &stats);
+
+        if (ok && pass > 0)
+        {
+            if (pass == 1 || stats.total_ns < best->total_ns)
+                *best = stats;
+            elapsed += (double)stats.total_ns * 1e-9;
+        }
+    }
+
+    lpf_destroy(lpf);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Writes the benchmark signal to a float WAV file.
+//
+// Arguments:
+//     file_name - name of file to write
+//     channels  - number of channels
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool write_signal_file(const char* file_name, int channels)
+{
+    float* signal = generate_signal(channels);
+    if (!signal)
+        return false;
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = (int)BENCH_SAMPLE_RATE;
+    info.channels = channels;
+    info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+    SNDFILE* file = sf_open(file_name, SFM_WRITE, &info);
+    const bool ok =
+        file && sf_writef_float(file, signal, BENCH_SIGNAL_FRAMES) ==
+                    BENCH_SIGNAL_FRAMES;
+
+    if (file && sf_close(file))
+        return false;
+
+    free(signal);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether this CPU has the instruction set an engine's kernel needs.
+// -----------------------------------------------------------------------------
+bool engine_supported(const bench_engine_t* engine)
+{
+    low_pass_filter_t* probe = lpf_create(BENCH_CUTOFF, KAISER, 1);
+    const bool supported =
+        probe && lpf_set_simd(probe, engine->simd) == LPF_NO_ERROR;
+    lpf_destroy(probe);
+
+    return supported;
+}
+
+// -----------------------------------------------------------------------------
+// Reads a monotonic clock.
+//
+// Returns:
+//     time in seconds from an arbitrary start
+// -----------------------------------------------------------------------------
+double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Gets the command line name of a window.
+// -----------------------------------------------------------------------------
+const char* window_name(enum window_t window_type)
+{
+    switch (window_type)
+    {
+    case KAISER: return "kaiser";
+    case BLACKMAN: return "blackman";
+    case HAMMING: return "hamming";
+    case HANNING: return "hanning";
+    case BARTLETT: return "bartlett";
+    case RECTANGULAR: return "rectangular";
+    default: return "none";
+    }
+}
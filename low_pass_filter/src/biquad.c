@@ -0,0 +1,363 @@
+
+#include "biquad.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "workspace.h"
+
+// State smaller than this is flushed to zero after each buffer. A decaying
+// recursive filter otherwise ends up on denormals after its input goes silent,
+// which are many times slower to compute with on x86.
+#define BIQUAD_DENORMAL_FLOOR 1e-25f
+
+// -----------------------------------------------------------------------------
+// Coefficients of one second order section, normalised so that a0 is 1. A
+// first order section has b2 and a2 of zero.
+// -----------------------------------------------------------------------------
+typedef struct biquad_section
+{
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+} biquad_section_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing a cascade of second order sections in transposed direct
+// form II, which needs two state variables per section and channel.
+//
+// State is laid out section by section, with each section's z1 for every
+// channel followed by its z2 for every channel. The channels of a frame are
+// adjacent in the audio buffer too, so the inner loop over channels is unit
+// stride in everything it touches and vectorises across channels.
+// -----------------------------------------------------------------------------
+typedef struct biquad_cascade
+{
+    int butterworth_order;
+    int stages;
+    int section_count;
+    int channel_count;
+    biquad_section_t* sections;
+    float* state;
+} biquad_cascade_t;
+
+int butterworth_sections(biquad_section_t* sections, int order, double k);
+
+int cascade_section_count(enum lpf_iir_response response, int order);
+
+void biquad_section_process(const biquad_section_t* section,
+                            float* z1,
+                            float* z2,
+                            float* audio_buffer,
+                            size_t frames,
+                            int channels);
+
+void biquad_section_process_mono(const biquad_section_t* section,
+                                 float* z1,
+                                 float* z2,
+                                 float* audio_buffer,
+                                 size_t frames);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes biquad_cascade_init needs for a cascade and its state.
+//
+// Arguments:
+//     response - Butterworth or Linkwitz-Riley
+//     order    - filter order
+//     channels - number of interleaved channels to process
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t biquad_cascade_size(enum lpf_iir_response response,
+                           int order,
+                           int channels)
+{
+    const size_t section_count =
+        (size_t)cascade_section_count(response, order > 1 ? order : 1);
+
+    return workspace_round(sizeof(biquad_cascade_t)) +
+           workspace_round(section_count * sizeof(biquad_section_t)) +
+           workspace_round(2 * section_count * channels * sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Builds a biquad_cascade_t object in memory and designs its sections with
+// the bilinear transform, prewarped so the response at the cutoff is exact.
+//
+// Arguments:
+//     memory      - biquad_cascade_size bytes of zeroed memory
+//     response    - Butterworth, or Linkwitz-Riley made of two Butterworths of
+//                   half the order
+//     order       - filter order, even for Linkwitz-Riley
+//     cutoff      - cutoff frequency in Hz, below the Nyquist frequency
+//     sample_rate - sample rate in Hz
+//     channels    - number of interleaved channels to process
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if the order or
+//     cutoff is out of range
+// -----------------------------------------------------------------------------
+biquad_cascade_t* biquad_cascade_init(void* memory,
+                                      enum lpf_iir_response response,
+                                      int order,
+                                      float cutoff,
+                                      float sample_rate,
+                                      int channels)
+{
+    if (order < 1 || cutoff <= 0 || 2.0f * cutoff >= sample_rate)
+        return NULL;
+
+    const int section_count = cascade_section_count(response, order);
+
+    unsigned char* cursor = (unsigned char*)memory;
+    biquad_cascade_t* cascade =
+        (biquad_cascade_t*)workspace_carve(&cursor, sizeof(biquad_cascade_t));
+
+    cascade->butterworth_order =
+        response == LPF_IIR_LINKWITZ_RILEY ? (order + 1) / 2 : order;
+    cascade->stages = response == LPF_IIR_LINKWITZ_RILEY ? 2 : 1;
+    cascade->section_count = section_count;
+    cascade->channel_count = channels;
+    cascade->sections = (biquad_section_t*)workspace_carve(
+        &cursor, section_count * sizeof(biquad_section_t));
+    cascade->state = (float*)workspace_carve(
+        &cursor, 2 * (size_t)section_count * channels * sizeof(float));
+
+    biquad_cascade_set_cutoff(cascade, cutoff, sample_rate);
+
+    return cascade;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of second order sections of a response and order: one per
+// pair of poles of each Butterworth stage, rounded up.
+// -----------------------------------------------------------------------------
+int cascade_section_count(enum lpf_iir_response response, int order)
+{
+    const int butterworth_order =
+        response == LPF_IIR_LINKWITZ_RILEY ? (order + 1) / 2 : order;
+    const int stages = response == LPF_IIR_LINKWITZ_RILEY ? 2 : 1;
+
+    return stages * ((butterworth_order + 1) / 2);
+}
+
+// -----------------------------------------------------------------------------
+// Redesigns the sections for a new cutoff, keeping their state, so the cutoff
+// can move while filtering without allocating. Small steps, such as a sweep
+// updated every few dozen frames, do not click.
+//
+// Arguments:
+//     cascade     - pointer to biquad cascade data
+//     cutoff      - cutoff frequency in Hz, below the Nyquist frequency
+//     sample_rate - sample rate in Hz
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void biquad_cascade_set_cutoff(biquad_cascade_t* cascade,
+                               float cutoff,
+                               float sample_rate)
+{
+    const double k = tan(M_PI * cutoff / sample_rate);
+
+    biquad_section_t* sections = cascade->sections;
+    for (int i = 0; i < cascade->stages; ++i)
+    {
+        sections +=
+            butterworth_sections(sections, cascade->butterworth_order, k);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Designs a Butterworth low pass as second order sections, plus a first order
+// section when the order is odd. Its poles are spaced pi / order apart round
+// the left half of a circle, symmetric about the real axis, so an odd order has
+// one on it. The pair at angle theta from the negative real axis gives a
+// section of Q 1 / (2 cos(theta)).
+//
+// Arguments:
+//     sections - receives (order + 1) / 2 sections
+//     order    - filter order
+//     k        - tan(pi * cutoff / sample_rate), the prewarped cutoff
+//
+// Returns:
+//     number of sections designed
+// -----------------------------------------------------------------------------
+int butterworth_sections(biquad_section_t* sections, int order, double k)
+{
+    int count = 0;
+
+    for (int i = 0; i < order / 2; ++i)
+    {
+        const double theta = M_PI * (2 * i + 1 + order % 2) / (2.0 * order);
+        const double q = 1.0 / (2.0 * cos(theta));
+        const double norm = 1.0 / (1.0 + k / q + k * k);
+
+        biquad_section_t* section = &sections[count++];
+        section->b0 = (float)(k * k * norm);
+        section->b1 = (float)(2.0 * k * k * norm);
+        section->b2 = section->b0;
+        section->a1 = (float)(2.0 * (k * k - 1.0) * norm);
+        section->a2 = (float)((1.0 - k / q + k * k) * norm);
+    }
+
+    if (order % 2)
+    {
+        const double norm = 1.0 / (1.0 + k);
+
+        biquad_section_t* section = &sections[count++];
+        section->b0 = (float)(k * norm);
+        section->b1 = section->b0;
+        section->b2 = 0.0f;
+        section->a1 = (float)((k - 1.0) * norm);
+        section->a2 = 0.0f;
+    }
+
+    return count;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved frames in place, continuing from the previous
+// call.
+//
+// The buffer goes through one section at a time, so a section's coefficients
+// stay in registers for the whole buffer and a block of audio stays in cache
+// between sections. Each output costs five multiplies per section, whatever
+// the cutoff.
+//
+// Arguments:
+//     cascade      - pointer to biquad cascade data
+//     audio_buffer - buffer of interleaved samples
+//     frames       - number of frames in buffer
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void biquad_cascade_process(biquad_cascade_t* cascade,
+                            float* audio_buffer,
+                            size_t frames)
+{
+    const int channels = cascade->channel_count;
+
+    for (int s = 0; s < cascade->section_count; ++s)
+    {
+        float* z1 = cascade->state + 2 * (size_t)s * channels;
+        float* z2 = z1 + channels;
+
+        if (channels == 1)
+        {
+            biquad_section_process_mono(
+                &cascade->sections[s], z1, z2, audio_buffer, frames);
+        }
+        else
+        {
+            biquad_section_process(
+                &cascade->sections[s], z1, z2, audio_buffer, frames, channels);
+        }
+    }
+
+    const size_t state_length = 2 * (size_t)cascade->section_count * channels;
+    for (size_t i = 0; i < state_length; ++i)
+    {
+        if (fabsf(cascade->state[i]) < BIQUAD_DENORMAL_FLOOR)
+            cascade->state[i] = 0.0f;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Runs one section over a buffer of interleaved frames, every channel of a
+// frame at once. Each output depends on the one before through the feedback,
+// so a single channel cannot go faster than the latency of that chain, but the
+// channels are independent and their state is contiguous, so the inner loop
+// vectorises and a vector of channels costs the same as one.
+//
+// Arguments:
+//     section      - coefficients of the section
+//     z1, z2       - state of the section, one of each per channel
+//     audio_buffer - buffer of interleaved samples
+//     frames       - number of frames in buffer
+//     channels     - number of interleaved channels
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void biquad_section_process(const biquad_section_t* section,
+                            float* z1,
+                            float* z2,
+                            float* audio_buffer,
+                            size_t frames,
+                            int channels)
+{
+    const float b0 = section->b0;
+    const float b1 = section->b1;
+    const float b2 = section->b2;
+    const float a1 = section->a1;
+    const float a2 = section->a2;
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        float* frame = audio_buffer + i * channels;
+
+        for (int c = 0; c < channels; ++c)
+        {
+            const float x = frame[c];
+            const float y = b0 * x + z1[c];
+            z1[c] = b1 * x - a1 * y + z2[c];
+            z2[c] = b2 * x - a2 * y;
+            frame[c] = y;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Runs one section over a buffer of mono samples. With nothing to vectorise
+// across, the state is kept in locals so that the feedback chain goes through
+// registers rather than through memory, which for one channel is the faster
+// of the two.
+// -----------------------------------------------------------------------------
+void biquad_section_process_mono(const biquad_section_t* section,
+                                 float* z1,
+                                 float* z2,
+                                 float* audio_buffer,
+                                 size_t frames)
+{
+    const float b0 = section->b0;
+    const float b1 = section->b1;
+    const float b2 = section->b2;
+    const float a1 = section->a1;
+    const float a2 = section->a2;
+    float s1 = *z1;
+    float s2 = *z2;
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        const float x = audio_buffer[i];
+        const float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        audio_buffer[i] = y;
+    }
+
+    *z1 = s1;
+    *z2 = s2;
+}
+
+// -----------------------------------------------------------------------------
+// Clears the state so the next buffer is filtered as if preceded by silence.
+//
+// Arguments:
+//     cascade - pointer to biquad cascade data
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void biquad_cascade_reset(biquad_cascade_t* cascade)
+{
+    memset(cascade->state,
+           0,
+           2 * (size_t)cascade->section_count * cascade->channel_count *
+               sizeof(float));
+}
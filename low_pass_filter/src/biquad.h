@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "low_pass_filter.h"
+
+typedef struct biquad_cascade biquad_cascade_t;
+
+size_t biquad_cascade_size(enum lpf_iir_response response,
+                           int order,
+                           int channels);
+
+biquad_cascade_t* biquad_cascade_init(void* memory,
+                                      enum lpf_iir_response response,
+                                      int order,
+                                      float cutoff,
+                                      float sample_rate,
+                                      int channels);
+
+void biquad_cascade_set_cutoff(biquad_cascade_t* cascade,
+                               float cutoff,
+                               float sample_rate);
+
+void biquad_cascade_process(biquad_cascade_t* cascade,
+                            float* audio_buffer,
+                            size_t frames);
+
+void biquad_cascade_reset(biquad_cascade_t* cascade);
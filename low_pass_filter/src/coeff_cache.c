@@ -0,0 +1,121 @@
+
+#include "coeff_cache.h"
+
+#include "thread.h"
+
+// -----------------------------------------------------------------------------
+// One designed filter and the parameters it was designed with.
+// -----------------------------------------------------------------------------
+typedef struct coeff_cache_entry
+{
+    filter_design_t design;
+    float* coeffs;
+    struct coeff_cache_entry* next;
+} coeff_cache_entry_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing designed coefficient sets shared between filters, keyed by
+// their design parameters. Entries live until the cache is
+// destroyed, so pointers handed out stay valid for its whole lifetime.
+// -----------------------------------------------------------------------------
+typedef struct coeff_cache
+{
+    mutex_t* mutex;
+    coeff_cache_entry_t* entries;
+} coeff_cache_t;
+
+// -----------------------------------------------------------------------------
+// Allocates an empty coeff_cache_t object.
+//
+// Returns:
+//     pointer to new coeff_cache_t object, or NULL on failure
+// -----------------------------------------------------------------------------
+coeff_cache_t* coeff_cache_create(void)
+{
+    coeff_cache_t* cache = (coeff_cache_t*)malloc(sizeof(coeff_cache_t));
+    if (!cache)
+        return NULL;
+
+    cache->mutex = mutex_create();
+    cache->entries = NULL;
+
+    if (!cache->mutex)
+    {
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+// -----------------------------------------------------------------------------
+// Finds the coefficients for a set of parameters, designing them on first use.
+// Safe to call from several threads at once.
+//
+// Arguments:
+//     cache  - cache to search
+//     design - parameters of the filter
+//
+// Returns:
+//     design->order + 1 coefficients owned by the cache, or NULL on failure
+// -----------------------------------------------------------------------------
+const float* coeff_cache_get(coeff_cache_t* cache,
+                             const filter_design_t* design)
+{
+    mutex_lock(cache->mutex);
+
+    coeff_cache_entry_t* entry = cache->entries;
+    while (entry && !filter_design_equal(&entry->design, design))
+        entry = entry->next;
+
+    if (!entry)
+    {
+        entry = (coeff_cache_entry_t*)malloc(sizeof(coeff_cache_entry_t));
+        float* coeffs =
+            (float*)calloc((size_t)design->order + 1, sizeof(float));
+
+        if (entry && coeffs && design_low_pass(coeffs, design))
+        {
+            entry->design = *design;
+            entry->coeffs = coeffs;
+            entry->next = cache->entries;
+            cache->entries = entry;
+        }
+        else
+        {
+            free(entry);
+            free(coeffs);
+            entry = NULL;
+        }
+    }
+
+    mutex_unlock(cache->mutex);
+
+    return entry ? entry->coeffs : NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Deallocates coeff_cache_t object and every coefficient set in it.
+//
+// Arguments:
+//      cache - coeff_cache_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void coeff_cache_destroy(coeff_cache_t* cache)
+{
+    if (!cache)
+        return;
+
+    while (cache->entries)
+    {
+        coeff_cache_entry_t* next = cache->entries->next;
+        free(cache->entries->coeffs);
+        free(cache->entries);
+        cache->entries = next;
+    }
+
+    mutex_destroy(cache->mutex);
+    free(cache);
+}
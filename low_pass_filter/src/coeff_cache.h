@@ -0,0 +1,12 @@
+#pragma once
+
+#include "filter_design.h"
+
+typedef struct coeff_cache coeff_cache_t;
+
+coeff_cache_t* coeff_cache_create(void);
+
+const float* coeff_cache_get(coeff_cache_t* cache,
+                             const filter_design_t* design);
+
+void coeff_cache_destroy(coeff_cache_t* cache);
@@ -0,0 +1,203 @@
+
+#include "cpu_features.h"
+
+#include "thread.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+    #define CPU_X86
+    #if defined(_MSC_VER)
+        #include <immintrin.h>
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    #define CPU_ARM64
+#endif
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <stdlib.h>
+#elif defined(__APPLE__)
+    #include <sys/sysctl.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Cache sizes assumed when the system does not report them, smaller than
+// those of any desktop CPU of the last decade.
+#define CPU_DEFAULT_L1_SIZE (32 * 1024)
+#define CPU_DEFAULT_L2_SIZE (256 * 1024)
+
+// Cache sizes found by cpu_cache_size, indexed by level, 0 until first asked
+// for. Guarded by global_lock.
+static size_t cpu_cache_sizes[3] = {0, 0, 0};
+
+#ifdef CPU_X86
+// -----------------------------------------------------------------------------
+// Runs cpuid for a leaf and subleaf.
+//
+// Arguments:
+//     leaf    - value of eax
+//     subleaf - value of ecx
+//     regs    - receives eax, ebx, ecx and edx
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void cpu_id(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+    #if defined(_MSC_VER)
+    __cpuidex((int*)regs, (int)leaf, (int)subleaf);
+    #else
+    regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    if (leaf <= __get_cpuid_max(0, 0))
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+// -----------------------------------------------------------------------------
+// Reads XCR0, the register state the operating system saves on a context
+// switch. Only valid when cpuid reports OSXSAVE.
+// -----------------------------------------------------------------------------
+unsigned long long cpu_xcr0(void)
+{
+    #if defined(_MSC_VER)
+    return _xgetbv(0);
+    #else
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((unsigned long long)hi << 32) | lo;
+    #endif
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Checks whether both the CPU and the operating system support an instruction
+// set.
+//
+// Arguments:
+//     level - instruction set to check
+//
+// Returns:
+//     non-zero if kernels for level can run on this machine
+// -----------------------------------------------------------------------------
+int cpu_supports(enum simd_level level)
+{
+    if (level == SIMD_SCALAR)
+        return 1;
+
+#ifdef CPU_X86
+    unsigned leaf1[4], leaf7[4];
+    cpu_id(1, 0, leaf1);
+    cpu_id(7, 0, leaf7);
+
+    const int sse2 = (leaf1[3] >> 26) & 1;
+    const int osxsave = (leaf1[2] >> 27) & 1;
+    const int avx = (leaf1[2] >> 28) & 1;
+    const int fma = (leaf1[2] >> 12) & 1;
+    const int avx2 = (leaf7[1] >> 5) & 1;
+    const int avx512f = (leaf7[1] >> 16) & 1;
+
+    // XMM and YMM state, plus opmask and both halves of ZMM for AVX-512
+    const unsigned long long xcr0 = osxsave ? cpu_xcr0() : 0;
+    const int os_avx = (xcr0 & 0x06) == 0x06;
+    const int os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+    switch (level)
+    {
+    case SIMD_SSE: return sse2;
+    case SIMD_AVX2: return avx && avx2 && fma && os_avx;
+    case SIMD_AVX512: return avx512f && os_avx512;
+    default: return 0;
+    }
+#elif defined(CPU_ARM64)
+    return level == SIMD_NEON;
+#else
+    return 0;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Finds the widest instruction set supported on this machine.
+//
+// Returns:
+//     preferred simd_level
+// -----------------------------------------------------------------------------
+enum simd_level cpu_best_simd_level(void)
+{
+    static const enum simd_level preference[] = {
+        SIMD_AVX512, SIMD_AVX2, SIMD_NEON, SIMD_SSE
+    };
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); ++i)
+    {
+        if (cpu_supports(preference[i]))
+            return preference[i];
+    }
+
+    return SIMD_SCALAR;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the size of one core's data or unified cache at a level, as the
+// system reports it. The system is only asked once per level per process, so
+// this is cheap enough to call for every file.
+//
+// Arguments:
+//     level - 1 for L1 data, 2 for L2
+//
+// Returns:
+//     size in bytes, or a conservative default if the system does not say
+// -----------------------------------------------------------------------------
+size_t cpu_cache_size(int level)
+{
+    global_lock();
+    size_t size = cpu_cache_sizes[level];
+    global_unlock();
+
+    if (size)
+        return size;
+
+#ifdef _WIN32
+    DWORD length = 0;
+    GetLogicalProcessorInformation(NULL, &length);
+
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION* info =
+        (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(length);
+    if (info && GetLogicalProcessorInformation(info, &length))
+    {
+        const DWORD count = length / sizeof(*info);
+        for (DWORD i = 0; i < count && !size; ++i)
+        {
+            const CACHE_DESCRIPTOR* cache = &info[i].Cache;
+            if (info[i].Relationship == RelationCache &&
+                cache->Level == level && cache->Type != CacheInstruction)
+                size = cache->Size;
+        }
+    }
+    free(info);
+#elif defined(__APPLE__)
+    long long value = 0;
+    size_t value_size = sizeof(value);
+    const char* name = level == 1 ? "hw.l1dcachesize" : "hw.l2cachesize";
+    if (!sysctlbyname(name, &value, &value_size, NULL, 0) && value > 0)
+        size = (size_t)value;
+#elif defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    const long value = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE
+                                          : _SC_LEVEL2_CACHE_SIZE);
+    if (value > 0)
+        size = (size_t)value;
+#endif
+
+    if (!size)
+        size = level == 1 ? CPU_DEFAULT_L1_SIZE : CPU_DEFAULT_L2_SIZE;
+
+    global_lock();
+    cpu_cache_sizes[level] = size;
+    global_unlock();
+
+    return size;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+
+// Instruction sets with a vectorised kernel, in increasing order of preference
+// on x86. NEON is the only vector level on ARM.
+enum simd_level
+{
+    SIMD_SCALAR,
+    SIMD_SSE,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_NEON,
+};
+
+int cpu_supports(enum simd_level level);
+enum simd_level cpu_best_simd_level(void);
+
+size_t cpu_cache_size(int level);
@@ -0,0 +1,161 @@
+
+#include "cutoff_bank.h"
+
+#include <string.h>
+
+#include "workspace.h"
+
+// Coefficient sets per octave of cutoff. Interpolating between neighbours
+// blends two responses whose cutoffs are under 3% apart, which widens the
+// transition band by about that much.
+#define CUTOFF_BANK_SETS_PER_OCTAVE 24
+
+// -----------------------------------------------------------------------------
+// Struct containing filters designed at cutoffs spaced evenly in log frequency
+// across a range, from which a filter at any cutoff in the range is
+// interpolated without designing or allocating anything.
+// -----------------------------------------------------------------------------
+typedef struct cutoff_bank
+{
+    size_t filter_length;
+    int set_count;
+    float lowest_cutoff;
+    float highest_cutoff;
+    float log_lowest_cutoff;
+    float log_step;
+    float* coeffs;
+} cutoff_bank_t;
+
+int cutoff_bank_set_count(float lowest_cutoff, float highest_cutoff);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes cutoff_bank_init needs for a bank and its coefficients.
+//
+// Arguments:
+//     design         - order of every set
+//     lowest_cutoff  - lowest cutoff the bank covers
+//     highest_cutoff - highest cutoff the bank covers
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t cutoff_bank_size(const filter_design_t* design,
+                        float lowest_cutoff,
+                        float highest_cutoff)
+{
+    const size_t set_count =
+        (size_t)cutoff_bank_set_count(lowest_cutoff, highest_cutoff);
+
+    return workspace_round(sizeof(cutoff_bank_t)) +
+           workspace_round(set_count * ((size_t)design->order + 1) *
+                           sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Builds a cutoff_bank_t object in memory and designs every set in it.
+//
+// Arguments:
+//     memory         - cutoff_bank_size bytes of zeroed memory
+//     design         - sample rate, order, window and phase of every set; its
+//                      cutoff is ignored
+//     lowest_cutoff  - lowest cutoff the bank covers
+//     highest_cutoff - highest cutoff the bank covers
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if a set could
+//     not be designed
+// -----------------------------------------------------------------------------
+cutoff_bank_t* cutoff_bank_init(void* memory,
+                                const filter_design_t* design,
+                                float lowest_cutoff,
+                                float highest_cutoff)
+{
+    const int set_count = cutoff_bank_set_count(lowest_cutoff, highest_cutoff);
+    const size_t filter_length = (size_t)design->order + 1;
+
+    unsigned char* cursor = (unsigned char*)memory;
+    cutoff_bank_t* bank =
+        (cutoff_bank_t*)workspace_carve(&cursor, sizeof(cutoff_bank_t));
+
+    bank->filter_length = filter_length;
+    bank->set_count = set_count;
+    bank->lowest_cutoff = lowest_cutoff;
+    bank->highest_cutoff = highest_cutoff;
+    bank->log_lowest_cutoff = logf(lowest_cutoff);
+    bank->log_step =
+        set_count > 1 ? (float)(log((double)highest_cutoff / lowest_cutoff) /
+                                (set_count - 1))
+                      : 0.0f;
+    bank->coeffs = (float*)workspace_carve(
+        &cursor, (size_t)set_count * filter_length * sizeof(float));
+
+    filter_design_t set_design = *design;
+    for (int i = 0; i < set_count; ++i)
+    {
+        set_design.cutoff =
+            i == set_count - 1
+                ? highest_cutoff
+                : lowest_cutoff * expf(bank->log_step * (float)i);
+
+        if (!design_low_pass(bank->coeffs + i * filter_length, &set_design))
+            return NULL;
+    }
+
+    return bank;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of sets covering a range of cutoffs, both ends included.
+// -----------------------------------------------------------------------------
+int cutoff_bank_set_count(float lowest_cutoff, float highest_cutoff)
+{
+    const double octaves = log2((double)highest_cutoff / lowest_cutoff);
+
+    return (int)ceil(octaves * CUTOFF_BANK_SETS_PER_OCTAVE) + 1;
+}
+
+// -----------------------------------------------------------------------------
+// Interpolates the coefficients for a cutoff linearly between the two sets
+// either side of it in log frequency. Cutoffs outside the bank are clamped to
+// it. Interpolating two linear phase sets gives a linear phase set, exactly
+// symmetric, so the folded tap kernels still apply.
+//
+// Arguments:
+//     bank   - pointer to cutoff bank data
+//     cutoff - cutoff in Hz
+//     coeffs - receives order + 1 coefficients
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void cutoff_bank_interpolate(const cutoff_bank_t* bank,
+                             float cutoff,
+                             float* coeffs)
+{
+    const size_t length = bank->filter_length;
+
+    if (cutoff <= bank->lowest_cutoff || bank->set_count == 1)
+    {
+        memcpy(coeffs, bank->coeffs, length * sizeof(float));
+        return;
+    }
+    else if (cutoff >= bank->highest_cutoff)
+    {
+        memcpy(coeffs,
+               bank->coeffs + (bank->set_count - 1) * length,
+               length * sizeof(float));
+        return;
+    }
+
+    const float position =
+        (logf(cutoff) - bank->log_lowest_cutoff) / bank->log_step;
+    int set = (int)position;
+    if (set > bank->set_count - 2)
+        set = bank->set_count - 2;
+    const float fraction = position - (float)set;
+
+    const float* below = bank->coeffs + set * length;
+    const float* above = below + length;
+    for (size_t i = 0; i < length; ++i)
+        coeffs[i] = below[i] + fraction * (above[i] - below[i]);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "filter_design.h"
+
+typedef struct cutoff_bank cutoff_bank_t;
+
+size_t cutoff_bank_size(const filter_design_t* design,
+                        float lowest_cutoff,
+                        float highest_cutoff);
+
+cutoff_bank_t* cutoff_bank_init(void* memory,
+                                const filter_design_t* design,
+                                float lowest_cutoff,
+                                float highest_cutoff);
+
+void cutoff_bank_interpolate(const cutoff_bank_t* bank,
+                             float cutoff,
+                             float* coeffs);
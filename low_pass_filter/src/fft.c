@@ -0,0 +1,206 @@
+
+#include "fft.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "workspace.h"
+
+// -----------------------------------------------------------------------------
+// Precomputed tables for an in-place radix-2 complex FFT of a fixed size.
+// -----------------------------------------------------------------------------
+typedef struct fft_plan
+{
+    size_t size;
+    float* cos_table;
+    float* sin_table;
+    size_t* bit_reverse;
+} fft_plan_t;
+
+void fft_transform(const fft_plan_t* plan,
+                   float* real,
+                   float* imag,
+                   float sign);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes fft_init needs for a plan and its tables.
+//
+// Arguments:
+//     size - transform length
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t fft_plan_size(size_t size)
+{
+    return workspace_round(sizeof(fft_plan_t)) +
+           2 * workspace_round(size / 2 * sizeof(float)) +
+           workspace_round(size * sizeof(size_t));
+}
+
+// -----------------------------------------------------------------------------
+// Builds an FFT plan in memory and fills its twiddle and bit reversal tables.
+// Twiddles are computed in double precision so that rounding error in the
+// transform comes from the butterflies only.
+//
+// Arguments:
+//     memory - fft_plan_size(size) bytes of zeroed memory
+//     size   - transform length, must be a power of two
+//
+// Returns:
+//     pointer to the plan, at the start of memory, or NULL if size is invalid
+// -----------------------------------------------------------------------------
+fft_plan_t* fft_init(void* memory, size_t size)
+{
+    if (size < 2 || (size & (size - 1)))
+        return NULL;
+
+    unsigned char* cursor = (unsigned char*)memory;
+    fft_plan_t* plan =
+        (fft_plan_t*)workspace_carve(&cursor, sizeof(fft_plan_t));
+
+    plan->size = size;
+    plan->cos_table =
+        (float*)workspace_carve(&cursor, size / 2 * sizeof(float));
+    plan->sin_table =
+        (float*)workspace_carve(&cursor, size / 2 * sizeof(float));
+    plan->bit_reverse =
+        (size_t*)workspace_carve(&cursor, size * sizeof(size_t));
+
+    for (size_t i = 0; i < size / 2; ++i)
+    {
+        const double angle = 2.0 * M_PI * (double)i / (double)size;
+        plan->cos_table[i] = (float)cos(angle);
+        plan->sin_table[i] = (float)-sin(angle);
+    }
+
+    int bits = 0;
+    while (((size_t)1 << bits) < size) ++bits;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        size_t reversed = 0;
+        for (int b = 0; b < bits; ++b)
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        plan->bit_reverse[i] = reversed;
+    }
+
+    return plan;
+}
+
+// -----------------------------------------------------------------------------
+// Allocates an FFT plan with fft_init.
+//
+// Arguments:
+//     size - transform length, must be a power of two
+//
+// Returns:
+//     pointer to new fft_plan_t object, or NULL on failure
+// -----------------------------------------------------------------------------
+fft_plan_t* fft_create(size_t size)
+{
+    void* memory = calloc(1, fft_plan_size(size));
+    fft_plan_t* plan = memory ? fft_init(memory, size) : NULL;
+    if (!plan)
+        free(memory);
+
+    return plan;
+}
+
+// -----------------------------------------------------------------------------
+// Forward transform in place.
+//
+// Arguments:
+//     plan - plan created with the length of real and imag
+//     real - real parts
+//     imag - imaginary parts
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void fft_forward(const fft_plan_t* plan, float* real, float* imag)
+{
+    fft_transform(plan, real, imag, 1.0f);
+}
+
+// -----------------------------------------------------------------------------
+// Inverse transform in place. The result is not scaled by 1 / size.
+//
+// Arguments:
+//     plan - plan created with the length of real and imag
+//     real - real parts
+//     imag - imaginary parts
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void fft_inverse(const fft_plan_t* plan, float* real, float* imag)
+{
+    fft_transform(plan, real, imag, -1.0f);
+}
+
+// -----------------------------------------------------------------------------
+// Iterative decimation in time butterflies. sign selects the direction by
+// conjugating the twiddle factors.
+// -----------------------------------------------------------------------------
+void fft_transform(const fft_plan_t* plan,
+                   float* real,
+                   float* imag,
+                   float sign)
+{
+    const size_t n = plan->size;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const size_t j = plan->bit_reverse[i];
+        if (j > i)
+        {
+            float tmp = real[i];
+            real[i] = real[j];
+            real[j] = tmp;
+            tmp = imag[i];
+            imag[i] = imag[j];
+            imag[j] = tmp;
+        }
+    }
+
+    for (size_t half = 1; half < n; half *= 2)
+    {
+        const size_t stride = n / (half * 2);
+        for (size_t start = 0; start < n; start += half * 2)
+        {
+            for (size_t k = 0; k < half; ++k)
+            {
+                const float w_re = plan->cos_table[k * stride];
+                const float w_im = sign * plan->sin_table[k * stride];
+
+                const size_t a = start + k;
+                const size_t b = a + half;
+
+                const float t_re = real[b] * w_re - imag[b] * w_im;
+                const float t_im = real[b] * w_im + imag[b] * w_re;
+
+                real[b] = real[a] - t_re;
+                imag[b] = imag[a] - t_im;
+                real[a] += t_re;
+                imag[a] += t_im;
+            }
+        }
+    }
+}
+
+size_t fft_size(const fft_plan_t* plan) { return plan->size; }
+
+// -----------------------------------------------------------------------------
+// Deallocates an fft_plan_t object made by fft_create, tables included.
+//
+// Arguments:
+//      plan - fft_plan_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void fft_destroy(fft_plan_t* plan)
+{
+    free(plan);
+}
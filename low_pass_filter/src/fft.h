@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct fft_plan fft_plan_t;
+
+size_t fft_plan_size(size_t size);
+
+fft_plan_t* fft_init(void* memory, size_t size);
+
+fft_plan_t* fft_create(size_t size);
+
+void fft_forward(const fft_plan_t* plan, float* real, float* imag);
+void fft_inverse(const fft_plan_t* plan, float* real, float* imag);
+
+size_t fft_size(const fft_plan_t* plan);
+
+void fft_destroy(fft_plan_t* plan);
@@ -0,0 +1,275 @@
+#include "filter_bank.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fir_kernels.h"
+#include "overlap_save.h"
+#include "workspace.h"
+
+// Rows of coefficients each call of the bank kernel filters with.
+#define FILTER_BANK_ROWS 4
+
+// -----------------------------------------------------------------------------
+// Struct containing several FIR filters of the same length run over one input,
+// for a set of cutoffs filtered in a single pass.
+//
+// Each channel has one line holding filter_length - 1 samples of history then
+// a block of input, oldest first, shared by every band. The coefficients form
+// a matrix of one row per band, each stored reversed so that every output is a
+// forward dot product from its oldest tap, padded with rows of zeros to a
+// multiple of FILTER_BANK_ROWS. Each window of the line is multiplied by the
+// matrix FILTER_BANK_ROWS rows at a time, so a sample is loaded once for that
+// many bands, and the matrix, a few kilobytes at usual orders, stays in cache.
+//
+// Filters long enough that FFT convolution beats any direct form instead have
+// one overlap-save convolver per band, each run over a copy of the input, and
+// no lines or matrix.
+// -----------------------------------------------------------------------------
+typedef struct filter_bank
+{
+    int band_count;
+    int row_count;
+    int filter_length;
+    int channel_count;
+    size_t block_frames;
+    size_t line_length;
+    float* coeffs;
+    float* lines;
+    dot_product_4_fn dot_product_4;
+    overlap_save_t** convolvers;
+} filter_bank_t;
+
+void process_block(filter_bank_t* bank,
+                   const float* input,
+                   float* const* outputs,
+                   size_t offset,
+                   size_t frames);
+
+// -----------------------------------------------------------------------------
+// Gets the rows of the coefficient matrix, band_count padded to a multiple of
+// FILTER_BANK_ROWS.
+// -----------------------------------------------------------------------------
+int bank_row_count(int band_count)
+{
+    return (band_count + FILTER_BANK_ROWS - 1) / FILTER_BANK_ROWS *
+           FILTER_BANK_ROWS;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the bytes filter_bank_init needs for a bank and its coefficients and
+// history, or its convolvers.
+//
+// Arguments:
+//     band_count    - number of bands
+//     filter_length - number of coefficients in each band
+//     channels      - number of interleaved channels
+//     block_frames  - frames the lines hold at once
+//     use_fft       - whether to convolve each band by FFT instead
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t filter_bank_size(int band_count,
+                        int filter_length,
+                        int channels,
+                        size_t block_frames,
+                        bool use_fft)
+{
+    const size_t bank_size = workspace_round(sizeof(filter_bank_t));
+
+    if (use_fft)
+        return bank_size +
+               workspace_round(band_count * sizeof(overlap_save_t*)) +
+               band_count * overlap_save_size(filter_length, channels);
+
+    const size_t line_length = (size_t)filter_length - 1 + block_frames;
+
+    return bank_size +
+           workspace_round((size_t)bank_row_count(band_count) *
+                           filter_length * sizeof(float)) +
+           workspace_round(line_length * channels * sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Builds a filter_bank_t object in memory and arranges the coefficients.
+//
+// Arguments:
+//     memory        - filter_bank_size bytes of zeroed memory
+//     coeffs        - one array of filter_length coefficients per band
+//     band_count    - number of bands
+//     filter_length - number of coefficients in each band
+//     channels      - number of interleaved channels
+//     block_frames  - frames the lines hold at once
+//     level         - instruction set of the tap kernel
+//     use_fft       - whether to convolve each band by FFT instead
+//
+// Returns:
+//     pointer to the object, at the start of memory
+// -----------------------------------------------------------------------------
+filter_bank_t* filter_bank_init(void* memory,
+                                const float* const* coeffs,
+                                int band_count,
+                                int filter_length,
+                                int channels,
+                                size_t block_frames,
+                                enum simd_level level,
+                                bool use_fft)
+{
+    unsigned char* cursor = (unsigned char*)memory;
+    filter_bank_t* bank =
+        (filter_bank_t*)workspace_carve(&cursor, sizeof(filter_bank_t));
+
+    bank->band_count = band_count;
+    bank->row_count = bank_row_count(band_count);
+    bank->filter_length = filter_length;
+    bank->channel_count = channels;
+    bank->block_frames = block_frames;
+    bank->line_length = (size_t)filter_length - 1 + block_frames;
+    bank->dot_product_4 = fir_dot_product_4_kernel(level);
+
+    if (use_fft)
+    {
+        const size_t convolver_size =
+            overlap_save_size(filter_length, channels);
+
+        bank->convolvers = (overlap_save_t**)workspace_carve(
+            &cursor, band_count * sizeof(overlap_save_t*));
+
+        for (int b = 0; b < band_count; ++b)
+            bank->convolvers[b] =
+                overlap_save_init(workspace_carve(&cursor, convolver_size),
+                                  coeffs[b],
+                                  filter_length,
+                                  channels);
+
+        return bank;
+    }
+
+    bank->coeffs = (float*)workspace_carve(
+        &cursor, (size_t)bank->row_count * filter_length * sizeof(float));
+    bank->lines = (float*)workspace_carve(
+        &cursor, bank->line_length * channels * sizeof(float));
+
+    for (int b = 0; b < band_count; ++b)
+    {
+        float* row = bank->coeffs + (size_t)b * filter_length;
+        for (int j = 0; j < filter_length; ++j)
+            row[j] = coeffs[b][filter_length - 1 - j];
+    }
+
+    return bank;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved samples with every band, continuing from the
+// previous call.
+//
+// Arguments:
+//     bank    - pointer to filter bank data
+//     input   - buffer of interleaved samples
+//     outputs - one buffer per band, each as long as input, receiving that
+//               band's filtered samples
+//     frames  - length of input
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void filter_bank_process(filter_bank_t* bank,
+                         const float* input,
+                         float* const* outputs,
+                         size_t frames)
+{
+    if (bank->convolvers)
+    {
+        for (int b = 0; b < bank->band_count; ++b)
+        {
+            memcpy(outputs[b],
+                   input,
+                   frames * bank->channel_count * sizeof(float));
+            overlap_save_process(bank->convolvers[b], outputs[b], frames);
+        }
+        return;
+    }
+
+    for (size_t done = 0; done < frames; done += bank->block_frames)
+    {
+        const size_t block = frames - done < bank->block_frames
+                                 ? frames - done
+                                 : bank->block_frames;
+
+        process_block(bank, input, outputs, done, block);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Clears the history, as though the next sample were the first.
+// -----------------------------------------------------------------------------
+void filter_bank_reset(filter_bank_t* bank)
+{
+    if (bank->convolvers)
+    {
+        for (int b = 0; b < bank->band_count; ++b)
+            overlap_save_reset(bank->convolvers[b]);
+        return;
+    }
+
+    memset(bank->lines,
+           0,
+           bank->line_length * bank->channel_count * sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Gets the fewest frames worth passing to filter_bank_process at once: a whole
+// FFT step when the bands are convolved by FFT, and 1 otherwise.
+// -----------------------------------------------------------------------------
+size_t filter_bank_step(const filter_bank_t* bank)
+{
+    return bank->convolvers ? overlap_save_step(bank->convolvers[0]) : 1;
+}
+
+// -----------------------------------------------------------------------------
+// Filters up to block_frames frames starting offset frames into the buffers,
+// one channel at a time.
+// -----------------------------------------------------------------------------
+void process_block(filter_bank_t* bank,
+                   const float* input,
+                   float* const* outputs,
+                   size_t offset,
+                   size_t frames)
+{
+    const int channels = bank->channel_count;
+    const int length = bank->filter_length;
+    const size_t history = (size_t)length - 1;
+    float sums[FILTER_BANK_ROWS];
+
+    for (int c = 0; c < channels; ++c)
+    {
+        float* line = bank->lines + c * bank->line_length;
+
+        for (size_t n = 0; n < frames; ++n)
+            line[history + n] = input[(offset + n) * channels + c];
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            const size_t sample = (offset + n) * channels + c;
+
+            for (int row = 0; row < bank->row_count; row += FILTER_BANK_ROWS)
+            {
+                bank->dot_product_4(bank->coeffs + (size_t)row * length,
+                                    length,
+                                    line + n,
+                                    length,
+                                    sums);
+
+                for (int r = 0; r < FILTER_BANK_ROWS; ++r)
+                {
+                    if (row + r < bank->band_count)
+                        outputs[row + r][sample] = sums[r];
+                }
+            }
+        }
+
+        memmove(line, line + frames, history * sizeof(float));
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cpu_features.h"
+
+typedef struct filter_bank filter_bank_t;
+
+size_t filter_bank_size(int band_count,
+                        int filter_length,
+                        int channels,
+                        size_t block_frames,
+                        bool use_fft);
+
+filter_bank_t* filter_bank_init(void* memory,
+                                const float* const* coeffs,
+                                int band_count,
+                                int filter_length,
+                                int channels,
+                                size_t block_frames,
+                                enum simd_level level,
+                                bool use_fft);
+
+void filter_bank_process(filter_bank_t* bank,
+                         const float* input,
+                         float* const* outputs,
+                         size_t frames);
+
+void filter_bank_reset(filter_bank_t* bank);
+
+size_t filter_bank_step(const filter_bank_t* bank);
@@ -0,0 +1,283 @@
+
+#include "filter_design.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft.h"
+#include "window_cache.h"
+
+// Cepstrum length per tap for minimum phase designs. The real cepstrum of a
+// filter with stopband nulls decays slowly, so it is taken over a grid much
+// longer than the filter to keep its time aliasing down.
+#define MINIMUM_PHASE_OVERSAMPLING 16
+
+// Floor on the magnitude response before taking its log, -140dB, so that
+// stopband nulls do not give log(0).
+#define MINIMUM_PHASE_FLOOR 1e-7f
+
+bool minimum_phase(float* coeffs, size_t filter_length);
+
+// -----------------------------------------------------------------------------
+// Designs a windowed sinc low pass filter, normalised to unity gain at DC, and
+// converts it to minimum phase if asked.
+//
+// The sine in the numerator of the sinc is stepped by rotation, in double, and
+// the window comes from the process-wide cache, so after the first design of a
+// given length and window a redesign costs a few multiplies per tap.
+//
+// Arguments:
+//     coeffs - receives design->order + 1 coefficients
+//     design - cutoff, sample rate, order, window and phase of the filter
+//
+// Returns:
+//     true on success, false if memory for a minimum phase design ran out
+// -----------------------------------------------------------------------------
+bool design_low_pass(float* coeffs, const filter_design_t* design)
+{
+    const int order = design->order;
+    const size_t filter_length = (size_t)order + 1ull;
+    float transition_frequency = design->cutoff / design->sample_rate;
+
+    // sin(step * x) for x from -order / 2 in steps of 1
+    const double step = 2.0 * M_PI * transition_frequency;
+    const double cos_step = cos(step);
+    const double sin_step = sin(step);
+    double s = sin(-step * order / 2.0);
+    double c = cos(-step * order / 2.0);
+
+    for (int i = 0; i < order + 1; ++i)
+    {
+        if (i == order / 2.0f)
+            coeffs[i] = 2.0f * transition_frequency;
+        else
+        {
+            const double pi_x = M_PI * (i - order / 2.0);
+            coeffs[i] = (float)(s / pi_x);
+        }
+
+        const double next_s = s * cos_step + c * sin_step;
+        c = c * cos_step - s * sin_step;
+        s = next_s;
+    }
+
+    window_cache_apply(
+        coeffs, filter_length, design->window_type, design->kaiser_beta);
+
+    // the window functions can round mirrored points differently, so copy the
+    // first half over the second to keep the design exactly linear phase
+    for (int i = 0; i < filter_length / 2; ++i)
+        coeffs[filter_length - 1 - i] = coeffs[i];
+
+    // normalises coeffiecients to avoid clipping, summing in double so that
+    // the gain of a long filter is not off by the rounding of the sum
+    double sum = 0.0;
+    for (int i = 0; i < filter_length; ++i) sum += coeffs[i];
+    const float scale = (float)(1.0 / sum);
+    for (int i = 0; i < filter_length; ++i) coeffs[i] *= scale;
+
+    if (design->phase == LPF_PHASE_MINIMUM)
+        return minimum_phase(coeffs, filter_length);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Designs the same filter as design_low_pass in double, for filtering in
+// double. The sinc, the window and the normalisation are all computed in
+// double, uncached. Minimum phase designs are still converted in float by
+// design_low_pass and widened, the cepstrum going through the float FFT.
+//
+// Arguments:
+//     coeffs - receives design->order + 1 coefficients
+//     design - cutoff, sample rate, order, window and phase of the filter
+//
+// Returns:
+//     true on success, false if memory ran out
+// -----------------------------------------------------------------------------
+bool design_low_pass_double(double* coeffs, const filter_design_t* design)
+{
+    const int order = design->order;
+    const size_t filter_length = (size_t)order + 1ull;
+
+    if (design->phase == LPF_PHASE_MINIMUM)
+    {
+        float* narrow = (float*)malloc(filter_length * sizeof(float));
+        const bool designed = narrow && design_low_pass(narrow, design);
+        for (size_t i = 0; designed && i < filter_length; ++i)
+            coeffs[i] = narrow[i];
+
+        free(narrow);
+        return designed;
+    }
+
+    const double transition_frequency =
+        (double)design->cutoff / design->sample_rate;
+
+    for (size_t i = 0; i < filter_length; ++i)
+    {
+        if (2 * i == (size_t)order)
+            coeffs[i] = 2.0 * transition_frequency;
+        else
+        {
+            const double pi_x = M_PI * ((double)i - order / 2.0);
+            coeffs[i] = sin(2.0 * pi_x * transition_frequency) / pi_x;
+        }
+    }
+
+    for (size_t i = 0; i < filter_length / 2; ++i)
+        coeffs[filter_length - 1 - i] = coeffs[i];
+
+    window_apply_double(
+        coeffs, filter_length, design->window_type, design->kaiser_beta);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < filter_length; ++i) sum += coeffs[i];
+    for (size_t i = 0; i < filter_length; ++i) coeffs[i] /= sum;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Replaces a filter with the minimum phase filter of the same magnitude
+// response, by the homomorphic method: the real cepstrum of the magnitude
+// response is folded onto positive quefrencies and exponentiated back. The
+// result puts its energy as early as possible, so it has far less delay than
+// the linear phase filter it came from.
+//
+// Arguments:
+//     coeffs        - filter coefficients, replaced in place
+//     filter_length - number of coefficients
+//
+// Returns:
+//     true on success, false if memory ran out, leaving coeffs unchanged
+// -----------------------------------------------------------------------------
+bool minimum_phase(float* coeffs, size_t filter_length)
+{
+    size_t size = 1;
+    while (size < MINIMUM_PHASE_OVERSAMPLING * filter_length) size *= 2;
+
+    fft_plan_t* plan = fft_create(size);
+    float* real = (float*)calloc(size, sizeof(float));
+    float* imag = (float*)calloc(size, sizeof(float));
+
+    if (!plan || !real || !imag)
+    {
+        fft_destroy(plan);
+        free(real);
+        free(imag);
+        return false;
+    }
+
+    // log magnitude response
+    memcpy(real, coeffs, filter_length * sizeof(float));
+    fft_forward(plan, real, imag);
+    for (size_t k = 0; k < size; ++k)
+    {
+        const float magnitude = sqrtf(real[k] * real[k] + imag[k] * imag[k]);
+        real[k] = logf(magnitude > MINIMUM_PHASE_FLOOR ? magnitude
+                                                       : MINIMUM_PHASE_FLOOR);
+        imag[k] = 0.0f;
+    }
+
+    // real cepstrum, folded so that it is causal, including the 1 / size the
+    // inverse transform leaves out
+    fft_inverse(plan, real, imag);
+    real[0] /= (float)size;
+    real[size / 2] /= (float)size;
+    for (size_t n = 1; n < size / 2; ++n) real[n] *= 2.0f / (float)size;
+    for (size_t n = size / 2 + 1; n < size; ++n) real[n] = 0.0f;
+    memset(imag, 0, size * sizeof(float));
+
+    // complex exponential back to a minimum phase response
+    fft_forward(plan, real, imag);
+    for (size_t k = 0; k < size; ++k)
+    {
+        const float magnitude = expf(real[k]);
+        const float phase = imag[k];
+        real[k] = magnitude * cosf(phase);
+        imag[k] = magnitude * sinf(phase);
+    }
+
+    fft_inverse(plan, real, imag);
+    for (size_t n = 0; n < filter_length; ++n)
+        coeffs[n] = real[n] / (float)size;
+
+    fft_destroy(plan);
+    free(real);
+    free(imag);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Compares two designs parameter by parameter.
+//
+// Arguments:
+//     a - first design
+//     b - second design
+//
+// Returns:
+//     true if both produce the same coefficients
+// -----------------------------------------------------------------------------
+bool filter_design_equal(const filter_design_t* a, const filter_design_t* b)
+{
+    return a->cutoff == b->cutoff && a->sample_rate == b->sample_rate &&
+           a->order == b->order && a->window_type == b->window_type &&
+           a->phase == b->phase &&
+           (a->window_type != KAISER || a->kaiser_beta == b->kaiser_beta);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the Kaiser window shape that reaches a stopband attenuation, from
+// Kaiser's empirical formula.
+//
+// Arguments:
+//     attenuation_db - stopband attenuation in dB
+//
+// Returns:
+//     Kaiser beta
+// -----------------------------------------------------------------------------
+float kaiser_design_beta(float attenuation_db)
+{
+    if (attenuation_db > 50.0f)
+        return 0.1102f * (attenuation_db - 8.7f);
+    else if (attenuation_db >= 21.0f)
+        return 0.5842f * powf(attenuation_db - 21.0f, 0.4f) +
+               0.07886f * (attenuation_db - 21.0f);
+    else
+        return 0.0f;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the smallest Kaiser windowed filter order that reaches a stopband
+// attenuation over a transition band, from Kaiser's empirical formula,
+// rounded up to an even order so the filter has a centre tap.
+//
+// Arguments:
+//     attenuation_db   - stopband attenuation in dB
+//     transition_width - stopband edge minus passband edge in Hz
+//     sample_rate      - sample rate
+//
+// Returns:
+//     filter order, at least 2 and at most INT_MAX - 1 so the tap count fits
+//     an int
+// -----------------------------------------------------------------------------
+int kaiser_design_order(float attenuation_db,
+                        float transition_width,
+                        float sample_rate)
+{
+    // in double, as a narrow transition asks for more taps than an int holds
+    const double transition_radians =
+        2.0 * M_PI * transition_width / sample_rate;
+    const double order =
+        ceil((attenuation_db - 8.0) / (2.285 * transition_radians));
+
+    if (order < 2.0)
+        return 2;
+    else if (!(order < INT_MAX - 1))
+        return INT_MAX - 1;
+
+    return (int)order + (int)order % 2;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "low_pass_filter.h"
+
+// Kaiser window shape used when none is asked for, 2 * sqrt(2 * pi).
+#define DEFAULT_KAISER_BETA (2.0f * sqrtf(2.0f * M_PI))
+
+// -----------------------------------------------------------------------------
+// Parameters of a windowed sinc low pass design.
+// -----------------------------------------------------------------------------
+typedef struct filter_design
+{
+    float cutoff;
+    float sample_rate;
+    int order;
+    enum window_t window_type;
+    float kaiser_beta;
+    enum lpf_phase phase;
+} filter_design_t;
+
+bool design_low_pass(float* coeffs, const filter_design_t* design);
+
+bool design_low_pass_double(double* coeffs, const filter_design_t* design);
+
+bool filter_design_equal(const filter_design_t* a, const filter_design_t* b);
+
+float kaiser_design_beta(float attenuation_db);
+
+int kaiser_design_order(float attenuation_db,
+                        float transition_width,
+                        float sample_rate);
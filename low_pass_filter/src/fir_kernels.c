@@ -0,0 +1,1986 @@
+
+#include "fir_kernels.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+    #define FIR_X86
+    #include <immintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    #define FIR_NEON
+    #include <arm_neon.h>
+#endif
+
+// MSVC allows any intrinsic in any function, GCC and Clang need each kernel
+// marked with the instruction set it uses.
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define FIR_TARGET(isa)
+#else
+    #define FIR_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// Tap count from which the folded AVX2 and AVX-512 kernels are picked for
+// symmetric coefficients. With FMA the wide kernels are bound by loads rather
+// than multiplies, and folding trades a multiply for a load, an add and a lane
+// reversal, so it only wins once the loop is long enough to hide them.
+#define FIR_FOLD_WIDE_MIN_TAPS 512
+
+// Tap counts from which fir_filter_line folds symmetric coefficients, and from
+// which it does with AVX2 and AVX-512. Below them the add per pair, the far
+// loads and the odd middle tap cost more than the multiplies saved; with FMA
+// a multiply costs no more than the add, so the wide kernels need about twice
+// the taps to gain. At 1023 taps folding is about 1.3 times as fast with SSE
+// and 1.45 with AVX2.
+#define FIR_FOLD_BLOCK_MIN_TAPS 16
+#define FIR_FOLD_BLOCK_WIDE_MIN_TAPS 48
+
+// Outputs and taps per tile of fir_filter_line. A tile's coefficients, the
+// samples it reads and its outputs take about 10KB, so they stay in L1 however
+// long the filter and however many outputs are asked for.
+#define FIR_OUTPUT_TILE 256
+#define FIR_TAP_TILE 1024
+
+// -----------------------------------------------------------------------------
+// Portable reference kernel. Sums in tap order, so results are bit-identical
+// to the original direct form loop.
+// -----------------------------------------------------------------------------
+float dot_product_scalar(const float* coeffs, const float* history, int length)
+{
+    float sum = 0.0f;
+    for (int j = 0; j < length; ++j) sum += coeffs[j] * history[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Portable folded kernel for symmetric coefficients. Each pair of taps that
+// share a coefficient is added before the multiply, halving the multiplies.
+// -----------------------------------------------------------------------------
+float dot_product_folded_scalar(const float* coeffs,
+                                const float* history,
+                                int length)
+{
+    const int half = length / 2;
+
+    float sum = 0.0f;
+    for (int j = 0; j < half; ++j)
+        sum += coeffs[j] * (history[j] + history[length - 1 - j]);
+
+    if (length % 2)
+        sum += coeffs[half] * history[half];
+
+    return sum;
+}
+
+#ifdef FIR_X86
+// -----------------------------------------------------------------------------
+// SSE kernel, two independent accumulators of four taps each.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+float dot_product_sse(const float* coeffs, const float* history, int length)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        acc0 = _mm_add_ps(acc0,
+                          _mm_mul_ps(_mm_loadu_ps(coeffs + j),
+                                     _mm_loadu_ps(history + j)));
+        acc1 = _mm_add_ps(acc1,
+                          _mm_mul_ps(_mm_loadu_ps(coeffs + j + 4),
+                                     _mm_loadu_ps(history + j + 4)));
+    }
+
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+
+    float sum = _mm_cvtss_f32(acc0);
+    for (; j < length; ++j) sum += coeffs[j] * history[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 kernel, four independent FMA accumulators of eight taps each to hide
+// FMA latency.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+float dot_product_avx2(const float* coeffs, const float* history, int length)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+
+    int j = 0;
+    for (; j + 32 <= length; j += 32)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j),
+                               _mm256_loadu_ps(history + j),
+                               acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j + 8),
+                               _mm256_loadu_ps(history + j + 8),
+                               acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j + 16),
+                               _mm256_loadu_ps(history + j + 16),
+                               acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j + 24),
+                               _mm256_loadu_ps(history + j + 24),
+                               acc3);
+    }
+    for (; j + 8 <= length; j += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j),
+                               _mm256_loadu_ps(history + j),
+                               acc0);
+    }
+
+    acc0 = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                             _mm256_extractf128_ps(acc0, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+    float sum = _mm_cvtss_f32(half);
+    for (; j < length; ++j) sum += coeffs[j] * history[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX-512 kernel, two independent FMA accumulators of sixteen taps each. The
+// tail is handled with a masked load instead of a scalar loop.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx512f")
+float dot_product_avx512(const float* coeffs, const float* history, int length)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+
+    int j = 0;
+    for (; j + 32 <= length; j += 32)
+    {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(coeffs + j),
+                               _mm512_loadu_ps(history + j),
+                               acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(coeffs + j + 16),
+                               _mm512_loadu_ps(history + j + 16),
+                               acc1);
+    }
+    for (; j < length; j += 16)
+    {
+        const int remaining = length - j;
+        const __mmask16 mask =
+            remaining >= 16 ? (__mmask16)0xFFFF
+                            : (__mmask16)((1u << remaining) - 1);
+        acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, coeffs + j),
+                               _mm512_maskz_loadu_ps(mask, history + j),
+                               acc0);
+    }
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+// -----------------------------------------------------------------------------
+// Folded SSE kernel. The far end of the history is loaded backwards, a vector
+// at a time, and reversed within the register so that each lane pairs with
+// the tap sharing its coefficient.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+float dot_product_folded_sse(const float* coeffs,
+                             const float* history,
+                             int length)
+{
+    const int half = length / 2;
+    const float* back = history + length - 4;
+
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    int j = 0;
+    for (; j + 8 <= half; j += 8)
+    {
+        const __m128 back0 = _mm_loadu_ps(back - j);
+        const __m128 back1 = _mm_loadu_ps(back - j - 4);
+        const __m128 pair0 = _mm_add_ps(
+            _mm_loadu_ps(history + j),
+            _mm_shuffle_ps(back0, back0, _MM_SHUFFLE(0, 1, 2, 3)));
+        const __m128 pair1 = _mm_add_ps(
+            _mm_loadu_ps(history + j + 4),
+            _mm_shuffle_ps(back1, back1, _MM_SHUFFLE(0, 1, 2, 3)));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coeffs + j), pair0));
+        acc1 =
+            _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coeffs + j + 4), pair1));
+    }
+
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+
+    float sum = _mm_cvtss_f32(acc0);
+    for (; j < half; ++j)
+        sum += coeffs[j] * (history[j] + history[length - 1 - j]);
+    if (length % 2)
+        sum += coeffs[half] * history[half];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Folded AVX2 kernel, two independent FMA accumulators of eight pairs each.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+float dot_product_folded_avx2(const float* coeffs,
+                              const float* history,
+                              int length)
+{
+    const int half = length / 2;
+    const float* back = history + length - 8;
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    int j = 0;
+    for (; j + 16 <= half; j += 16)
+    {
+        const __m256 pair0 = _mm256_add_ps(
+            _mm256_loadu_ps(history + j),
+            _mm256_permutevar8x32_ps(_mm256_loadu_ps(back - j), reverse));
+        const __m256 pair1 = _mm256_add_ps(
+            _mm256_loadu_ps(history + j + 8),
+            _mm256_permutevar8x32_ps(_mm256_loadu_ps(back - j - 8), reverse));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j), pair0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(coeffs + j + 8), pair1, acc1);
+    }
+    for (; j < half; j += 8)
+    {
+        // the last pairs take the low lanes of the front and the high lanes of
+        // the back, masked so nothing past either end is read
+        const __m256i remaining = _mm256_set1_epi32(half - j);
+        const __m256i front_mask = _mm256_cmpgt_epi32(
+            remaining, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m256i back_mask = _mm256_permutevar8x32_epi32(front_mask,
+                                                              reverse);
+        const __m256 pair = _mm256_add_ps(
+            _mm256_maskload_ps(history + j, front_mask),
+            _mm256_permutevar8x32_ps(_mm256_maskload_ps(back - j, back_mask),
+                                     reverse));
+        acc0 = _mm256_fmadd_ps(
+            _mm256_maskload_ps(coeffs + j, front_mask), pair, acc0);
+    }
+
+    acc0 = _mm256_add_ps(acc0, acc1);
+
+    __m128 quarter = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                                _mm256_extractf128_ps(acc0, 1));
+    quarter = _mm_add_ps(quarter, _mm_movehl_ps(quarter, quarter));
+    quarter = _mm_add_ss(quarter, _mm_shuffle_ps(quarter, quarter, 1));
+
+    float sum = _mm_cvtss_f32(quarter);
+    if (length % 2)
+        sum += coeffs[half] * history[half];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Folded AVX-512 kernel, two independent FMA accumulators of sixteen pairs
+// each.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx512f")
+float dot_product_folded_avx512(const float* coeffs,
+                                const float* history,
+                                int length)
+{
+    const int half = length / 2;
+    const float* back = history + length - 16;
+    const __m512i reverse = _mm512_setr_epi32(
+        15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+
+    int j = 0;
+    for (; j + 32 <= half; j += 32)
+    {
+        const __m512 pair0 = _mm512_add_ps(
+            _mm512_loadu_ps(history + j),
+            _mm512_permutexvar_ps(reverse, _mm512_loadu_ps(back - j)));
+        const __m512 pair1 = _mm512_add_ps(
+            _mm512_loadu_ps(history + j + 16),
+            _mm512_permutexvar_ps(reverse, _mm512_loadu_ps(back - j - 16)));
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(coeffs + j), pair0, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(coeffs + j + 16), pair1, acc1);
+    }
+    for (; j < half; j += 16)
+    {
+        // the last pairs take the low lanes of the front and the high lanes of
+        // the back
+        const int remaining = half - j;
+        const __mmask16 front_mask =
+            remaining >= 16 ? (__mmask16)0xFFFF
+                            : (__mmask16)((1u << remaining) - 1);
+        const __mmask16 back_mask =
+            remaining >= 16 ? (__mmask16)0xFFFF
+                            : (__mmask16)(front_mask << (16 - remaining));
+        const __m512 pair = _mm512_add_ps(
+            _mm512_maskz_loadu_ps(front_mask, history + j),
+            _mm512_permutexvar_ps(reverse,
+                                  _mm512_maskz_loadu_ps(back_mask, back - j)));
+        acc0 = _mm512_fmadd_ps(
+            _mm512_maskz_loadu_ps(front_mask, coeffs + j), pair, acc0);
+    }
+
+    float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    if (length % 2)
+        sum += coeffs[half] * history[half];
+
+    return sum;
+}
+#endif
+
+#ifdef FIR_NEON
+// -----------------------------------------------------------------------------
+// NEON kernel, four independent FMA accumulators of four taps each.
+// -----------------------------------------------------------------------------
+float dot_product_neon(const float* coeffs, const float* history, int length)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+
+    int j = 0;
+    for (; j + 16 <= length; j += 16)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(coeffs + j), vld1q_f32(history + j));
+        acc1 = vfmaq_f32(acc1,
+                         vld1q_f32(coeffs + j + 4),
+                         vld1q_f32(history + j + 4));
+        acc2 = vfmaq_f32(acc2,
+                         vld1q_f32(coeffs + j + 8),
+                         vld1q_f32(history + j + 8));
+        acc3 = vfmaq_f32(acc3,
+                         vld1q_f32(coeffs + j + 12),
+                         vld1q_f32(history + j + 12));
+    }
+    for (; j + 4 <= length; j += 4)
+        acc0 = vfmaq_f32(acc0, vld1q_f32(coeffs + j), vld1q_f32(history + j));
+
+    float sum =
+        vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for (; j < length; ++j) sum += coeffs[j] * history[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Folded NEON kernel, two independent FMA accumulators of four pairs each.
+// vrev64q swaps within each half and vextq swaps the halves, reversing the
+// register.
+// -----------------------------------------------------------------------------
+float dot_product_folded_neon(const float* coeffs,
+                              const float* history,
+                              int length)
+{
+    const int half = length / 2;
+    const float* back = history + length - 4;
+
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+
+    int j = 0;
+    for (; j + 8 <= half; j += 8)
+    {
+        const float32x4_t back0 = vrev64q_f32(vld1q_f32(back - j));
+        const float32x4_t back1 = vrev64q_f32(vld1q_f32(back - j - 4));
+        const float32x4_t pair0 =
+            vaddq_f32(vld1q_f32(history + j), vextq_f32(back0, back0, 2));
+        const float32x4_t pair1 =
+            vaddq_f32(vld1q_f32(history + j + 4), vextq_f32(back1, back1, 2));
+        acc0 = vfmaq_f32(acc0, vld1q_f32(coeffs + j), pair0);
+        acc1 = vfmaq_f32(acc1, vld1q_f32(coeffs + j + 4), pair1);
+    }
+
+    float sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; j < half; ++j)
+        sum += coeffs[j] * (history[j] + history[length - 1 - j]);
+    if (length % 2)
+        sum += coeffs[half] * history[half];
+
+    return sum;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Portable Q15 kernel, 16 bit samples by 16 bit coefficients summed in 32
+// bits.
+// -----------------------------------------------------------------------------
+int32_t dot_product_q15_scalar(const int16_t* coeffs,
+                               const int16_t* samples,
+                               int length)
+{
+    int32_t sum = 0;
+    for (int j = 0; j < length; ++j) sum += (int32_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Portable Q31 kernel, 24 bit samples by 32 bit coefficients summed in 64
+// bits.
+// -----------------------------------------------------------------------------
+int64_t dot_product_q31_scalar(const int32_t* coeffs,
+                               const int32_t* samples,
+                               int length)
+{
+    int64_t sum = 0;
+    for (int j = 0; j < length; ++j) sum += (int64_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+#ifdef FIR_X86
+// -----------------------------------------------------------------------------
+// SSE2 Q15 kernel. pmaddwd multiplies eight pairs of 16 bit values and adds
+// neighbouring products into four 32 bit lanes, two accumulators deep.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+int32_t dot_product_q15_sse(const int16_t* coeffs,
+                            const int16_t* samples,
+                            int length)
+{
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+
+    int j = 0;
+    for (; j + 16 <= length; j += 16)
+    {
+        acc0 = _mm_add_epi32(
+            acc0,
+            _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(coeffs + j)),
+                           _mm_loadu_si128((const __m128i*)(samples + j))));
+        acc1 = _mm_add_epi32(
+            acc1,
+            _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(coeffs + j + 8)),
+                           _mm_loadu_si128((const __m128i*)(samples + j + 8))));
+    }
+
+    acc0 = _mm_add_epi32(acc0, acc1);
+    acc0 = _mm_add_epi32(acc0, _mm_shuffle_epi32(acc0, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc0 = _mm_add_epi32(acc0, _mm_shuffle_epi32(acc0, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    int32_t sum = _mm_cvtsi128_si32(acc0);
+    for (; j < length; ++j) sum += (int32_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 Q15 kernel, sixteen taps per pmaddwd and two accumulators deep.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2")
+int32_t dot_product_q15_avx2(const int16_t* coeffs,
+                             const int16_t* samples,
+                             int length)
+{
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+
+    int j = 0;
+    for (; j + 32 <= length; j += 32)
+    {
+        acc0 = _mm256_add_epi32(
+            acc0,
+            _mm256_madd_epi16(
+                _mm256_loadu_si256((const __m256i*)(coeffs + j)),
+                _mm256_loadu_si256((const __m256i*)(samples + j))));
+        acc1 = _mm256_add_epi32(
+            acc1,
+            _mm256_madd_epi16(
+                _mm256_loadu_si256((const __m256i*)(coeffs + j + 16)),
+                _mm256_loadu_si256((const __m256i*)(samples + j + 16))));
+    }
+    for (; j + 16 <= length; j += 16)
+    {
+        acc0 = _mm256_add_epi32(
+            acc0,
+            _mm256_madd_epi16(
+                _mm256_loadu_si256((const __m256i*)(coeffs + j)),
+                _mm256_loadu_si256((const __m256i*)(samples + j))));
+    }
+
+    acc0 = _mm256_add_epi32(acc0, acc1);
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(acc0),
+                                 _mm256_extracti128_si256(acc0, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    int32_t sum = _mm_cvtsi128_si32(half);
+    for (; j < length; ++j) sum += (int32_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 Q31 kernel. vpmuldq multiplies the even 32 bit lanes into 64 bit
+// products, so the odd lanes are shifted down and multiplied separately.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2")
+int64_t dot_product_q31_avx2(const int32_t* coeffs,
+                             const int32_t* samples,
+                             int length)
+{
+    __m256i acc_even = _mm256_setzero_si256();
+    __m256i acc_odd = _mm256_setzero_si256();
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        const __m256i c = _mm256_loadu_si256((const __m256i*)(coeffs + j));
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(samples + j));
+        acc_even = _mm256_add_epi64(acc_even, _mm256_mul_epi32(c, x));
+        acc_odd = _mm256_add_epi64(acc_odd,
+                                   _mm256_mul_epi32(_mm256_srli_epi64(c, 32),
+                                                    _mm256_srli_epi64(x, 32)));
+    }
+
+    const __m256i acc = _mm256_add_epi64(acc_even, acc_odd);
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                       _mm256_extracti128_si256(acc, 1));
+
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, half);
+
+    int64_t sum = lanes[0] + lanes[1];
+    for (; j < length; ++j) sum += (int64_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+#endif
+
+#ifdef FIR_NEON
+// -----------------------------------------------------------------------------
+// NEON Q15 kernel, widening multiply-accumulate into 32 bit lanes.
+// -----------------------------------------------------------------------------
+int32_t dot_product_q15_neon(const int16_t* coeffs,
+                             const int16_t* samples,
+                             int length)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        const int16x8_t c = vld1q_s16(coeffs + j);
+        const int16x8_t x = vld1q_s16(samples + j);
+        acc0 = vmlal_s16(acc0, vget_low_s16(c), vget_low_s16(x));
+        acc1 = vmlal_s16(acc1, vget_high_s16(c), vget_high_s16(x));
+    }
+
+    int32_t sum = vaddvq_s32(vaddq_s32(acc0, acc1));
+    for (; j < length; ++j) sum += (int32_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// NEON Q31 kernel, widening multiply-accumulate into 64 bit lanes.
+// -----------------------------------------------------------------------------
+int64_t dot_product_q31_neon(const int32_t* coeffs,
+                             const int32_t* samples,
+                             int length)
+{
+    int64x2_t acc0 = vdupq_n_s64(0);
+    int64x2_t acc1 = vdupq_n_s64(0);
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const int32x4_t c = vld1q_s32(coeffs + j);
+        const int32x4_t x = vld1q_s32(samples + j);
+        acc0 = vmlal_s32(acc0, vget_low_s32(c), vget_low_s32(x));
+        acc1 = vmlal_s32(acc1, vget_high_s32(c), vget_high_s32(x));
+    }
+
+    int64_t sum = vaddvq_s64(vaddq_s64(acc0, acc1));
+    for (; j < length; ++j) sum += (int64_t)coeffs[j] * samples[j];
+
+    return sum;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Portable four row kernel for a filter bank. Each sample is loaded once for
+// all four rows.
+// -----------------------------------------------------------------------------
+void dot_product_4_scalar(const float* coeffs,
+                          int stride,
+                          const float* history,
+                          int length,
+                          float* sums)
+{
+    float sum0 = 0.0f;
+    float sum1 = 0.0f;
+    float sum2 = 0.0f;
+    float sum3 = 0.0f;
+
+    for (int j = 0; j < length; ++j)
+    {
+        const float x = history[j];
+        sum0 += coeffs[j] * x;
+        sum1 += coeffs[stride + j] * x;
+        sum2 += coeffs[2 * stride + j] * x;
+        sum3 += coeffs[3 * stride + j] * x;
+    }
+
+    sums[0] = sum0;
+    sums[1] = sum1;
+    sums[2] = sum2;
+    sums[3] = sum3;
+}
+
+#ifdef FIR_X86
+// -----------------------------------------------------------------------------
+// SSE four row kernel, one accumulator per row. The accumulators are
+// transposed so that one add of the four leaves each row's sum in its lane.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+void dot_product_4_sse(const float* coeffs,
+                       int stride,
+                       const float* history,
+                       int length,
+                       float* sums)
+{
+    const float* c0 = coeffs;
+    const float* c1 = coeffs + stride;
+    const float* c2 = coeffs + 2 * stride;
+    const float* c3 = coeffs + 3 * stride;
+
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    __m128 acc3 = _mm_setzero_ps();
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const __m128 x = _mm_loadu_ps(history + j);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(c0 + j), x));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(c1 + j), x));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(c2 + j), x));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(c3 + j), x));
+    }
+
+    _MM_TRANSPOSE4_PS(acc0, acc1, acc2, acc3);
+    _mm_storeu_ps(sums,
+                  _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3)));
+
+    for (; j < length; ++j)
+    {
+        sums[0] += c0[j] * history[j];
+        sums[1] += c1[j] * history[j];
+        sums[2] += c2[j] * history[j];
+        sums[3] += c3[j] * history[j];
+    }
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 four row kernel, two FMA accumulators per row over sixteen taps, so
+// that eight are in flight to hide FMA latency. Each history load feeds four
+// FMAs instead of one.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+void dot_product_4_avx2(const float* coeffs,
+                        int stride,
+                        const float* history,
+                        int length,
+                        float* sums)
+{
+    const float* c0 = coeffs;
+    const float* c1 = coeffs + stride;
+    const float* c2 = coeffs + 2 * stride;
+    const float* c3 = coeffs + 3 * stride;
+
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    __m256 acc4 = _mm256_setzero_ps();
+    __m256 acc5 = _mm256_setzero_ps();
+    __m256 acc6 = _mm256_setzero_ps();
+    __m256 acc7 = _mm256_setzero_ps();
+
+    int j = 0;
+    for (; j + 16 <= length; j += 16)
+    {
+        const __m256 x0 = _mm256_loadu_ps(history + j);
+        const __m256 x1 = _mm256_loadu_ps(history + j + 8);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(c0 + j), x0, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(c1 + j), x0, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(c2 + j), x0, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(c3 + j), x0, acc3);
+        acc4 = _mm256_fmadd_ps(_mm256_loadu_ps(c0 + j + 8), x1, acc4);
+        acc5 = _mm256_fmadd_ps(_mm256_loadu_ps(c1 + j + 8), x1, acc5);
+        acc6 = _mm256_fmadd_ps(_mm256_loadu_ps(c2 + j + 8), x1, acc6);
+        acc7 = _mm256_fmadd_ps(_mm256_loadu_ps(c3 + j + 8), x1, acc7);
+    }
+    for (; j + 8 <= length; j += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(history + j);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(c0 + j), x, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(c1 + j), x, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(c2 + j), x, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(c3 + j), x, acc3);
+    }
+
+    acc0 = _mm256_add_ps(acc0, acc4);
+    acc1 = _mm256_add_ps(acc1, acc5);
+    acc2 = _mm256_add_ps(acc2, acc6);
+    acc3 = _mm256_add_ps(acc3, acc7);
+
+    // pairwise adds leave row r's two half sums in lane r of each half
+    const __m256 rows = _mm256_hadd_ps(_mm256_hadd_ps(acc0, acc1),
+                                       _mm256_hadd_ps(acc2, acc3));
+    _mm_storeu_ps(sums,
+                  _mm_add_ps(_mm256_castps256_ps128(rows),
+                             _mm256_extractf128_ps(rows, 1)));
+
+    for (; j < length; ++j)
+    {
+        sums[0] += c0[j] * history[j];
+        sums[1] += c1[j] * history[j];
+        sums[2] += c2[j] * history[j];
+        sums[3] += c3[j] * history[j];
+    }
+}
+#endif
+
+#ifdef FIR_NEON
+// -----------------------------------------------------------------------------
+// NEON four row kernel, one FMA accumulator per row.
+// -----------------------------------------------------------------------------
+void dot_product_4_neon(const float* coeffs,
+                        int stride,
+                        const float* history,
+                        int length,
+                        float* sums)
+{
+    const float* c0 = coeffs;
+    const float* c1 = coeffs + stride;
+    const float* c2 = coeffs + 2 * stride;
+    const float* c3 = coeffs + 3 * stride;
+
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const float32x4_t x = vld1q_f32(history + j);
+        acc0 = vfmaq_f32(acc0, vld1q_f32(c0 + j), x);
+        acc1 = vfmaq_f32(acc1, vld1q_f32(c1 + j), x);
+        acc2 = vfmaq_f32(acc2, vld1q_f32(c2 + j), x);
+        acc3 = vfmaq_f32(acc3, vld1q_f32(c3 + j), x);
+    }
+
+    sums[0] = vaddvq_f32(acc0);
+    sums[1] = vaddvq_f32(acc1);
+    sums[2] = vaddvq_f32(acc2);
+    sums[3] = vaddvq_f32(acc3);
+
+    for (; j < length; ++j)
+    {
+        sums[0] += c0[j] * history[j];
+        sums[1] += c1[j] * history[j];
+        sums[2] += c2[j] * history[j];
+        sums[3] += c3[j] * history[j];
+    }
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Portable block kernel. Each output is summed in a local in tap order, so a
+// single tile gives the same result as dot_product_scalar.
+// -----------------------------------------------------------------------------
+void block_dot_product_scalar(const float* coeffs,
+                              int length,
+                              const float* history,
+                              float* outputs,
+                              int count)
+{
+    for (int k = 0; k < count; ++k)
+    {
+        const float* window = history - k;
+
+        float sum = 0.0f;
+        for (int j = 0; j < length; ++j) sum += coeffs[j] * window[j];
+
+        outputs[k] += sum;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Scalar tail of the FMA block kernels. Each output is summed with fused
+// multiply-adds in tap order, rounding exactly as a vector lane does, so an
+// output comes out the same wherever it falls in a call.
+// -----------------------------------------------------------------------------
+void block_dot_product_fused(const float* coeffs,
+                             int length,
+                             const float* history,
+                             float* outputs,
+                             int count)
+{
+    for (int k = 0; k < count; ++k)
+    {
+        const float* window = history - k;
+
+        float sum = 0.0f;
+        for (int j = 0; j < length; ++j) sum = fmaf(coeffs[j], window[j], sum);
+
+        outputs[k] += sum;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Portable folded block kernel. Each pair of samples sharing a coefficient is
+// added first, so every output takes one multiply per pair.
+// -----------------------------------------------------------------------------
+void block_folded_dot_product_scalar(const float* coeffs,
+                                     int pairs,
+                                     const float* history,
+                                     const float* mirror,
+                                     float* outputs,
+                                     int count)
+{
+    for (int k = 0; k < count; ++k)
+    {
+        const float* window = history - k;
+        const float* far = mirror - k;
+
+        float sum = 0.0f;
+        for (int j = 0; j < pairs; ++j)
+            sum += coeffs[j] * (window[j] + far[-j]);
+
+        outputs[k] += sum;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Scalar tail of the FMA folded block kernels, rounding as a vector lane does.
+// -----------------------------------------------------------------------------
+void block_folded_dot_product_fused(const float* coeffs,
+                                    int pairs,
+                                    const float* history,
+                                    const float* mirror,
+                                    float* outputs,
+                                    int count)
+{
+    for (int k = 0; k < count; ++k)
+    {
+        const float* window = history - k;
+        const float* far = mirror - k;
+
+        float sum = 0.0f;
+        for (int j = 0; j < pairs; ++j)
+            sum = fmaf(coeffs[j], window[j] + far[-j], sum);
+
+        outputs[k] += sum;
+    }
+}
+
+#ifdef FIR_X86
+// -----------------------------------------------------------------------------
+// SSE block kernel, sixteen outputs at a time in four accumulators. A load at
+// history - k - 3 holds the samples of outputs k + 3 down to k, so each lane
+// is one output and is reversed into place once all taps are added. Lanes
+// round as the scalar kernel does, which does the rest.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+void block_dot_product_sse(const float* coeffs,
+                           int length,
+                           const float* history,
+                           float* outputs,
+                           int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        const float* x = history - k - 3;
+
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+
+        for (int j = 0; j < length; ++j)
+        {
+            const __m128 c = _mm_set1_ps(coeffs[j]);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(c, _mm_loadu_ps(x + j)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(c, _mm_loadu_ps(x + j - 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(c, _mm_loadu_ps(x + j - 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(c, _mm_loadu_ps(x + j - 12)));
+        }
+
+        const __m128 accs[4] = {acc0, acc1, acc2, acc3};
+        for (int a = 0; a < 4; ++a)
+        {
+            float* out = outputs + k + 4 * a;
+            _mm_storeu_ps(out,
+                          _mm_add_ps(_mm_loadu_ps(out),
+                                     _mm_shuffle_ps(accs[a],
+                                                    accs[a],
+                                                    _MM_SHUFFLE(0, 1, 2, 3))));
+        }
+    }
+
+    block_dot_product_scalar(
+        coeffs, length, history - k, outputs + k, count - k);
+}
+
+// -----------------------------------------------------------------------------
+// SSE folded block kernel, laid out as the SSE block kernel. A load at
+// mirror - j - k - 3 holds the far samples of outputs k + 3 down to k in the
+// same lanes as the near load, so the pairs are added across the whole tile
+// before the coefficient is multiplied in.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+void block_folded_dot_product_sse(const float* coeffs,
+                                  int pairs,
+                                  const float* history,
+                                  const float* mirror,
+                                  float* outputs,
+                                  int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        const float* x = history - k - 3;
+        const float* m = mirror - k - 3;
+
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+
+        for (int j = 0; j < pairs; ++j)
+        {
+            const __m128 c = _mm_set1_ps(coeffs[j]);
+            const __m128 s0 =
+                _mm_add_ps(_mm_loadu_ps(x + j), _mm_loadu_ps(m - j));
+            const __m128 s1 =
+                _mm_add_ps(_mm_loadu_ps(x + j - 4), _mm_loadu_ps(m - j - 4));
+            const __m128 s2 =
+                _mm_add_ps(_mm_loadu_ps(x + j - 8), _mm_loadu_ps(m - j - 8));
+            const __m128 s3 = _mm_add_ps(_mm_loadu_ps(x + j - 12),
+                                         _mm_loadu_ps(m - j - 12));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(c, s0));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(c, s1));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(c, s2));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(c, s3));
+        }
+
+        const __m128 accs[4] = {acc0, acc1, acc2, acc3};
+        for (int a = 0; a < 4; ++a)
+        {
+            float* out = outputs + k + 4 * a;
+            _mm_storeu_ps(out,
+                          _mm_add_ps(_mm_loadu_ps(out),
+                                     _mm_shuffle_ps(accs[a],
+                                                    accs[a],
+                                                    _MM_SHUFFLE(0, 1, 2, 3))));
+        }
+    }
+
+    block_folded_dot_product_scalar(
+        coeffs, pairs, history - k, mirror - k, outputs + k, count - k);
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 block kernel, thirty-two outputs at a time in four FMA accumulators,
+// laid out as in the SSE kernel. Each coefficient is broadcast once for all
+// of them and there is no horizontal sum, where a dot product per output
+// broadcasts nothing but reduces every output. The rest are fused too.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+void block_dot_product_avx2(const float* coeffs,
+                            int length,
+                            const float* history,
+                            float* outputs,
+                            int count)
+{
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    int k = 0;
+    for (; k + 32 <= count; k += 32)
+    {
+        const float* x = history - k - 7;
+
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        for (int j = 0; j < length; ++j)
+        {
+            const __m256 c = _mm256_broadcast_ss(coeffs + j);
+            acc0 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + j), acc0);
+            acc1 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + j - 8), acc1);
+            acc2 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + j - 16), acc2);
+            acc3 = _mm256_fmadd_ps(c, _mm256_loadu_ps(x + j - 24), acc3);
+        }
+
+        const __m256 accs[4] = {acc0, acc1, acc2, acc3};
+        for (int a = 0; a < 4; ++a)
+        {
+            float* out = outputs + k + 8 * a;
+            _mm256_storeu_ps(
+                out,
+                _mm256_add_ps(_mm256_loadu_ps(out),
+                              _mm256_permutevar8x32_ps(accs[a], reverse)));
+        }
+    }
+
+    block_dot_product_fused(
+        coeffs, length, history - k, outputs + k, count - k);
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 folded block kernel, laid out as the AVX2 block kernel with the pairs
+// added as in the SSE folded kernel.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+void block_folded_dot_product_avx2(const float* coeffs,
+                                   int pairs,
+                                   const float* history,
+                                   const float* mirror,
+                                   float* outputs,
+                                   int count)
+{
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    int k = 0;
+    for (; k + 32 <= count; k += 32)
+    {
+        const float* x = history - k - 7;
+        const float* m = mirror - k - 7;
+
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+
+        for (int j = 0; j < pairs; ++j)
+        {
+            const __m256 c = _mm256_broadcast_ss(coeffs + j);
+            const __m256 s0 =
+                _mm256_add_ps(_mm256_loadu_ps(x + j), _mm256_loadu_ps(m - j));
+            const __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(x + j - 8),
+                                            _mm256_loadu_ps(m - j - 8));
+            const __m256 s2 = _mm256_add_ps(_mm256_loadu_ps(x + j - 16),
+                                            _mm256_loadu_ps(m - j - 16));
+            const __m256 s3 = _mm256_add_ps(_mm256_loadu_ps(x + j - 24),
+                                            _mm256_loadu_ps(m - j - 24));
+            acc0 = _mm256_fmadd_ps(c, s0, acc0);
+            acc1 = _mm256_fmadd_ps(c, s1, acc1);
+            acc2 = _mm256_fmadd_ps(c, s2, acc2);
+            acc3 = _mm256_fmadd_ps(c, s3, acc3);
+        }
+
+        const __m256 accs[4] = {acc0, acc1, acc2, acc3};
+        for (int a = 0; a < 4; ++a)
+        {
+            float* out = outputs + k + 8 * a;
+            _mm256_storeu_ps(
+                out,
+                _mm256_add_ps(_mm256_loadu_ps(out),
+                              _mm256_permutevar8x32_ps(accs[a], reverse)));
+        }
+    }
+
+    block_folded_dot_product_fused(
+        coeffs, pairs, history - k, mirror - k, outputs + k, count - k);
+}
+#endif
+
+#ifdef FIR_NEON
+// -----------------------------------------------------------------------------
+// NEON block kernel, sixteen outputs at a time in four FMA accumulators, laid
+// out as in the SSE kernel. The rest are fused too.
+// -----------------------------------------------------------------------------
+void block_dot_product_neon(const float* coeffs,
+                            int length,
+                            const float* history,
+                            float* outputs,
+                            int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        const float* x = history - k - 3;
+
+        float32x4_t acc[4] = {vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f)};
+
+        for (int j = 0; j < length; ++j)
+        {
+            const float c = coeffs[j];
+            acc[0] = vfmaq_n_f32(acc[0], vld1q_f32(x + j), c);
+            acc[1] = vfmaq_n_f32(acc[1], vld1q_f32(x + j - 4), c);
+            acc[2] = vfmaq_n_f32(acc[2], vld1q_f32(x + j - 8), c);
+            acc[3] = vfmaq_n_f32(acc[3], vld1q_f32(x + j - 12), c);
+        }
+
+        for (int a = 0; a < 4; ++a)
+        {
+            // reverse the lanes of each half, then swap the halves
+            const float32x4_t pairs = vrev64q_f32(acc[a]);
+            const float32x4_t reversed =
+                vcombine_f32(vget_high_f32(pairs), vget_low_f32(pairs));
+
+            float* out = outputs + k + 4 * a;
+            vst1q_f32(out, vaddq_f32(vld1q_f32(out), reversed));
+        }
+    }
+
+    block_dot_product_fused(
+        coeffs, length, history - k, outputs + k, count - k);
+}
+
+// -----------------------------------------------------------------------------
+// NEON folded block kernel, laid out as the NEON block kernel with the pairs
+// added as in the SSE folded kernel.
+// -----------------------------------------------------------------------------
+void block_folded_dot_product_neon(const float* coeffs,
+                                   int pairs,
+                                   const float* history,
+                                   const float* mirror,
+                                   float* outputs,
+                                   int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        const float* x = history - k - 3;
+        const float* m = mirror - k - 3;
+
+        float32x4_t acc[4] = {vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f)};
+
+        for (int j = 0; j < pairs; ++j)
+        {
+            const float c = coeffs[j];
+            for (int a = 0; a < 4; ++a)
+            {
+                const float32x4_t pair = vaddq_f32(vld1q_f32(x + j - 4 * a),
+                                                   vld1q_f32(m - j - 4 * a));
+                acc[a] = vfmaq_n_f32(acc[a], pair, c);
+            }
+        }
+
+        for (int a = 0; a < 4; ++a)
+        {
+            const float32x4_t pairs_reversed = vrev64q_f32(acc[a]);
+            const float32x4_t reversed =
+                vcombine_f32(vget_high_f32(pairs_reversed),
+                             vget_low_f32(pairs_reversed));
+
+            float* out = outputs + k + 4 * a;
+            vst1q_f32(out, vaddq_f32(vld1q_f32(out), reversed));
+        }
+    }
+
+    block_folded_dot_product_fused(
+        coeffs, pairs, history - k, mirror - k, outputs + k, count - k);
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Adds value to a Kahan compensated sum, carrying the low order bits that the
+// add rounds off in comp so that the next add puts them back.
+// -----------------------------------------------------------------------------
+static void kahan_add(float* sum, float* comp, float value)
+{
+    const float y = value - *comp;
+    const float t = *sum + y;
+    *comp = (t - *sum) - y;
+    *sum = t;
+}
+
+// -----------------------------------------------------------------------------
+// Portable kernel summing float products in double. The product of two floats
+// is exact in double, so the only rounding is in the adds, 29 bits further
+// down than in float.
+// -----------------------------------------------------------------------------
+double dot_product_wide_scalar(const float* coeffs,
+                               const float* samples,
+                               int length)
+{
+    double sum = 0.0;
+    for (int j = 0; j < length; ++j) sum += (double)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Portable kernel summing float products in float with Kahan compensation, so
+// the error of the sum stays a few roundings whatever the length.
+// -----------------------------------------------------------------------------
+float dot_product_compensated_scalar(const float* coeffs,
+                                     const float* samples,
+                                     int length)
+{
+    float sum = 0.0f;
+    float comp = 0.0f;
+    for (int j = 0; j < length; ++j)
+        kahan_add(&sum, &comp, coeffs[j] * samples[j]);
+
+    return sum - comp;
+}
+
+// -----------------------------------------------------------------------------
+// Portable double kernel.
+// -----------------------------------------------------------------------------
+double dot_product_double_scalar(const double* coeffs,
+                                 const double* samples,
+                                 int length)
+{
+    double sum = 0.0;
+    for (int j = 0; j < length; ++j) sum += coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Sums the lanes of compensated accumulators, and their compensations, into
+// one compensated sum, then adds the taps from j on.
+// -----------------------------------------------------------------------------
+static float finish_compensated(const float* sums,
+                                const float* comps,
+                                int lanes,
+                                const float* coeffs,
+                                const float* samples,
+                                int j,
+                                int length)
+{
+    float sum = 0.0f;
+    float comp = 0.0f;
+    for (int lane = 0; lane < lanes; ++lane)
+    {
+        kahan_add(&sum, &comp, sums[lane]);
+        kahan_add(&sum, &comp, -comps[lane]);
+    }
+
+    for (; j < length; ++j) kahan_add(&sum, &comp, coeffs[j] * samples[j]);
+
+    return sum - comp;
+}
+
+#ifdef FIR_X86
+// -----------------------------------------------------------------------------
+// SSE2 kernel summing float products in double, two pairs of lanes deep.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+double dot_product_wide_sse(const float* coeffs,
+                            const float* samples,
+                            int length)
+{
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const __m128 c = _mm_loadu_ps(coeffs + j);
+        const __m128 x = _mm_loadu_ps(samples + j);
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_cvtps_pd(c), _mm_cvtps_pd(x)));
+        acc1 = _mm_add_pd(acc1,
+                          _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(c, c)),
+                                     _mm_cvtps_pd(_mm_movehl_ps(x, x))));
+    }
+
+    const __m128d acc = _mm_add_pd(acc0, acc1);
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; j < length; ++j) sum += (double)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// SSE kernel summing float products with Kahan compensation in each lane, two
+// sums deep, since each compensated add waits on the last.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+float dot_product_compensated_sse(const float* coeffs,
+                                  const float* samples,
+                                  int length)
+{
+    __m128 sum[2] = {_mm_setzero_ps(), _mm_setzero_ps()};
+    __m128 comp[2] = {_mm_setzero_ps(), _mm_setzero_ps()};
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        for (int a = 0; a < 2; ++a)
+        {
+            const __m128 y = _mm_sub_ps(
+                _mm_mul_ps(_mm_loadu_ps(coeffs + j + 4 * a),
+                           _mm_loadu_ps(samples + j + 4 * a)),
+                comp[a]);
+            const __m128 t = _mm_add_ps(sum[a], y);
+            comp[a] = _mm_sub_ps(_mm_sub_ps(t, sum[a]), y);
+            sum[a] = t;
+        }
+    }
+
+    float sums[8];
+    float comps[8];
+    _mm_storeu_ps(sums, sum[0]);
+    _mm_storeu_ps(sums + 4, sum[1]);
+    _mm_storeu_ps(comps, comp[0]);
+    _mm_storeu_ps(comps + 4, comp[1]);
+
+    return finish_compensated(sums, comps, 8, coeffs, samples, j, length);
+}
+
+// -----------------------------------------------------------------------------
+// SSE2 double kernel, two accumulators of two lanes.
+// -----------------------------------------------------------------------------
+FIR_TARGET("sse2")
+double dot_product_double_sse(const double* coeffs,
+                              const double* samples,
+                              int length)
+{
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        acc0 = _mm_add_pd(acc0,
+                          _mm_mul_pd(_mm_loadu_pd(coeffs + j),
+                                     _mm_loadu_pd(samples + j)));
+        acc1 = _mm_add_pd(acc1,
+                          _mm_mul_pd(_mm_loadu_pd(coeffs + j + 2),
+                                     _mm_loadu_pd(samples + j + 2)));
+    }
+
+    const __m128d acc = _mm_add_pd(acc0, acc1);
+    double sum = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+    for (; j < length; ++j) sum += coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 kernel summing float products in double, two accumulators of four
+// lanes. The products are exact, so fusing them into the adds changes
+// nothing.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+double dot_product_wide_avx2(const float* coeffs,
+                             const float* samples,
+                             int length)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        acc0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(coeffs + j)),
+                               _mm256_cvtps_pd(_mm_loadu_ps(samples + j)),
+                               acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(coeffs + j + 4)),
+                               _mm256_cvtps_pd(_mm_loadu_ps(samples + j + 4)),
+                               acc1);
+    }
+
+    const __m256d acc = _mm256_add_pd(acc0, acc1);
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc),
+                                    _mm256_extractf128_pd(acc, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; j < length; ++j) sum += (double)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 kernel summing float products with Kahan compensation in each lane,
+// two sums deep as in the SSE kernel. The products are rounded before the
+// compensated add, as in the scalar kernel, rather than fused into it.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2")
+float dot_product_compensated_avx2(const float* coeffs,
+                                   const float* samples,
+                                   int length)
+{
+    __m256 sum[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+    __m256 comp[2] = {_mm256_setzero_ps(), _mm256_setzero_ps()};
+
+    int j = 0;
+    for (; j + 16 <= length; j += 16)
+    {
+        for (int a = 0; a < 2; ++a)
+        {
+            const __m256 y = _mm256_sub_ps(
+                _mm256_mul_ps(_mm256_loadu_ps(coeffs + j + 8 * a),
+                              _mm256_loadu_ps(samples + j + 8 * a)),
+                comp[a]);
+            const __m256 t = _mm256_add_ps(sum[a], y);
+            comp[a] = _mm256_sub_ps(_mm256_sub_ps(t, sum[a]), y);
+            sum[a] = t;
+        }
+    }
+
+    float sums[16];
+    float comps[16];
+    _mm256_storeu_ps(sums, sum[0]);
+    _mm256_storeu_ps(sums + 8, sum[1]);
+    _mm256_storeu_ps(comps, comp[0]);
+    _mm256_storeu_ps(comps + 8, comp[1]);
+
+    return finish_compensated(sums, comps, 16, coeffs, samples, j, length);
+}
+
+// -----------------------------------------------------------------------------
+// AVX2 double kernel, two FMA accumulators of four lanes.
+// -----------------------------------------------------------------------------
+FIR_TARGET("avx2,fma")
+double dot_product_double_avx2(const double* coeffs,
+                               const double* samples,
+                               int length)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+
+    int j = 0;
+    for (; j + 8 <= length; j += 8)
+    {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(coeffs + j),
+                               _mm256_loadu_pd(samples + j),
+                               acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(coeffs + j + 4),
+                               _mm256_loadu_pd(samples + j + 4),
+                               acc1);
+    }
+
+    const __m256d acc = _mm256_add_pd(acc0, acc1);
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc),
+                                    _mm256_extractf128_pd(acc, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; j < length; ++j) sum += coeffs[j] * samples[j];
+
+    return sum;
+}
+#endif
+
+#ifdef FIR_NEON
+// -----------------------------------------------------------------------------
+// NEON kernel summing float products in double, widening each half of four
+// floats into its own accumulator.
+// -----------------------------------------------------------------------------
+double dot_product_wide_neon(const float* coeffs,
+                             const float* samples,
+                             int length)
+{
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const float32x4_t c = vld1q_f32(coeffs + j);
+        const float32x4_t x = vld1q_f32(samples + j);
+        acc0 = vfmaq_f64(acc0,
+                         vcvt_f64_f32(vget_low_f32(c)),
+                         vcvt_f64_f32(vget_low_f32(x)));
+        acc1 = vfmaq_f64(acc1, vcvt_high_f64_f32(c), vcvt_high_f64_f32(x));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+    for (; j < length; ++j) sum += (double)coeffs[j] * samples[j];
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// NEON kernel summing float products with Kahan compensation in each lane.
+// -----------------------------------------------------------------------------
+float dot_product_compensated_neon(const float* coeffs,
+                                   const float* samples,
+                                   int length)
+{
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    float32x4_t comp = vdupq_n_f32(0.0f);
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        const float32x4_t y = vsubq_f32(
+            vmulq_f32(vld1q_f32(coeffs + j), vld1q_f32(samples + j)), comp);
+        const float32x4_t t = vaddq_f32(sum, y);
+        comp = vsubq_f32(vsubq_f32(t, sum), y);
+        sum = t;
+    }
+
+    float sums[4];
+    float comps[4];
+    vst1q_f32(sums, sum);
+    vst1q_f32(comps, comp);
+
+    return finish_compensated(sums, comps, 4, coeffs, samples, j, length);
+}
+
+// -----------------------------------------------------------------------------
+// NEON double kernel, two FMA accumulators of two lanes.
+// -----------------------------------------------------------------------------
+double dot_product_double_neon(const double* coeffs,
+                               const double* samples,
+                               int length)
+{
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+
+    int j = 0;
+    for (; j + 4 <= length; j += 4)
+    {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(coeffs + j), vld1q_f64(samples + j));
+        acc1 = vfmaq_f64(
+            acc1, vld1q_f64(coeffs + j + 2), vld1q_f64(samples + j + 2));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(acc0, acc1));
+    for (; j < length; ++j) sum += coeffs[j] * samples[j];
+
+    return sum;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Looks up the dot product kernel for an instruction set. Levels that were not
+// compiled for this architecture fall back to the scalar kernel; callers are
+// expected to have checked cpu_supports first.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_fn fir_dot_product_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_sse;
+    case SIMD_AVX2: return dot_product_avx2;
+    case SIMD_AVX512: return dot_product_avx512;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_neon;
+#endif
+    default: return dot_product_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the folded dot product kernel for an instruction set. Folded
+// kernels only use the first half of the coefficients and are only valid for
+// coefficients that pass fir_is_symmetric.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_fn fir_folded_dot_product_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_folded_sse;
+    case SIMD_AVX2: return dot_product_folded_avx2;
+    case SIMD_AVX512: return dot_product_folded_avx512;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_folded_neon;
+#endif
+    default: return dot_product_folded_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the Q15 dot product kernel for an instruction set. AVX-512 uses the
+// AVX2 kernel, since 512 bit pmaddwd needs AVX-512BW on top of the foundation
+// that SIMD_AVX512 checks for.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_q15_fn fir_dot_product_q15_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_q15_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_q15_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_q15_neon;
+#endif
+    default: return dot_product_q15_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the Q31 dot product kernel for an instruction set. SSE2 has no
+// signed 32 bit widening multiply, so SIMD_SSE uses the scalar kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_q31_fn fir_dot_product_q31_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_q31_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_q31_neon;
+#endif
+    default: return dot_product_q31_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the four row dot product kernel for an instruction set. AVX-512
+// uses the AVX2 kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_4_fn fir_dot_product_4_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_4_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_4_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_4_neon;
+#endif
+    default: return dot_product_4_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the block kernel for an instruction set. AVX-512 uses the AVX2
+// kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+block_dot_product_fn fir_block_dot_product_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return block_dot_product_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return block_dot_product_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return block_dot_product_neon;
+#endif
+    default: return block_dot_product_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the folded block kernel for an instruction set. AVX-512 uses the
+// AVX2 kernel. Only valid for coefficients that pass fir_is_symmetric.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+block_folded_dot_product_fn fir_block_folded_dot_product_kernel(
+    enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return block_folded_dot_product_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return block_folded_dot_product_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return block_folded_dot_product_neon;
+#endif
+    default: return block_folded_dot_product_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the kernel summing float products in double for an instruction
+// set. AVX-512 uses the AVX2 kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_wide_fn fir_dot_product_wide_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_wide_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_wide_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_wide_neon;
+#endif
+    default: return dot_product_wide_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the Kahan compensated kernel for an instruction set. AVX-512 uses
+// the AVX2 kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_fn fir_dot_product_compensated_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_compensated_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_compensated_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_compensated_neon;
+#endif
+    default: return dot_product_compensated_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Looks up the double kernel for an instruction set. AVX-512 uses the AVX2
+// kernel.
+//
+// Arguments:
+//     level - instruction set of the kernel
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_double_fn fir_dot_product_double_kernel(enum simd_level level)
+{
+    switch (level)
+    {
+#ifdef FIR_X86
+    case SIMD_SSE: return dot_product_double_sse;
+    case SIMD_AVX2:
+    case SIMD_AVX512: return dot_product_double_avx2;
+#endif
+#ifdef FIR_NEON
+    case SIMD_NEON: return dot_product_double_neon;
+#endif
+    default: return dot_product_double_scalar;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Filters consecutive outputs tap-major with a block kernel, in tiles of
+// FIR_OUTPUT_TILE outputs by FIR_TAP_TILE taps so that everything a tile
+// touches stays in L1. Tap tiles always start at multiples of FIR_TAP_TILE, so
+// each output is rounded the same however the outputs are split between
+// calls. Given a folded kernel, the taps are tiled by pairs instead, each tile
+// reading its near samples from the start of the window and its far ones from
+// the end, and an odd middle tap is added by the plain kernel.
+//
+// Arguments:
+//     kernel  - block kernel
+//     folded  - folded block kernel for symmetric coefficients, or NULL
+//     coeffs  - filter coefficients
+//     length  - number of coefficients
+//     history - window of the first output, newest sample first, with each
+//               later output's window starting one sample before it
+//     outputs - receives count outputs
+//     count   - number of outputs
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void fir_filter_line(block_dot_product_fn kernel,
+                     block_folded_dot_product_fn folded,
+                     const float* coeffs,
+                     int length,
+                     const float* history,
+                     float* outputs,
+                     size_t count)
+{
+    memset(outputs, 0, count * sizeof(float));
+
+    const int taps = folded ? length / 2 : length;
+    const float* mirror = history + length - 1;
+
+    for (size_t k = 0; k < count; k += FIR_OUTPUT_TILE)
+    {
+        const int tile_outputs =
+            (int)(count - k < FIR_OUTPUT_TILE ? count - k : FIR_OUTPUT_TILE);
+
+        for (int t = 0; t < taps; t += FIR_TAP_TILE)
+        {
+            const int tile_taps =
+                taps - t < FIR_TAP_TILE ? taps - t : FIR_TAP_TILE;
+
+            if (folded)
+            {
+                folded(coeffs + t,
+                       tile_taps,
+                       history - k + t,
+                       mirror - k - t,
+                       outputs + k,
+                       tile_outputs);
+            }
+            else
+            {
+                kernel(coeffs + t,
+                       tile_taps,
+                       history - k + t,
+                       outputs + k,
+                       tile_outputs);
+            }
+        }
+
+        if (folded && length % 2)
+        {
+            kernel(coeffs + taps,
+                   1,
+                   history - k + taps,
+                   outputs + k,
+                   tile_outputs);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether coefficients read the same forwards and backwards, as every
+// linear phase design does, so that a folded kernel gives the same result.
+//
+// Arguments:
+//     coeffs - filter coefficients
+//     length - number of coefficients
+//
+// Returns:
+//     true if coeffs[j] == coeffs[length - 1 - j] for every j
+// -----------------------------------------------------------------------------
+bool fir_is_symmetric(const float* coeffs, int length)
+{
+    for (int j = 0; j < length / 2; ++j)
+    {
+        if (coeffs[j] != coeffs[length - 1 - j])
+            return false;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Picks the fastest kernel for a set of coefficients: the folded one when they
+// are symmetric and folding pays for this instruction set and length, the
+// plain one otherwise.
+//
+// Arguments:
+//     level  - instruction set of the kernel
+//     coeffs - filter coefficients
+//     length - number of coefficients
+//
+// Returns:
+//     pointer to kernel
+// -----------------------------------------------------------------------------
+dot_product_fn fir_select_kernel(enum simd_level level,
+                                 const float* coeffs,
+                                 int length)
+{
+    const bool wide = level == SIMD_AVX2 || level == SIMD_AVX512;
+
+    if ((!wide || length >= FIR_FOLD_WIDE_MIN_TAPS) &&
+        fir_is_symmetric(coeffs, length))
+        return fir_folded_dot_product_kernel(level);
+
+    return fir_dot_product_kernel(level);
+}
+
+// -----------------------------------------------------------------------------
+// Picks the folded block kernel for fir_filter_line when the coefficients are
+// symmetric and folding pays for this instruction set and length.
+//
+// Arguments:
+//     level  - instruction set of the kernel
+//     coeffs - filter coefficients
+//     length - number of coefficients
+//
+// Returns:
+//     pointer to kernel, or NULL to filter with the plain block kernel
+// -----------------------------------------------------------------------------
+block_folded_dot_product_fn fir_select_block_folded_kernel(
+    enum simd_level level,
+    const float* coeffs,
+    int length)
+{
+    const bool wide = level == SIMD_AVX2 || level == SIMD_AVX512;
+    const int min_taps =
+        wide ? FIR_FOLD_BLOCK_WIDE_MIN_TAPS : FIR_FOLD_BLOCK_MIN_TAPS;
+
+    if (length < min_taps || !fir_is_symmetric(coeffs, length))
+        return NULL;
+
+    return fir_block_folded_dot_product_kernel(level);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu_features.h"
+
+// Multiplies filter coefficients with a contiguous history, newest sample
+// first, and returns the sum of the products.
+typedef float (*dot_product_fn)(const float* coeffs,
+                                const float* history,
+                                int length);
+
+float dot_product_scalar(const float* coeffs, const float* history, int length);
+
+dot_product_fn fir_dot_product_kernel(enum simd_level level);
+
+dot_product_fn fir_folded_dot_product_kernel(enum simd_level level);
+
+// Integer counterparts for the fixed point path. Both take coefficients and
+// samples in the same order and return the exact sum of the products; the
+// caller scales the coefficients so that the sum cannot overflow.
+typedef int32_t (*dot_product_q15_fn)(const int16_t* coeffs,
+                                      const int16_t* samples,
+                                      int length);
+
+typedef int64_t (*dot_product_q31_fn)(const int32_t* coeffs,
+                                      const int32_t* samples,
+                                      int length);
+
+dot_product_q15_fn fir_dot_product_q15_kernel(enum simd_level level);
+
+dot_product_q31_fn fir_dot_product_q31_kernel(enum simd_level level);
+
+// Higher precision counterparts for long filters. The wide kernel sums float
+// products in double, the compensated kernel sums them in float with Kahan
+// compensation, and the double kernel takes doubles throughout. All take
+// coefficients and samples in the same order, as the fixed point kernels do.
+typedef double (*dot_product_wide_fn)(const float* coeffs,
+                                      const float* samples,
+                                      int length);
+
+typedef double (*dot_product_double_fn)(const double* coeffs,
+                                        const double* samples,
+                                        int length);
+
+dot_product_wide_fn fir_dot_product_wide_kernel(enum simd_level level);
+
+dot_product_fn fir_dot_product_compensated_kernel(enum simd_level level);
+
+dot_product_double_fn fir_dot_product_double_kernel(enum simd_level level);
+
+// Multiplies four rows of coefficients, stride floats apart, with the same
+// history and writes the four sums, so that a filter bank loads each sample
+// once for four filters.
+typedef void (*dot_product_4_fn)(const float* coeffs,
+                                 int stride,
+                                 const float* history,
+                                 int length,
+                                 float* sums);
+
+dot_product_4_fn fir_dot_product_4_kernel(enum simd_level level);
+
+// Adds count consecutive outputs of one run of taps to outputs, working tap by
+// tap across all of them. history is newest sample first, as for
+// dot_product_fn, and each output's history starts one sample before the
+// last's: outputs[k] += sum of coeffs[j] * history[j - k].
+typedef void (*block_dot_product_fn)(const float* coeffs,
+                                     int length,
+                                     const float* history,
+                                     float* outputs,
+                                     int count);
+
+block_dot_product_fn fir_block_dot_product_kernel(enum simd_level level);
+
+// Folded counterpart of the block kernel for symmetric coefficients. Each
+// output's far samples are read backwards from mirror, the oldest sample of
+// the first output's window: outputs[k] += sum of
+// coeffs[j] * (history[j - k] + mirror[-j - k]) over pairs coefficients.
+typedef void (*block_folded_dot_product_fn)(const float* coeffs,
+                                            int pairs,
+                                            const float* history,
+                                            const float* mirror,
+                                            float* outputs,
+                                            int count);
+
+block_folded_dot_product_fn fir_block_folded_dot_product_kernel(
+    enum simd_level level);
+
+void fir_filter_line(block_dot_product_fn kernel,
+                     block_folded_dot_product_fn folded,
+                     const float* coeffs,
+                     int length,
+                     const float* history,
+                     float* outputs,
+                     size_t count);
+
+bool fir_is_symmetric(const float* coeffs, int length);
+
+dot_product_fn fir_select_kernel(enum simd_level level,
+                                 const float* coeffs,
+                                 int length);
+
+block_folded_dot_product_fn fir_select_block_folded_kernel(
+    enum simd_level level,
+    const float* coeffs,
+    int length);
@@ -0,0 +1,295 @@
+
+#include "fixed_fir.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fir_kernels.h"
+#include "workspace.h"
+
+// Largest and smallest output sample at each width. 24 bit samples are held
+// as in sf_readf_int, in the top three bytes of an int32.
+#define FIXED_FIR_MAX_16 32767
+#define FIXED_FIR_MIN_16 (-32768)
+#define FIXED_FIR_MAX_24 8388607
+#define FIXED_FIR_MIN_24 (-8388608)
+
+// -----------------------------------------------------------------------------
+// Struct containing an FIR filter in integer arithmetic, for 16 bit samples
+// with Q15 coefficients or 24 bit samples with Q31 coefficients.
+//
+// Coefficients are scaled by 2^coeff_shift and rounded. The shift is as large
+// as the accumulator allows: for 16 bit samples the sum of the coefficient
+// magnitudes times full scale must fit the 32 bit sum pmaddwd produces, which
+// gives Q15 for any filter whose magnitudes sum below 2, while 24 bit samples
+// summed in 64 bits always get Q31. No input can then overflow, and each
+// output is the exact sum rounded to nearest once, at the output width.
+//
+// Each channel has a line holding filter_length - 1 samples of history then
+// a block of input, oldest first, and the coefficients are stored reversed,
+// so every output is a forward dot product from its oldest tap.
+// -----------------------------------------------------------------------------
+typedef struct fixed_fir
+{
+    int filter_length;
+    int channel_count;
+    int sample_bits;
+    int coeff_shift;
+    size_t block_frames;
+    size_t line_length;
+    int16_t* coeffs_q15;
+    int32_t* coeffs_q31;
+    void* lines;
+    dot_product_q15_fn dot_product_q15;
+    dot_product_q31_fn dot_product_q31;
+} fixed_fir_t;
+
+int quantise_coeffs(fixed_fir_t* fir, const float* coeffs);
+
+void process_16(fixed_fir_t* fir, int16_t* audio_buffer, size_t frames);
+
+void process_24(fixed_fir_t* fir, int32_t* audio_buffer, size_t frames);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes fixed_fir_init needs for a filter, its coefficients and its
+// history.
+//
+// Arguments:
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels
+//     sample_bits   - 16 or 24
+//     block_frames  - most frames passed to one fixed_fir_process call
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t fixed_fir_size(int filter_length,
+                      int channels,
+                      int sample_bits,
+                      size_t block_frames)
+{
+    const size_t sample_size =
+        sample_bits == 16 ? sizeof(int16_t) : sizeof(int32_t);
+    const size_t line_length = (size_t)filter_length - 1 + block_frames;
+
+    return workspace_round(sizeof(fixed_fir_t)) +
+           workspace_round((size_t)filter_length * sample_size) +
+           workspace_round(line_length * channels * sample_size);
+}
+
+// -----------------------------------------------------------------------------
+// Builds a fixed_fir_t object in memory and quantises the coefficients.
+//
+// Arguments:
+//     memory        - fixed_fir_size bytes of zeroed memory
+//     coeffs        - float coefficients, as designed for the float path
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels
+//     sample_bits   - 16 or 24
+//     block_frames  - most frames passed to one fixed_fir_process call
+//     level         - instruction set of the tap kernel
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if the sample
+//     width is not supported or the coefficients cannot be quantised
+// -----------------------------------------------------------------------------
+fixed_fir_t* fixed_fir_init(void* memory,
+                            const float* coeffs,
+                            int filter_length,
+                            int channels,
+                            int sample_bits,
+                            size_t block_frames,
+                            enum simd_level level)
+{
+    if (sample_bits != 16 && sample_bits != 24)
+        return NULL;
+
+    const size_t sample_size =
+        sample_bits == 16 ? sizeof(int16_t) : sizeof(int32_t);
+
+    unsigned char* cursor = (unsigned char*)memory;
+    fixed_fir_t* fir =
+        (fixed_fir_t*)workspace_carve(&cursor, sizeof(fixed_fir_t));
+
+    fir->filter_length = filter_length;
+    fir->channel_count = channels;
+    fir->sample_bits = sample_bits;
+    fir->block_frames = block_frames;
+    fir->line_length = (size_t)filter_length - 1 + block_frames;
+    fir->dot_product_q15 = fir_dot_product_q15_kernel(level);
+    fir->dot_product_q31 = fir_dot_product_q31_kernel(level);
+
+    void* quantised =
+        workspace_carve(&cursor, (size_t)filter_length * sample_size);
+    if (sample_bits == 16)
+        fir->coeffs_q15 = (int16_t*)quantised;
+    else
+        fir->coeffs_q31 = (int32_t*)quantised;
+
+    fir->lines =
+        workspace_carve(&cursor, fir->line_length * channels * sample_size);
+
+    return quantise_coeffs(fir, coeffs) ? fir : NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved samples in place, continuing from the
+// previous call.
+//
+// Arguments:
+//     fir          - pointer to fixed point filter data
+//     audio_buffer - int16_t samples for 16 bit, int32_t for 24 bit
+//     frames       - length of buffer
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void fixed_fir_process(fixed_fir_t* fir, void* audio_buffer, size_t frames)
+{
+    const int channels = fir->channel_count;
+
+    for (size_t done = 0; done < frames; done += fir->block_frames)
+    {
+        const size_t block = frames - done < fir->block_frames
+                                 ? frames - done
+                                 : fir->block_frames;
+
+        if (fir->sample_bits == 16)
+            process_16(fir, (int16_t*)audio_buffer + done * channels, block);
+        else
+            process_24(fir, (int32_t*)audio_buffer + done * channels, block);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Clears the history, as though the next sample were the first.
+// -----------------------------------------------------------------------------
+void fixed_fir_reset(fixed_fir_t* fir)
+{
+    const size_t sample_size =
+        fir->sample_bits == 16 ? sizeof(int16_t) : sizeof(int32_t);
+    memset(fir->lines, 0, fir->line_length * fir->channel_count * sample_size);
+}
+
+// -----------------------------------------------------------------------------
+// Scales, rounds and reverses the coefficients with the largest shift for
+// which no coefficient overflows its type and no output overflows its
+// accumulator.
+//
+// Returns:
+//     nonzero on success, 0 if the coefficients are too large for any shift
+// -----------------------------------------------------------------------------
+int quantise_coeffs(fixed_fir_t* fir, const float* coeffs)
+{
+    const int length = fir->filter_length;
+    const bool is_16 = fir->sample_bits == 16;
+    const double coeff_max = is_16 ? INT16_MAX : INT32_MAX;
+    const double sample_max = is_16 ? 32768.0 : 8388608.0;
+    const double accumulator_max = is_16 ? INT32_MAX : (double)INT64_MAX;
+
+    for (int shift = is_16 ? 15 : 31; shift > 0; --shift)
+    {
+        const double scale = ldexp(1.0, shift);
+        double magnitude_sum = 0.0;
+        bool fits = true;
+
+        for (int j = 0; j < length && fits; ++j)
+        {
+            const double q = nearbyint(coeffs[j] * scale);
+            fits = fabs(q) <= coeff_max;
+            magnitude_sum += fabs(q);
+        }
+
+        if (!fits || magnitude_sum * sample_max > accumulator_max)
+            continue;
+
+        for (int j = 0; j < length; ++j)
+        {
+            const double q = nearbyint(coeffs[length - 1 - j] * scale);
+            if (is_16)
+                fir->coeffs_q15[j] = (int16_t)q;
+            else
+                fir->coeffs_q31[j] = (int32_t)q;
+        }
+
+        fir->coeff_shift = shift;
+        return 1;
+    }
+
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Filters up to block_frames of 16 bit samples, one channel at a time.
+// -----------------------------------------------------------------------------
+void process_16(fixed_fir_t* fir, int16_t* audio_buffer, size_t frames)
+{
+    const int channels = fir->channel_count;
+    const size_t history = (size_t)fir->filter_length - 1;
+    const int shift = fir->coeff_shift;
+    const int32_t rounding = (int32_t)1 << (shift - 1);
+
+    for (int c = 0; c < channels; ++c)
+    {
+        int16_t* line = (int16_t*)fir->lines + c * fir->line_length;
+
+        for (size_t n = 0; n < frames; ++n)
+            line[history + n] = audio_buffer[n * channels + c];
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            const int32_t sum =
+                fir->dot_product_q15(fir->coeffs_q15, line + n, fir->filter_length);
+
+            int32_t sample = (int32_t)(((int64_t)sum + rounding) >> shift);
+            if (sample > FIXED_FIR_MAX_16)
+                sample = FIXED_FIR_MAX_16;
+            else if (sample < FIXED_FIR_MIN_16)
+                sample = FIXED_FIR_MIN_16;
+
+            audio_buffer[n * channels + c] = (int16_t)sample;
+        }
+
+        memmove(line, line + frames, history * sizeof(int16_t));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Filters up to block_frames of 24 bit samples, one channel at a time. The
+// line holds them shifted down to their 24 bit values so that products with
+// Q31 coefficients fit 55 bits.
+// -----------------------------------------------------------------------------
+void process_24(fixed_fir_t* fir, int32_t* audio_buffer, size_t frames)
+{
+    const int channels = fir->channel_count;
+    const size_t history = (size_t)fir->filter_length - 1;
+    const int shift = fir->coeff_shift;
+    const int64_t rounding = (int64_t)1 << (shift - 1);
+
+    for (int c = 0; c < channels; ++c)
+    {
+        int32_t* line = (int32_t*)fir->lines + c * fir->line_length;
+
+        for (size_t n = 0; n < frames; ++n)
+            line[history + n] = audio_buffer[n * channels + c] >> 8;
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            const int64_t sum =
+                fir->dot_product_q31(fir->coeffs_q31, line + n, fir->filter_length);
+
+            int64_t sample = (sum + rounding) >> shift;
+            if (sample > FIXED_FIR_MAX_24)
+                sample = FIXED_FIR_MAX_24;
+            else if (sample < FIXED_FIR_MIN_24)
+                sample = FIXED_FIR_MIN_24;
+
+            audio_buffer[n * channels + c] = (int32_t)((uint32_t)sample << 8);
+        }
+
+        memmove(line, line + frames, history * sizeof(int32_t));
+    }
+}
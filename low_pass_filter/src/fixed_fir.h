@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "cpu_features.h"
+
+typedef struct fixed_fir fixed_fir_t;
+
+size_t fixed_fir_size(int filter_length,
+                      int channels,
+                      int sample_bits,
+                      size_t block_frames);
+
+fixed_fir_t* fixed_fir_init(void* memory,
+                            const float* coeffs,
+                            int filter_length,
+                            int channels,
+                            int sample_bits,
+                            size_t block_frames,
+                            enum simd_level level);
+
+void fixed_fir_process(fixed_fir_t* fir, void* audio_buffer, size_t frames);
+
+void fixed_fir_reset(fixed_fir_t* fir);
@@ -1,7 +1,56 @@
 
 #include "low_pass_filter.h"
 
-#include "window_functions.h"
+#include <string.h>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+#include "biquad.h"
+#include "coeff_cache.h"
+#include "cpu_features.h"
+#include "cutoff_bank.h"
+#include "filter_bank.h"
+#include "filter_design.h"
+#include "fir_kernels.h"
+#include "fixed_fir.h"
+#include "mapped_wav.h"
+#include "overlap_save.h"
+#include "parallel_filter.h"
+#include "pipeline.h"
+#include "precise_fir.h"
+#include "stats.h"
+#include "thread.h"
+#include "window_cache.h"
+#include "workspace.h"
+
+// Tap count from which LPF_ENGINE_AUTO switches to FFT overlap-save. Below this
+// the direct form dot product is cheap enough that the transform overhead and
+// its rounding error are not worth paying.
+#define LPF_FFT_CROSSOVER_TAPS 256
+
+// Highest order of the IIR engine. Beyond this the sections nearest the cutoff
+// have so high a Q that float rounding in their feedback shows in the output.
+#define LPF_IIR_MAX_ORDER 16
+
+// File descriptors opened in place of a file named LPF_STDIO_NAME.
+#define LPF_STDIN_FD 0
+#define LPF_STDOUT_FD 1
+
+// Frames of one channel each thread filters per chunk when lpf_filter_file
+// runs on several threads. Large enough that waking the threads is negligible.
+#define LPF_THREAD_SEGMENT_FRAMES 16384
+
+// Frames filtered between coefficient updates when the cutoff follows an
+// envelope. Short enough that each update is a small step and does not click.
+#define LPF_MODULATION_FRAMES 32
+
+// Range of block sizes LPF_BLOCK_AUTO picks from, in frames. Below the least,
+// the cost of each read and write call starts to show.
+#define LPF_AUTO_BLOCK_MIN 64
+#define LPF_AUTO_BLOCK_MAX 16384
 
 // -----------------------------------------------------------------------------
 // Struct containing data needed to low pass filter a buffer of samples.
@@ -12,33 +61,266 @@ typedef struct low_pass_filter
     int order;
     float* coeffs;
     float* past_input_samples;
-    int write_point;
+    int newest_sample;
     enum window_t window_type;
     size_t buffer_size;
     int channel_count;
+    enum lpf_engine engine;
+    overlap_save_t* convolver;
+    biquad_cascade_t* iir;
+    enum lpf_iir_response iir_response;
+    int iir_order;
+    enum simd_level simd_level;
+    dot_product_fn dot_product;
+    block_dot_product_fn block_dot_product;
+    block_folded_dot_product_fn block_folded_dot_product;
+    bool planar;
+    bool auto_block_size;
+    int thread_count;
+    thread_pool_t* thread_pool;
+    int pipeline_depth;
+    coeff_cache_t* coeff_cache;
+    SF_INFO raw_format;
+    int decimation;
+    int decimation_phase;
+    float kaiser_beta;
+    float transition_width;
+    float stopband_attenuation;
+    enum lpf_phase phase;
+    bool delay_compensation;
+    sf_count_t frames_to_trim;
+    float sample_rate;
+    float* envelope_times;
+    float* envelope_cutoffs;
+    size_t envelope_length;
+    size_t envelope_index;
+    float envelope_lowest;
+    float envelope_highest;
+    float manual_cutoff;
+    cutoff_bank_t* cutoff_bank;
+    sf_count_t modulation_frame;
+    enum lpf_arithmetic arithmetic;
+    int fixed_point_bits;
+    fixed_fir_t* fixed_fir;
+    bool precise;
+    precise_fir_t* precise_fir;
+    bool collect_stats;
+    lpf_stats_t stats;
+    unsigned char* workspace;
+    size_t workspace_size;
+    size_t workspace_used;
+    bool workspace_owned;
+    void* input_mapping;
 } low_pass_filter_t;
 
-enum window_t init_filter(low_pass_filter_t* lpf,
+// -----------------------------------------------------------------------------
+// Struct containing data shared by the workers of lpf_filter_batch.
+// -----------------------------------------------------------------------------
+typedef struct batch
+{
+    const low_pass_filter_t* settings;
+    lpf_batch_job_t* jobs;
+    size_t job_count;
+    size_t next_job;
+    mutex_t* mutex;
+} batch_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing a file being filtered, open through libsndfile or, for the
+// uncompressed WAV formats mapped_wav_t handles, mapped into memory.
+// -----------------------------------------------------------------------------
+typedef struct audio_file
+{
+    SNDFILE* sndfile;
+    mapped_wav_t* mapped;
+} audio_file_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing a file being filtered on several threads: the chunk
+// buffer, which keeps the last order input frames of the previous chunk in
+// front of each chunk, and the buffer the parallel filter writes to.
+// -----------------------------------------------------------------------------
+typedef struct threaded_file
+{
+    low_pass_filter_t* lpf;
+    parallel_filter_t* pf;
+    float* input;
+    float* output;
+} threaded_file_t;
+
+enum lpf_error init_filter(low_pass_filter_t* lpf,
                           float sample_rate,
                           int channels,
                           enum window_t window_type);
 
-void filter_buffer(low_pass_filter_t* lpf,
-                   float* audio_buffer,
-                   sf_count_t samples_read);
+sf_count_t filter_buffer(low_pass_filter_t* lpf,
+                         float* audio_buffer,
+                         sf_count_t samples_read);
+
+sf_count_t filter_segment(low_pass_filter_t* lpf,
+                          float* audio_buffer,
+                          sf_count_t frames_read);
+
+sf_count_t filter_buffer_planar(low_pass_filter_t* lpf,
+                                float* audio_buffer,
+                                sf_count_t frames_read);
+
+sf_count_t decimate_buffer(low_pass_filter_t* lpf,
+                           float* audio_buffer,
+                           sf_count_t frames_read);
+
+enum lpf_error filter_file_serial(low_pass_filter_t* lpf,
+                                  audio_file_t* input_wav,
+                                  audio_file_t* output_wav,
+                                  sf_count_t frames_to_process,
+                                  sf_count_t* frames_processed);
+
+enum lpf_error filter_file_threaded(low_pass_filter_t* lpf,
+                                    audio_file_t* input_wav,
+                                    audio_file_t* output_wav,
+                                    sf_count_t frames_to_process,
+                                    sf_count_t* frames_processed);
+
+enum lpf_error filter_file_fixed(low_pass_filter_t* lpf,
+                                 audio_file_t* input_wav,
+                                 audio_file_t* output_wav,
+                                 sf_count_t frames_to_process,
+                                 sf_count_t* frames_processed);
+
+enum lpf_error filter_file_precise(low_pass_filter_t* lpf,
+                                   audio_file_t* input_wav,
+                                   audio_file_t* output_wav,
+                                   sf_count_t frames_to_process,
+                                   sf_count_t* frames_processed);
+
+enum lpf_error filter_file_bank(low_pass_filter_t* lpf,
+                                filter_bank_t* bank,
+                                audio_file_t* input_wav,
+                                audio_file_t* output_wavs,
+                                size_t band_count,
+                                sf_count_t frames_to_process,
+                                sf_count_t* frames_processed);
+
+enum lpf_error apply_design_spec(low_pass_filter_t* lpf,
+                                 float highest_cutoff,
+                                 float sample_rate,
+                                 enum window_t* window_type);
+void print_cutoff_error(const low_pass_filter_t* lpf,
+                        float highest_cutoff,
+                        float sample_rate);
+
+int fixed_point_width(const low_pass_filter_t* lpf,
+                      int sample_format,
+                      size_t filter_length);
+
+bool uses_precise(const low_pass_filter_t* lpf);
 
-int get_read_point(low_pass_filter_t* lpf, int samples_delay);
-void increment_write_point(low_pass_filter_t* lpf);
+enum precise_fir_mode precise_mode(const low_pass_filter_t* lpf);
+
+bool uses_threads(const low_pass_filter_t* lpf, size_t filter_length);
+
+size_t segment_frames_for(size_t buffer_size);
+
+sf_count_t filter_block(void* context, float* audio_buffer, sf_count_t frames);
+
+sf_count_t filter_chunk(threaded_file_t* file,
+                        float* audio_buffer,
+                        sf_count_t frames);
+
+sf_count_t filter_chunk_block(void* context,
+                              float* audio_buffer,
+                              sf_count_t frames);
+
+sf_count_t compensated_delay(const low_pass_filter_t* lpf);
+
+enum lpf_error flush_filter(low_pass_filter_t* lpf,
+                            audio_file_t* output_wav,
+                            sf_count_t* frames_processed);
+
+float modulated_cutoff(low_pass_filter_t* lpf);
+
+void release_filter(low_pass_filter_t* lpf);
+
+size_t delay_line_length(const low_pass_filter_t* lpf);
+
+bool uses_fft(const low_pass_filter_t* lpf, size_t filter_length);
+
+size_t block_size_for(const low_pass_filter_t* lpf,
+                      size_t filter_length,
+                      int channels);
+
+int design_order(const low_pass_filter_t* lpf, float sample_rate);
+
+enum lpf_error reserve_workspace(low_pass_filter_t* lpf, size_t size);
+
+void* workspace_alloc(low_pass_filter_t* lpf, size_t bytes);
+
+uint64_t stage_start(const low_pass_filter_t* lpf);
+
+uint64_t stage_end(const low_pass_filter_t* lpf,
+                   uint64_t* stage_ns,
+                   uint64_t start);
+
+uint64_t filter_end(low_pass_filter_t* lpf, uint64_t start);
+
+void finish_stats(low_pass_filter_t* lpf,
+                  sf_count_t frames_written,
+                  uint64_t start);
+
+SNDFILE* open_sound_file(const char* file_name, int mode, SF_INFO* info);
+
+bool open_input_file(const low_pass_filter_t* lpf,
+                     const char* input_file_name,
+                     SF_INFO* wav_info,
+                     audio_file_t* input_wav);
+
+enum lpf_error open_output_file(low_pass_filter_t* lpf,
+                                const char* output_file_name,
+                                const SF_INFO* input_info,
+                                sf_count_t frames_to_process,
+                                audio_file_t* output_wav);
+
+sf_count_t audio_file_read(audio_file_t* file,
+                           float* audio_buffer,
+                           sf_count_t frames);
+
+sf_count_t audio_file_write(audio_file_t* file,
+                            const float* audio_buffer,
+                            sf_count_t frames);
+
+sf_count_t audio_file_read_pcm(audio_file_t* file,
+                               void* audio_buffer,
+                               sf_count_t frames,
+                               int sample_bits);
+
+sf_count_t audio_file_write_pcm(audio_file_t* file,
+                                const void* audio_buffer,
+                                sf_count_t frames,
+                                int sample_bits);
+
+sf_count_t audio_file_read_double(audio_file_t* file,
+                                  double* audio_buffer,
+                                  sf_count_t frames);
+
+sf_count_t audio_file_write_double(audio_file_t* file,
+                                   const double* audio_buffer,
+                                   sf_count_t frames);
+
+int audio_file_close(audio_file_t* file);
+
+void batch_worker(void* arg);
 
 // -----------------------------------------------------------------------------
 // Allocates memory for a low_pass_filter_t object and initialises its members.
-// Allocation of coeffs and past_input_samples is left until filter is about to
-// begin. Returns the address of the new object.
+// coeffs and past_input_samples are left until filter is about to begin, when
+// they are taken from the workspace. Returns the address of the new object.
+// The input file's mapping lives beside the object rather than in the
+// workspace, since the input is opened before the workspace can be sized.
 //
 // Arguments:
 //     cutoff      - -6dB point of filter
 //     window_type - window to apply to filter coefficients
-//     buffer_size - size of processing block
+//     buffer_size - size of processing block, or LPF_BLOCK_AUTO
 //
 // Returns:
 //     pointer to new low_pass_filter_t object
@@ -55,237 +337,3182 @@ low_pass_filter_t* lpf_create(float cutoff,
         lpf->order = 126;
         lpf->coeffs = NULL;
         lpf->past_input_samples = NULL;
-        lpf->write_point = 0;
+        lpf->newest_sample = 0;
         lpf->window_type = window_type;
         lpf->buffer_size = buffer_size;
         lpf->channel_count = 0;
+        lpf->engine = LPF_ENGINE_AUTO;
+        lpf->convolver = NULL;
+        lpf->iir = NULL;
+        lpf->iir_response = LPF_IIR_BUTTERWORTH;
+        lpf->iir_order = 4;
+        lpf->simd_level = cpu_best_simd_level();
+        lpf->dot_product = fir_dot_product_kernel(lpf->simd_level);
+        lpf->block_dot_product =
+            fir_block_dot_product_kernel(lpf->simd_level);
+        lpf->block_folded_dot_product = NULL;
+        lpf->planar = true;
+        lpf->auto_block_size = buffer_size == LPF_BLOCK_AUTO;
+        lpf->thread_count = 1;
+        lpf->thread_pool = NULL;
+        lpf->pipeline_depth = 0;
+        lpf->coeff_cache = NULL;
+        memset(&lpf->raw_format, 0, sizeof(lpf->raw_format));
+        lpf->decimation = 1;
+        lpf->decimation_phase = 0;
+        lpf->kaiser_beta = DEFAULT_KAISER_BETA;
+        lpf->transition_width = 0.0f;
+        lpf->stopband_attenuation = 0.0f;
+        lpf->phase = LPF_PHASE_LINEAR;
+        lpf->delay_compensation = false;
+        lpf->frames_to_trim = 0;
+        lpf->sample_rate = 0.0f;
+        lpf->envelope_times = NULL;
+        lpf->envelope_cutoffs = NULL;
+        lpf->envelope_length = 0;
+        lpf->envelope_index = 0;
+        lpf->envelope_lowest = 0.0f;
+        lpf->envelope_highest = 0.0f;
+        lpf->manual_cutoff = 0.0f;
+        lpf->cutoff_bank = NULL;
+        lpf->modulation_frame = 0;
+        lpf->arithmetic = LPF_ARITHMETIC_FLOAT;
+        lpf->fixed_point_bits = 0;
+        lpf->fixed_fir = NULL;
+        lpf->precise = false;
+        lpf->precise_fir = NULL;
+        lpf->collect_stats = false;
+        memset(&lpf->stats, 0, sizeof(lpf->stats));
+        lpf->workspace = NULL;
+        lpf->workspace_size = 0;
+        lpf->workspace_used = 0;
+        lpf->workspace_owned = true;
+        lpf->input_mapping = malloc(mapped_wav_size());
+
+        if (!lpf->input_mapping)
+        {
+            free(lpf);
+            lpf = NULL;
+        }
     }
 
     return lpf;
 }
 
 // -----------------------------------------------------------------------------
-// Opens input file and creates an output file to write to. Processes input
-// data by block.
+// Sets the filter order, one less than the number of taps, replacing any design
+// spec. The default is 126. Higher orders give a steeper transition at a cost
+// proportional to the order.
 //
 // Arguments:
-//     lpf - pointer to low pass filter data
-//     input_file_name - input file name
-//     output_file_name - output file name
-//     cutoff - -6dB point of filter
+//     lpf   - pointer to low pass filter data
+//     order - filter order, from 1 to LPF_MAX_ORDER
+//
+// Returns:
+//     void
 // -----------------------------------------------------------------------------
-enum lpf_error lpf_filter_file(low_pass_filter_t* lpf,
-                               const char* input_file_name,
-                               const char* output_file_name,
-                               enum window_t window_type,
-                               sf_count_t* frames_filtered)
+void lpf_set_order(low_pass_filter_t* lpf, int order)
 {
-    SF_INFO wav_info;
-    SNDFILE* input_wav = sf_open(input_file_name, SFM_READ, &wav_info);
+    lpf->order = order > 1 ? order : 1;
+    if (lpf->order > LPF_MAX_ORDER)
+        lpf->order = LPF_MAX_ORDER;
+    lpf->transition_width = 0.0f;
+}
 
-    if (input_wav == NULL)
+// -----------------------------------------------------------------------------
+// Makes the cutoff follow a breakpoint envelope, replacing the cutoff passed to
+// lpf_create. Between breakpoints the cutoff moves exponentially, evenly in
+// pitch; before the first and after the last it holds. Time runs from the first
+// input frame, and restarts on lpf_reset.
+//
+// When filtering starts a bank of filters is designed at cutoffs 1/24 octave
+// apart across the envelope's range, and every LPF_MODULATION_FRAMES frames the
+// coefficients are interpolated from the two nearest, so following the
+// envelope never designs, allocates or clicks. The IIR engine redesigns its
+// sections in place instead. A modulated FIR always uses the direct form on
+// one thread, the FFT engine and thread count being ignored.
+//
+// Arguments:
+//     lpf         - pointer to low pass filter data
+//     times       - breakpoint times in seconds, not decreasing
+//     cutoffs     - cutoff in Hz at each breakpoint
+//     point_count - number of breakpoints, 0 to go back to a fixed cutoff
+//
+// Returns:
+//     LPF_NO_ERROR on success, LPF_CUTOFF_ERROR if a time or cutoff is out of
+//     order or not positive, LPF_FILTER_INIT_ERROR if memory ran out
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_set_cutoff_envelope(low_pass_filter_t* lpf,
+                                       const float* times,
+                                       const float* cutoffs,
+                                       size_t point_count)
+{
+    for (size_t i = 0; i < point_count; ++i)
     {
-        eprintf("unable to open input file\n");
-        return LPF_FILE_OPEN_ERROR;
+        if (times[i] < 0 || cutoffs[i] <= 0 ||
+            (i > 0 && times[i] < times[i - 1]))
+            return LPF_CUTOFF_ERROR;
     }
 
-    const sf_count_t frames_to_process = wav_info.frames;
-    sf_count_t frames_processed = 0;
-
-    float* audio_buffer =
-        (float*)calloc(lpf->buffer_size * (size_t)wav_info.channels,
-                       sizeof(float));
+    float* envelope_times = NULL;
+    float* envelope_cutoffs = NULL;
+    if (point_count > 0)
+    {
+        envelope_times = (float*)malloc(point_count * sizeof(float));
+        envelope_cutoffs = (float*)malloc(point_count * sizeof(float));
+        if (!envelope_times || !envelope_cutoffs)
+        {
+            free(envelope_times);
+            free(envelope_cutoffs);
+            return LPF_FILTER_INIT_ERROR;
+        }
 
-    if (init_filter(lpf,
-                    (float)wav_info.samplerate,
-                    wav_info.channels,
-                    window_type))
-        return LPF_FILTER_INIT_ERROR;
+        memcpy(envelope_times, times, point_count * sizeof(float));
+        memcpy(envelope_cutoffs, cutoffs, point_count * sizeof(float));
+    }
 
-    SNDFILE* output_wav = sf_open(output_file_name, SFM_WRITE, &wav_info);
+    free(lpf->envelope_times);
+    free(lpf->envelope_cutoffs);
+    lpf->envelope_times = envelope_times;
+    lpf->envelope_cutoffs = envelope_cutoffs;
+    lpf->envelope_length = point_count;
+    lpf->envelope_lowest = point_count ? cutoffs[0] : 0.0f;
+    lpf->envelope_highest = point_count ? cutoffs[0] : 0.0f;
 
-    if (output_wav == NULL)
+    for (size_t i = 1; i < point_count; ++i)
     {
-        eprintf("unable to open output file\n");
-        return LPF_FILE_OPEN_ERROR;
+        if (cutoffs[i] < lpf->envelope_lowest)
+            lpf->envelope_lowest = cutoffs[i];
+        if (cutoffs[i] > lpf->envelope_highest)
+            lpf->envelope_highest = cutoffs[i];
     }
 
-    while (frames_processed < frames_to_process)
-    {
-        const sf_count_t frames_read =
-            sf_readf_float(input_wav, audio_buffer, lpf->buffer_size);
+    return LPF_NO_ERROR;
+}
 
-        filter_buffer(lpf, audio_buffer, frames_read);
+// -----------------------------------------------------------------------------
+// Moves the cutoff. A filter following an envelope takes the new cutoff,
+// clamped to the envelope's range, at its next coefficient update without
+// allocating, and keeps it instead of the envelope until lpf_reset, so a
+// control track can drive lpf_process directly. Otherwise the cutoff applies
+// from the next lpf_prepare or lpf_filter_file.
+//
+// Arguments:
+//     lpf    - pointer to low pass filter data
+//     cutoff - -6dB point of filter
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_cutoff(low_pass_filter_t* lpf, float cutoff)
+{
+    if (cutoff <= 0)
+        return;
 
-        const sf_count_t frames_written =
-            sf_writef_float(output_wav, audio_buffer, frames_read);
+    lpf->cutoff = cutoff;
+    if (lpf->envelope_length > 0)
+        lpf->manual_cutoff = cutoff;
+}
 
-        if (frames_written != frames_read)
-        {
-            eprintf("not all frames were written to the output file\n");
-            return LPF_FILE_WRITE_ERROR;
-        }
+// -----------------------------------------------------------------------------
+// Designs the filter from a spec instead of a cutoff and order. The cutoff is
+// put midway between the band edges and Kaiser's formulas give the window beta
+// and the smallest order that reaches the attenuation, so no taps are spent
+// beyond what the spec needs. The order depends on the sample rate and is
+// worked out when filtering starts, which fails with LPF_CUTOFF_ERROR if it is
+// above LPF_MAX_ORDER. Replaces the window and cutoff passed to lpf_create and
+// any order set with lpf_set_order.
+//
+// Arguments:
+//     lpf            - pointer to low pass filter data
+//     passband_edge  - highest frequency passed at full level, in Hz
+//     stopband_edge  - lowest frequency attenuated in full, in Hz
+//     attenuation_db - stopband attenuation in dB
+//
+// Returns:
+//     LPF_NO_ERROR on success, LPF_CUTOFF_ERROR if the edges are not in
+//     increasing order, the attenuation is not positive or the order is above
+//     LPF_MAX_ORDER at every sample rate the stopband fits below Nyquist
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_set_design_spec(low_pass_filter_t* lpf,
+                                   float passband_edge,
+                                   float stopband_edge,
+                                   float attenuation_db)
+{
+    if (passband_edge <= 0 || stopband_edge <= passband_edge ||
+        attenuation_db <= 0)
+        return LPF_CUTOFF_ERROR;
 
-        frames_processed += frames_written;
-    }
+    // the order grows with the sample rate, so is least at the lowest rate
+    // that puts the stopband edge at or below Nyquist
+    if (kaiser_design_order(attenuation_db,
+                            stopband_edge - passband_edge,
+                            passband_edge + stopband_edge) > LPF_MAX_ORDER)
+        return LPF_CUTOFF_ERROR;
+
+    lpf->cutoff = (passband_edge + stopband_edge) / 2.0f;
+    lpf->window_type = KAISER;
+    lpf->kaiser_beta = kaiser_design_beta(attenuation_db);
+    lpf->transition_width = stopband_edge - passband_edge;
+    lpf->stopband_attenuation = attenuation_db;
 
-    *frames_filtered = frames_processed;
+    return LPF_NO_ERROR;
+}
 
-    sf_close(input_wav);
-    sf_close(output_wav);
+// -----------------------------------------------------------------------------
+// Selects linear or minimum phase design. A minimum phase filter has the
+// magnitude response of the linear phase one, computed from its cepstrum with
+// the FFT, but its energy comes first, so audio is delayed by a few samples
+// rather than order / 2.
+//
+// Arguments:
+//     lpf   - pointer to low pass filter data
+//     phase - phase response of the design
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_phase(low_pass_filter_t* lpf, enum lpf_phase phase)
+{
+    lpf->phase = phase;
+}
 
-    free(lpf->coeffs);
-    free(lpf->past_input_samples);
-    free(audio_buffer);
+// -----------------------------------------------------------------------------
+// Makes lpf_filter_file line the output up with the input. The first order / 2
+// outputs, which come before a linear phase filter has seen the sample they
+// belong to, are dropped, and order / 2 frames of silence are fed in after the
+// input to flush out the tail, so the output is as long as the input. An odd
+// order delays by a whole number of samples and a half, of which order / 2
+// removes only the whole, leaving the output half a sample behind the input;
+// an even order, as every design spec gives, lines up exactly. Ignored for
+// minimum phase designs, whose delay is not a whole number of samples, and by
+// lpf_process.
+//
+// Arguments:
+//     lpf                - pointer to low pass filter data
+//     delay_compensation - true to remove the filter delay
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_delay_compensation(low_pass_filter_t* lpf,
+                                bool delay_compensation)
+{
+    lpf->delay_compensation = delay_compensation;
+}
 
-    return LPF_NO_ERROR;
+// -----------------------------------------------------------------------------
+// Selects the convolution engine used by subsequent calls to lpf_filter_file.
+// The FFT engine matches the direct form to within 1e-5 of full scale for
+// filters of up to 16k taps, the difference being rounding error in the
+// transform.
+//
+// Arguments:
+//     lpf    - pointer to low pass filter data
+//     engine - engine to use, LPF_ENGINE_AUTO picks by filter length
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_engine(low_pass_filter_t* lpf, enum lpf_engine engine)
+{
+    lpf->engine = engine;
 }
 
 // -----------------------------------------------------------------------------
-// Initialises coefficients.
+// Sets the response and order of the IIR engine, which is used when the engine
+// is LPF_ENGINE_IIR. The default is a 4th order Butterworth. An IIR filter
+// costs about two and a half multiplies per sample per order, against one per
+// tap for the FIR, but its phase is not linear, so the window, order, design
+// spec and phase settings of the FIR do not apply to it. It is never split
+// between threads and has no delay for lpf_set_delay_compensation to remove.
 //
 // Arguments:
-//     lpf - lpf - pointer to low pass filter data
-//     sample_rate - sample rate
-//     cutoff - -6dB point of filter
-//     window_type - window to apply to filter coefficients
+//     lpf      - pointer to low pass filter data
+//     response - Butterworth or Linkwitz-Riley
+//     order    - filter order, 1 to 16, rounded up to even for Linkwitz-Riley
 //
 // Returns:
-//     LPF_NO_ERROR on success
+//     void
 // -----------------------------------------------------------------------------
-enum lpf_error init_filter(low_pass_filter_t* lpf,
-                           float sample_rate,
-                           int channels,
-                           enum window_t window_type)
+void lpf_set_iir_design(low_pass_filter_t* lpf,
+                        enum lpf_iir_response response,
+                        int order)
 {
-    if (lpf->cutoff <= 0)
-        return LPF_CUTOFF_ERROR;
-    else if (sample_rate <= 0)
-        return LPF_SAMPLE_RATE_ERROR;
+    if (order < 1)
+        order = 1;
+    else if (order > LPF_IIR_MAX_ORDER)
+        order = LPF_IIR_MAX_ORDER;
 
-    const size_t filter_length = (size_t)lpf->order + 1ull;
-    lpf->coeffs = (float*)calloc(filter_length, sizeof(float));
-    lpf->past_input_samples =
-        (float*)calloc(filter_length * (size_t)channels, sizeof(float));
-    lpf->channel_count = channels;
+    if (response == LPF_IIR_LINKWITZ_RILEY && order % 2)
+        ++order;
 
-    float transition_frequency = lpf->cutoff / sample_rate;
+    lpf->iir_response = response;
+    lpf->iir_order = order;
+}
 
-    for (int i = 0; i < lpf->order + 1; ++i)
+// -----------------------------------------------------------------------------
+// Selects the instruction set used by the direct form tap kernel. By default
+// the widest one the CPU supports is picked when the object is created. Every
+// kernel matches the scalar one to within float rounding of the sum.
+//
+// Arguments:
+//     lpf  - pointer to low pass filter data
+//     simd - instruction set, LPF_SIMD_AUTO picks the widest supported
+//
+// Returns:
+//     LPF_NO_ERROR on success, LPF_SIMD_UNSUPPORTED_ERROR if this machine
+//     cannot run the requested kernel
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_set_simd(low_pass_filter_t* lpf, enum lpf_simd simd)
+{
+    enum simd_level level = SIMD_SCALAR;
+    switch (simd)
     {
-        if (i == lpf->order / 2.0f)
-            lpf->coeffs[i] = 2.0f * transition_frequency;
-        else
-        {
-            float pi_x = (float)M_PI * (i - lpf->order / 2.0f);
-            lpf->coeffs[i] = sinf(2.0f * transition_frequency * pi_x) / pi_x;
-        }
+    case LPF_SIMD_AUTO: level = cpu_best_simd_level(); break;
+    case LPF_SIMD_SCALAR: level = SIMD_SCALAR; break;
+    case LPF_SIMD_SSE: level = SIMD_SSE; break;
+    case LPF_SIMD_AVX2: level = SIMD_AVX2; break;
+    case LPF_SIMD_AVX512: level = SIMD_AVX512; break;
+    case LPF_SIMD_NEON: level = SIMD_NEON; break;
     }
 
-    switch (window_type)
-    {
-    case BARTLETT: bartlett_window(lpf->coeffs, filter_length); break;
-    case BLACKMAN: blackman_window(lpf->coeffs, filter_length); break;
-    case HAMMING: hamming_window(lpf->coeffs, filter_length); break;
-    case HANNING: hanning_window(lpf->coeffs, filter_length); break;
-    case KAISER: kaiser_window(lpf->coeffs, filter_length); break;
-    }
+    if (!cpu_supports(level))
+        return LPF_SIMD_UNSUPPORTED_ERROR;
 
-    // normalises coeffiecients to avoid clipping
-    float sum = 0.0f;
-    for (int i = 0; i < filter_length; ++i) sum += lpf->coeffs[i];
-    for (int i = 0; i < filter_length; ++i) lpf->coeffs[i] /= sum;
+    lpf->simd_level = level;
+    lpf->dot_product = fir_dot_product_kernel(level);
+    lpf->block_dot_product = fir_block_dot_product_kernel(level);
 
     return LPF_NO_ERROR;
 }
 
 // -----------------------------------------------------------------------------
-// Processes buffer.
+// Selects planar processing for the direct form engine. Each block is
+// deinterleaved once, every channel is filtered as a contiguous array against
+// its own history and the result is reinterleaved, so memory traffic per sample
+// does not grow with the channel count. Unless decimating, each block is then
+// filtered tap-major, tap by tap across many outputs, which is about twice as
+// fast as a dot product per output even for one channel, with the two samples
+// of each pair of equal taps added first for a linear phase filter of more than
+// a few dozen taps. On by default; turned off, each frame is filtered in place
+// against a mirrored delay line, one dot product per output, which rounds the
+// sums in a different order. Ignored by the FFT and IIR engines.
 //
 // Arguments:
-//     lpf          - pointer to low pass filter data
-//     audio_buffer - buffer of samples
-//     samples_read - length of buffer
+//     lpf    - pointer to low pass filter data
+//     planar - true to deinterleave each block before filtering
 //
 // Returns:
 //     void
 // -----------------------------------------------------------------------------
-void filter_buffer(low_pass_filter_t* lpf,
-                   float* audio_buffer,
-                   sf_count_t frames_read)
+void lpf_set_planar(low_pass_filter_t* lpf, bool planar)
 {
-    for (int i = 0; i < frames_read; ++i)
-    {
-        // Channels in a frame are interleaved - indexing from the first will
-        // find the rest.
-        for (int c = 0; c < lpf->channel_count; ++c)
-        {
-            lpf->past_input_samples[lpf->write_point * lpf->channel_count + c] =
-                audio_buffer[i * lpf->channel_count + c];
+    lpf->planar = planar;
+}
 
-            audio_buffer[i * lpf->channel_count + c] = 0.0f;
+// -----------------------------------------------------------------------------
+// Sets the number of frames lpf_filter_file reads, filters and writes at a
+// time, which is also the most planar processing filters at once. With
+// LPF_BLOCK_AUTO the block size is picked for each file as the largest power
+// of two whose working set of block buffers, history and coefficients fits in
+// half the L2 cache, so that a block is still cached when it is filtered and
+// written, with blocks as large as that allows to spread the cost of each
+// read and write.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     block_frames - frames per block, or LPF_BLOCK_AUTO
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_block_size(low_pass_filter_t* lpf, size_t block_frames)
+{
+    lpf->auto_block_size = block_frames == LPF_BLOCK_AUTO;
+    if (!lpf->auto_block_size)
+        lpf->buffer_size = block_frames;
+}
 
-            for (int j = 0; j < lpf->order + 1; ++j)
-            {
-                audio_buffer[i * lpf->channel_count + c] +=
-                    lpf->coeffs[j] * lpf->past_input_samples[get_read_point(
-                                         lpf,
-                                         j * lpf->channel_count - c)];
-            }
-        }
-        increment_write_point(lpf);
-    }
+// -----------------------------------------------------------------------------
+// Gets the block size set, or with LPF_BLOCK_AUTO the one picked for the last
+// file or lpf_prepare, and 0 before either.
+// -----------------------------------------------------------------------------
+size_t lpf_get_block_size(const low_pass_filter_t* lpf)
+{
+    return lpf->buffer_size;
 }
 
 // -----------------------------------------------------------------------------
-// Gets read point of circular buffer based on a write point and a delay length.
+// Selects the arithmetic lpf_filter_file filters in. Fixed point applies to 16
+// and 24 bit PCM filtered by an FIR in direct form at a fixed cutoff without
+// decimation, so not with LPF_ENGINE_FFT nor from LPF_FFT_CROSSOVER_TAPS taps
+// on with LPF_ENGINE_AUTO. It keeps the samples as integers from file to file:
+// 16 bit samples are filtered with Q15 coefficients summed in 32 bits, 24 bit
+// samples with Q31 coefficients summed in 64 bits, and every output is rounded
+// to nearest once at the sample width. It runs on one thread, whatever the
+// thread count. Every other case filters in float as before.
+//
+// Against the exact output, loud 24 bit material stays within one least
+// significant bit at the default order, as the float path does. Rounding 16
+// bit coefficients to 15 bits perturbs the response instead, lifting the
+// stopband floor to about 100 - 10 log10(order + 1) dB below the passband and
+// putting loud material about sqrt(order) / 6 least significant bits rms from
+// the exact output: 1.9 rms and 5 at most at the default order, against 0.5
+// and 1.2 for the float path.
+//
+// The higher precision arithmetics apply under the same conditions to any
+// sample format, and with LPF_ENGINE_AUTO at any length, also on one thread.
+// Samples are read and written as doubles, so each output is rounded once, at
+// the width of the file, and coefficients are normalised in double.
+// LPF_ARITHMETIC_DOUBLE_SUM keeps float samples and coefficients but sums in
+// double, and LPF_ARITHMETIC_KAHAN sums in float with Kahan compensation,
+// either way leaving the sum a few roundings of float from exact however long
+// the filter. LPF_ARITHMETIC_DOUBLE designs the filter and filters in double
+// throughout, for float output that keeps the full precision of the design.
 //
 // Arguments:
-//     lpf           - used for write point and filter length
-//     samples_delay - delay between 0 and filter length
+//     lpf        - pointer to low pass filter data
+//     arithmetic - arithmetic to filter in
 //
 // Returns:
-//     read point
+//     void
 // -----------------------------------------------------------------------------
-int get_read_point(low_pass_filter_t* lpf, int samples_delay)
+void lpf_set_arithmetic(low_pass_filter_t* lpf, enum lpf_arithmetic arithmetic)
 {
-    int wrap = (lpf->order + 1) * lpf->channel_count;
-    int read_point =
-        lpf->write_point * lpf->channel_count + wrap - samples_delay;
-    if (read_point >= wrap)
-        read_point -= wrap;
-
-    return read_point;
+    lpf->arithmetic = arithmetic;
 }
 
 // -----------------------------------------------------------------------------
-// Increments write point in low_pass_filter_t object, and wraps it around
-// filter length.
+// Makes lpf_filter_file measure itself: how long reading, filtering and writing
+// take, how the time to filter a block is spread, and how much memory the
+// process peaks at. Off by default. Each stage is timed once per block, so the
+// cost is a few clock reads per block, none per sample. lpf_process and
+// lpf_filter_batch are not measured.
 //
 // Arguments:
-//     lpf - owner of write_point to increment
+//     lpf           - pointer to low pass filter data
+//     collect_stats - true to gather stats
 //
 // Returns:
 //     void
 // -----------------------------------------------------------------------------
-void increment_write_point(low_pass_filter_t* lpf)
+void lpf_set_stats(low_pass_filter_t* lpf, bool collect_stats)
 {
-    ++lpf->write_point;
-    if (lpf->write_point == lpf->order + 1)
-        lpf->write_point = 0;
+    lpf->collect_stats = collect_stats;
 }
 
 // -----------------------------------------------------------------------------
-// Deallocates low_pass_filter_t object and its arrays.
+// Gets the stats of the last lpf_filter_file, all zero unless lpf_set_stats
+// was on.
 //
 // Arguments:
-//      lpf - low_pass_filter_t to deallocate
+//     lpf   - pointer to low pass filter data
+//     stats - receives the stats
 //
 // Returns:
 //     void
 // -----------------------------------------------------------------------------
-void lpf_destroy(low_pass_filter_t* lpf)
+void lpf_get_stats(const low_pass_filter_t* lpf, lpf_stats_t* stats)
 {
-    if (lpf)
-        free(lpf);
-}
\ No newline at end of file
+    *stats = lpf->stats;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the size of workspace lpf_filter_file and lpf_prepare need for a file
+// or stream of this sample rate and channel count with the current settings:
+// the coefficients, the delay line, a block of samples, the silence that
+// flushes a delay compensated tail, the state of the engine in use, whether
+// FFT, IIR, envelope bank, fixed point or higher precision, the per-thread
+// lines and chunk buffers of a threaded file, and the mapping of the output
+// file. As the sample format is not known here, fixed point arithmetic is
+// sized for 24 bit samples, the wider.
+//
+// Arguments:
+//     lpf         - pointer to low pass filter data
+//     sample_rate - sample rate to be filtered
+//     channels    - number of interleaved channels to be filtered
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t lpf_workspace_size(const low_pass_filter_t* lpf,
+                          float sample_rate,
+                          int channels)
+{
+    const size_t filter_length = (size_t)design_order(lpf, sample_rate) + 1;
+    const size_t buffer_size = block_size_for(lpf, filter_length, channels);
+
+    size_t block_frames = buffer_size;
+    if (uses_fft(lpf, filter_length) &&
+        overlap_save_step_for(filter_length) > block_frames)
+        block_frames = overlap_save_step_for(filter_length);
+
+    const size_t delay_line = lpf->planar
+                                  ? 2 * buffer_size + filter_length - 1
+                                  : 2 * filter_length;
+
+    // the higher precision arithmetics read blocks as doubles
+    const size_t block_floats =
+        block_frames * channels * (uses_precise(lpf) ? 2 : 1);
+
+    const size_t lengths[] = {
+        filter_length,
+        delay_line * channels,
+        block_floats,
+        filter_length / 2 * channels,
+    };
+
+    // room to align the start, then each buffer rounded up to the alignment
+    size_t size = WORKSPACE_ALIGNMENT;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+        size += workspace_round(lengths[i] * sizeof(float));
+
+    // the engine's own state, as init_filter builds it
+    if (lpf->engine == LPF_ENGINE_IIR)
+    {
+        size += biquad_cascade_size(
+            lpf->iir_response, lpf->iir_order, channels);
+    }
+    else if (uses_precise(lpf))
+    {
+        size += precise_fir_size(
+            (int)filter_length, channels, precise_mode(lpf), buffer_size);
+    }
+    else if (lpf->envelope_length > 0)
+    {
+        filter_design_t design;
+        design.order = (int)filter_length - 1;
+        size += cutoff_bank_size(
+            &design, lpf->envelope_lowest, lpf->envelope_highest);
+    }
+    else if (uses_fft(lpf, filter_length))
+    {
+        size += overlap_save_size(filter_length, channels);
+    }
+    else if (lpf->decimation == 1)
+    {
+        if (lpf->arithmetic == LPF_ARITHMETIC_FIXED)
+            size += fixed_fir_size(
+                (int)filter_length, channels, 24, buffer_size);
+
+        // a float sample format falls back to float, and may be threaded
+        if (uses_threads(lpf, filter_length))
+        {
+            const size_t chunk_frames =
+                parallel_chunk_frames(channels,
+                                      lpf->thread_count,
+                                      segment_frames_for(buffer_size));
+
+            size += parallel_filter_size((int)filter_length,
+                                         channels,
+                                         lpf->thread_count,
+                                         segment_frames_for(buffer_size));
+            size += workspace_round((filter_length - 1 + chunk_frames) *
+                                    channels * sizeof(float));
+            size += workspace_round(chunk_frames * channels * sizeof(float));
+        }
+    }
+
+    return size + mapped_wav_size();
+}
+
+// -----------------------------------------------------------------------------
+// Gets the size of workspace lpf_filter_bank needs for a file of this sample
+// rate and channel count split into band_count bands with the current
+// settings: every band's coefficients, the bank's lines or convolvers, a block
+// of input and of each band's output, and the mapping of each output file.
+//
+// Arguments:
+//     lpf         - pointer to low pass filter data
+//     sample_rate - sample rate to be filtered
+//     channels    - number of interleaved channels to be filtered
+//     band_count  - number of bands
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t lpf_bank_workspace_size(const low_pass_filter_t* lpf,
+                               float sample_rate,
+                               int channels,
+                               size_t band_count)
+{
+    const int filter_length = design_order(lpf, sample_rate) + 1;
+    const size_t buffer_size =
+        block_size_for(lpf, (size_t)filter_length, channels);
+    const bool use_fft = uses_fft(lpf, (size_t)filter_length);
+
+    size_t block_frames = buffer_size;
+    if (use_fft && overlap_save_step_for(filter_length) > block_frames)
+        block_frames = overlap_save_step_for(filter_length);
+
+    const size_t block_samples = block_frames * channels;
+
+    return WORKSPACE_ALIGNMENT +
+           workspace_round(band_count * filter_length * sizeof(float)) +
+           2 * workspace_round(band_count * sizeof(float*)) +
+           workspace_round(band_count * sizeof(audio_file_t)) +
+           filter_bank_size((int)band_count,
+                            filter_length,
+                            channels,
+                            buffer_size,
+                            use_fft) +
+           workspace_round(block_samples * sizeof(float)) +
+           workspace_round(block_samples * band_count * sizeof(float)) +
+           band_count * mapped_wav_size();
+}
+
+// -----------------------------------------------------------------------------
+// Gives the filter memory to carve its per-file objects and buffers from,
+// instead of allocating them, so that filtering file after file allocates
+// nothing beyond the cases low_pass_filter.h lists. The workspace is reused by
+// every later lpf_filter_file, lpf_prepare and lpf_filter_bank and must
+// outlive them; one of fewer than lpf_workspace_size, or for a bank
+// lpf_bank_workspace_size, bytes makes them fail with LPF_WORKSPACE_ERROR. A
+// NULL workspace returns to one the filter allocates itself, kept and grown
+// as needed until lpf_destroy, which equally allocates nothing once it is big
+// enough. lpf_filter_batch gives each worker a workspace of its own.
+//
+// Arguments:
+//     lpf       - pointer to low pass filter data
+//     workspace - memory for the filter, or NULL
+//     size      - size of workspace in bytes
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_workspace(low_pass_filter_t* lpf, void* workspace, size_t size)
+{
+    // nothing may still point into the old workspace
+    release_filter(lpf);
+
+    if (lpf->workspace_owned)
+        free(lpf->workspace);
+
+    lpf->workspace = (unsigned char*)workspace;
+    lpf->workspace_size = workspace ? size : 0;
+    lpf->workspace_owned = !workspace;
+}
+
+// -----------------------------------------------------------------------------
+// Sets the number of threads lpf_filter_file filters on. Each chunk of the
+// file is cut into equal runs of channel frames, one per thread, whatever the
+// channel count, each primed with the order input frames before it, so the
+// output is identical to a single threaded run with planar processing, the
+// default. The threads are started by the first threaded file and kept for
+// later ones until the count changes. Only the direct form engine is threaded.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     thread_count - number of threads, 0 for one per logical processor
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_thread_count(low_pass_filter_t* lpf, int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = thread_hardware_concurrency();
+
+    if (thread_count != lpf->thread_count)
+    {
+        thread_pool_destroy(lpf->thread_pool);
+        lpf->thread_pool = NULL;
+    }
+
+    lpf->thread_count = thread_count;
+}
+
+// -----------------------------------------------------------------------------
+// Enables pipelined file filtering. Reading, filtering and writing each run on
+// their own thread and pass blocks round a ring of pipeline_depth buffers, so
+// wall-clock time approaches the slower of I/O and filtering rather than their
+// sum. When filtering on several threads, the filter stage is the threaded
+// one, so reading and writing do not hold the threads up either.
+//
+// The depth has no effect when the input or output is memory mapped, as any
+// WAV file of 16 or 24 bit PCM or float is unless it is stdin or stdout: a
+// mapped file is read and written by copying to and from memory, with no I/O
+// calls to overlap.
+//
+// Arguments:
+//     lpf            - pointer to low pass filter data
+//     pipeline_depth - number of blocks in the ring, 0 to disable
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_pipeline_depth(low_pass_filter_t* lpf, int pipeline_depth)
+{
+    lpf->pipeline_depth = pipeline_depth > 0 ? pipeline_depth : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Keeps only every decimation-th output, the first included, so the filter
+// doubles as the anti-aliasing stage of a downsampler. Outputs that would be
+// thrown away are never computed, which for the direct form is the polyphase
+// decomposition: each kept output is the sum of decimation subfilters of
+// every decimation-th tap, run only at the output rate, cutting the work by
+// the decimation factor. The FFT engine computes every output and keeps the
+// wanted ones, as does the IIR engine, each of whose outputs feeds back into
+// the next. lpf_filter_file writes the output at the input rate divided by
+// decimation, which must divide it exactly, and does not split a decimating
+// filter between threads. The cutoff must not be above the output Nyquist
+// frequency.
+//
+// Arguments:
+//     lpf        - pointer to low pass filter data
+//     decimation - downsampling factor, 1 to keep every output
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_decimation(low_pass_filter_t* lpf, int decimation)
+{
+    lpf->decimation = decimation > 1 ? decimation : 1;
+}
+
+// -----------------------------------------------------------------------------
+// Designs the filter and allocates everything lpf_process needs, so that
+// lpf_process itself never allocates, locks or makes a system call and is safe
+// to call from a real-time audio callback. Uses the engine, SIMD and planar
+// settings in force when called; it filters on the calling thread whatever the
+// thread count. May be called again to change sample rate or channel count.
+//
+// Arguments:
+//     lpf         - pointer to low pass filter data
+//     sample_rate - sample rate of the audio to be processed
+//     channels    - number of interleaved channels
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_prepare(low_pass_filter_t* lpf,
+                           float sample_rate,
+                           int channels)
+{
+    // the push API passes floats, whatever the arithmetic
+    lpf->fixed_point_bits = 0;
+    lpf->precise = false;
+
+    const enum lpf_error retcode =
+        init_filter(lpf, sample_rate, channels, lpf->window_type);
+
+    if (retcode != LPF_NO_ERROR)
+        release_filter(lpf);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved frames, continuing from the previous call.
+// input and output may be the same buffer. Any number of frames may be passed,
+// though the FFT engine does a whole transform per call, so small callback
+// buffers are best served by the direct form engine.
+//
+// Arguments:
+//     lpf    - pointer to low pass filter data prepared by lpf_prepare
+//     input  - buffer of interleaved samples
+//     output - buffer receiving the filtered samples, as long as input
+//     frames - number of frames in input
+//
+// Returns:
+//     number of frames written to output, fewer than frames when decimating
+// -----------------------------------------------------------------------------
+size_t lpf_process(low_pass_filter_t* lpf,
+                   const float* input,
+                   float* output,
+                   size_t frames)
+{
+    if (output != input)
+        memcpy(output, input, frames * lpf->channel_count * sizeof(float));
+
+    return (size_t)filter_buffer(lpf, output, (sf_count_t)frames);
+}
+
+// -----------------------------------------------------------------------------
+// Clears the filter history, so the next call to lpf_process starts as if
+// after silence. Does not allocate.
+//
+// Arguments:
+//     lpf - pointer to low pass filter data prepared by lpf_prepare
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_reset(low_pass_filter_t* lpf)
+{
+    if (lpf->past_input_samples)
+    {
+        memset(lpf->past_input_samples,
+               0,
+               delay_line_length(lpf) * lpf->channel_count * sizeof(float));
+    }
+    lpf->newest_sample = 0;
+    lpf->decimation_phase = 0;
+    lpf->frames_to_trim = 0;
+    lpf->envelope_index = 0;
+    lpf->manual_cutoff = 0.0f;
+    lpf->modulation_frame = 0;
+
+    if (lpf->convolver)
+        overlap_save_reset(lpf->convolver);
+    if (lpf->iir)
+        biquad_cascade_reset(lpf->iir);
+}
+
+// -----------------------------------------------------------------------------
+// Reads input as headerless samples instead of a file with a header, as
+// needed for raw PCM on a pipe. An output streamed to stdout is then headerless
+// in the same format, and an output file is WAV.
+//
+// Arguments:
+//     lpf         - pointer to low pass filter data
+//     sample_rate - sample rate of the input
+//     channels    - number of interleaved channels in the input
+//     format      - libsndfile sample format, e.g. SF_FORMAT_PCM_16, or 0 to
+//                   read files with a header again
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_set_raw_format(low_pass_filter_t* lpf,
+                        int sample_rate,
+                        int channels,
+                        int format)
+{
+    memset(&lpf->raw_format, 0, sizeof(lpf->raw_format));
+
+    if (format)
+    {
+        lpf->raw_format.samplerate = sample_rate;
+        lpf->raw_format.channels = channels;
+        lpf->raw_format.format = SF_FORMAT_RAW | (format & SF_FORMAT_SUBMASK);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Opens input file and creates an output file to write to. Processes input
+// data by block.
+//
+// Either name may be LPF_STDIO_NAME to read from stdin or write to stdout. A
+// stream is never seeked and is read until it ends, one block at a time, so
+// output starts after the first block and memory use does not depend on its
+// length. libsndfile cannot write a WAV header it will not seek back to fill
+// in, so a stream written to stdout is AU, or headerless if the input is.
+//
+// A WAV file of 16 or 24 bit PCM or 32 bit float is instead mapped into
+// memory and converted straight from the mapping, and a WAV output of those
+// formats is created at its full length and converted straight into its
+// mapping, which saves libsndfile's copies through its own buffers and the
+// read and write calls. The system reads ahead of a mapping, so the pipeline
+// is not used with one. Every other format goes through libsndfile.
+//
+// Arguments:
+//     lpf - pointer to low pass filter data
+//     input_file_name - input file name
+//     output_file_name - output file name
+//     cutoff - -6dB point of filter
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_filter_file(low_pass_filter_t* lpf,
+                               const char* input_file_name,
+                               const char* output_file_name,
+                               enum window_t window_type,
+                               sf_count_t* frames_filtered)
+{
+    SF_INFO wav_info;
+    audio_file_t input_wav = {NULL, NULL};
+    audio_file_t output_wav = {NULL, NULL};
+
+    memset(&lpf->stats, 0, sizeof(lpf->stats));
+    const uint64_t start = stage_start(lpf);
+
+    if (!open_input_file(lpf, input_file_name, &wav_info, &input_wav))
+    {
+        eprintf("unable to open input file\n");
+        return LPF_FILE_OPEN_ERROR;
+    }
+
+    // the length of a stream is unknown until it ends
+    const sf_count_t frames_to_process =
+        wav_info.seekable ? wav_info.frames : SF_COUNT_MAX;
+
+    lpf->fixed_point_bits = fixed_point_width(
+        lpf,
+        wav_info.format & SF_FORMAT_SUBMASK,
+        (size_t)design_order(lpf, (float)wav_info.samplerate) + 1);
+    lpf->precise = uses_precise(lpf);
+
+    const enum lpf_error init_error = init_filter(
+        lpf, (float)wav_info.samplerate, wav_info.channels, window_type);
+
+    if (init_error)
+    {
+        if (init_error == LPF_CUTOFF_ERROR)
+            print_cutoff_error(lpf,
+                               lpf->envelope_length > 0 ? lpf->envelope_highest
+                                                        : lpf->cutoff,
+                               (float)wav_info.samplerate);
+        else if (init_error == LPF_WORKSPACE_ERROR)
+            eprintf("workspace is smaller than lpf_workspace_size\n");
+        else
+            eprintf("unable to initialise filter\n");
+        audio_file_close(&input_wav);
+        release_filter(lpf);
+        return init_error == LPF_WORKSPACE_ERROR ? init_error
+                                                 : LPF_FILTER_INIT_ERROR;
+    }
+
+    const enum lpf_error open_error = open_output_file(
+        lpf, output_file_name, &wav_info, frames_to_process, &output_wav);
+
+    if (open_error)
+    {
+        audio_file_close(&input_wav);
+        release_filter(lpf);
+        return open_error;
+    }
+
+    lpf->frames_to_trim = compensated_delay(lpf);
+
+    enum lpf_error retcode = LPF_NO_ERROR;
+    if (lpf->fixed_fir)
+    {
+        retcode = filter_file_fixed(
+            lpf, &input_wav, &output_wav, frames_to_process, frames_filtered);
+    }
+    else if (lpf->precise_fir)
+    {
+        retcode = filter_file_precise(
+            lpf, &input_wav, &output_wav, frames_to_process, frames_filtered);
+    }
+    else if (lpf->thread_count > 1 && !lpf->convolver && !lpf->iir &&
+        !lpf->cutoff_bank && lpf->decimation == 1)
+    {
+        retcode = filter_file_threaded(
+            lpf, &input_wav, &output_wav, frames_to_process, frames_filtered);
+    }
+    else
+    {
+        retcode = filter_file_serial(
+            lpf, &input_wav, &output_wav, frames_to_process, frames_filtered);
+    }
+
+    audio_file_close(&input_wav);
+    if (audio_file_close(&output_wav) && retcode == LPF_NO_ERROR)
+    {
+        eprintf("unable to finish writing the output file\n");
+        retcode = LPF_FILE_WRITE_ERROR;
+    }
+
+    finish_stats(lpf, *frames_filtered, start);
+    release_filter(lpf);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters one file with several cutoffs in a single pass, writing one output
+// per band. The input is read and converted once, each channel keeps one
+// history for every band, and each window of it is multiplied by the matrix
+// of every band's coefficients, four bands per pass of the tap kernel, so a
+// bank of N cutoffs costs well under N runs of lpf_filter_file. Filters long
+// enough for lpf_filter_file to convolve by FFT, or any length with the FFT
+// engine set, are convolved by FFT band by band, sharing only the read.
+//
+// Every band has the order, window, phase and delay compensation set on lpf,
+// or the order of its design spec. The bank always filters on the calling
+// thread in float, whatever the thread, pipeline, planar and arithmetic
+// settings; it does not decimate or follow an envelope.
+//
+// Arguments:
+//     lpf             - pointer to low pass filter data
+//     input_file_name - input file name
+//     bands           - output file name and cutoff of each band
+//     band_count      - length of bands
+//     window_type     - window to apply to every band's coefficients
+//     frames_filtered - receives the number of frames written to each output
+//
+// Returns:
+//     LPF_NO_ERROR on success, LPF_CUTOFF_ERROR if a band has no output file
+//     or a cutoff that is not positive, above the Nyquist frequency or, with
+//     a design spec, whose stopband edge is above it
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_filter_bank(low_pass_filter_t* lpf,
+                               const char* input_file_name,
+                               const lpf_band_t* bands,
+                               size_t band_count,
+                               enum window_t window_type,
+                               sf_count_t* frames_filtered)
+{
+    *frames_filtered = 0;
+
+    if (band_count == 0 || lpf->engine == LPF_ENGINE_IIR ||
+        lpf->envelope_length > 0 || lpf->decimation != 1)
+    {
+        eprintf("a filter bank needs at least one band, and cannot use the "
+                "IIR filter, an envelope or decimation\n");
+        return LPF_FILTER_INIT_ERROR;
+    }
+
+    for (size_t b = 0; b < band_count; ++b)
+    {
+        if (!bands[b].output_file || bands[b].cutoff <= 0)
+        {
+            eprintf("every band needs an output file and a positive cutoff\n");
+            return LPF_CUTOFF_ERROR;
+        }
+    }
+
+    // the bank takes the workspace from anything left by lpf_prepare
+    release_filter(lpf);
+
+    SF_INFO wav_info;
+    audio_file_t input_wav = {NULL, NULL};
+
+    memset(&lpf->stats, 0, sizeof(lpf->stats));
+    const uint64_t start = stage_start(lpf);
+
+    if (!open_input_file(lpf, input_file_name, &wav_info, &input_wav))
+    {
+        eprintf("unable to open input file\n");
+        return LPF_FILE_OPEN_ERROR;
+    }
+
+    const sf_count_t frames_to_process =
+        wav_info.seekable ? wav_info.frames : SF_COUNT_MAX;
+    const float sample_rate = (float)wav_info.samplerate;
+
+    float highest_cutoff = 0.0f;
+    for (size_t b = 0; b < band_count; ++b)
+    {
+        if (bands[b].cutoff > highest_cutoff)
+            highest_cutoff = bands[b].cutoff;
+    }
+
+    lpf->channel_count = wav_info.channels;
+    lpf->sample_rate = sample_rate;
+    lpf->frames_to_trim = 0;
+
+    enum lpf_error retcode =
+        2.0f * highest_cutoff > sample_rate
+            ? LPF_CUTOFF_ERROR
+            : apply_design_spec(lpf, highest_cutoff, sample_rate, &window_type);
+
+    if (retcode)
+    {
+        print_cutoff_error(lpf, highest_cutoff, sample_rate);
+        audio_file_close(&input_wav);
+        return retcode;
+    }
+
+    retcode = reserve_workspace(
+        lpf,
+        lpf_bank_workspace_size(
+            lpf, sample_rate, wav_info.channels, band_count));
+
+    if (retcode)
+    {
+        if (retcode == LPF_WORKSPACE_ERROR)
+            eprintf("workspace is smaller than lpf_bank_workspace_size\n");
+        else
+            eprintf("unable to initialise filter\n");
+        audio_file_close(&input_wav);
+        return retcode;
+    }
+
+    const int filter_length = lpf->order + 1;
+    float* coeffs = (float*)workspace_alloc(
+        lpf, band_count * (size_t)filter_length * sizeof(float));
+    float** band_coeffs =
+        (float**)workspace_alloc(lpf, band_count * sizeof(float*));
+    audio_file_t* output_wavs = (audio_file_t*)workspace_alloc(
+        lpf, band_count * sizeof(audio_file_t));
+    filter_bank_t* bank = NULL;
+
+    retcode = coeffs && band_coeffs && output_wavs ? LPF_NO_ERROR
+                                                   : LPF_FILTER_INIT_ERROR;
+
+    filter_design_t design;
+    design.sample_rate = sample_rate;
+    design.order = lpf->order;
+    design.window_type = window_type;
+    design.kaiser_beta = lpf->kaiser_beta;
+    design.phase = lpf->phase;
+
+    for (size_t b = 0; b < band_count && retcode == LPF_NO_ERROR; ++b)
+    {
+        band_coeffs[b] = coeffs + b * filter_length;
+        design.cutoff = bands[b].cutoff;
+        if (!design_low_pass(band_coeffs[b], &design))
+            retcode = LPF_FILTER_INIT_ERROR;
+    }
+
+    lpf->buffer_size =
+        block_size_for(lpf, (size_t)filter_length, wav_info.channels);
+
+    if (retcode == LPF_NO_ERROR)
+    {
+        const bool use_fft = uses_fft(lpf, filter_length);
+        void* memory = workspace_alloc(lpf,
+                                       filter_bank_size((int)band_count,
+                                                        filter_length,
+                                                        wav_info.channels,
+                                                        lpf->buffer_size,
+                                                        use_fft));
+        if (memory)
+            bank = filter_bank_init(memory,
+                                    (const float* const*)band_coeffs,
+                                    (int)band_count,
+                                    filter_length,
+                                    wav_info.channels,
+                                    lpf->buffer_size,
+                                    lpf->simd_level,
+                                    use_fft);
+        else
+            retcode = LPF_FILTER_INIT_ERROR;
+    }
+
+    if (retcode != LPF_NO_ERROR)
+        eprintf("unable to initialise filter\n");
+
+    for (size_t b = 0; b < band_count && retcode == LPF_NO_ERROR; ++b)
+    {
+        retcode = open_output_file(lpf,
+                                   bands[b].output_file,
+                                   &wav_info,
+                                   frames_to_process,
+                                   &output_wavs[b]);
+    }
+
+    if (retcode == LPF_NO_ERROR)
+    {
+        lpf->frames_to_trim = compensated_delay(lpf);
+        retcode = filter_file_bank(lpf,
+                                   bank,
+                                   &input_wav,
+                                   output_wavs,
+                                   band_count,
+                                   frames_to_process,
+                                   frames_filtered);
+    }
+
+    audio_file_close(&input_wav);
+    for (size_t b = 0; output_wavs && b < band_count; ++b)
+    {
+        if (!output_wavs[b].mapped && !output_wavs[b].sndfile)
+            continue;
+
+        if (audio_file_close(&output_wavs[b]) && retcode == LPF_NO_ERROR)
+        {
+            eprintf("unable to finish writing the output file %s\n",
+                    bands[b].output_file);
+            retcode = LPF_FILE_WRITE_ERROR;
+        }
+    }
+
+    finish_stats(lpf, *frames_filtered, start);
+    release_filter(lpf);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a list of files, each with its own cutoff and window, on
+// worker_count threads. Workers take the next unclaimed job until none are
+// left and filter it with a private copy of lpf's settings, so one file per
+// worker is in flight at a time. Coefficients are designed once per distinct
+// (cutoff, sample rate, order, window) and shared between workers. Each job's
+// result and frames_filtered are filled in whether or not it succeeds.
+//
+// Arguments:
+//     lpf          - filter whose engine, SIMD, planar, thread and pipeline
+//                    settings every job uses
+//     jobs         - files to filter
+//     job_count    - length of jobs
+//     worker_count - number of files filtered at once, 0 for one per logical
+//                    processor
+//
+// Returns:
+//     LPF_NO_ERROR if every job succeeded, LPF_FILTER_FILE_ERROR if any failed
+//     and LPF_FILTER_INIT_ERROR if the batch could not start
+// -----------------------------------------------------------------------------
+enum lpf_error lpf_filter_batch(low_pass_filter_t* lpf,
+                                lpf_batch_job_t* jobs,
+                                size_t job_count,
+                                int worker_count)
+{
+    if (worker_count <= 0)
+        worker_count = thread_hardware_concurrency();
+    if ((size_t)worker_count > job_count)
+        worker_count = job_count > 0 ? (int)job_count : 1;
+
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        jobs[i].result = LPF_FILTER_INIT_ERROR;
+        jobs[i].frames_filtered = 0;
+    }
+
+    // workers design their own filters, and must not free lpf's
+    low_pass_filter_t settings = *lpf;
+    settings.coeffs = NULL;
+    settings.past_input_samples = NULL;
+    settings.convolver = NULL;
+    settings.iir = NULL;
+    settings.cutoff_bank = NULL;
+    settings.fixed_fir = NULL;
+    settings.precise_fir = NULL;
+    settings.thread_pool = NULL;
+    settings.workspace = NULL;
+    settings.workspace_size = 0;
+    settings.workspace_used = 0;
+    settings.workspace_owned = true;
+    settings.input_mapping = NULL;
+    settings.coeff_cache = coeff_cache_create();
+
+    batch_t batch;
+    batch.settings = &settings;
+    batch.jobs = jobs;
+    batch.job_count = job_count;
+    batch.next_job = 0;
+    batch.mutex = mutex_create();
+
+    thread_t** workers = (thread_t**)calloc(worker_count, sizeof(thread_t*));
+
+    if (!settings.coeff_cache || !batch.mutex || !workers)
+    {
+        coeff_cache_destroy(settings.coeff_cache);
+        mutex_destroy(batch.mutex);
+        free(workers);
+        return LPF_FILTER_INIT_ERROR;
+    }
+
+    // the calling thread is the first worker
+    for (int i = 1; i < worker_count; ++i)
+        workers[i] = thread_start(batch_worker, &batch);
+
+    batch_worker(&batch);
+
+    for (int i = 1; i < worker_count; ++i)
+        thread_join(workers[i]);
+
+    coeff_cache_destroy(settings.coeff_cache);
+    mutex_destroy(batch.mutex);
+    free(workers);
+
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        if (jobs[i].result != LPF_NO_ERROR)
+            return LPF_FILTER_FILE_ERROR;
+    }
+
+    return LPF_NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Batch worker. Claims and filters jobs until none are left.
+// -----------------------------------------------------------------------------
+void batch_worker(void* arg)
+{
+    batch_t* batch = (batch_t*)arg;
+
+    // each job starts from the batch's settings but keeps the worker's
+    // workspace and threads, so that a worker allocates them once for all
+    // its jobs
+    unsigned char* workspace = NULL;
+    size_t workspace_size = 0;
+    thread_pool_t* thread_pool = NULL;
+    void* input_mapping = malloc(mapped_wav_size());
+
+    for (;;)
+    {
+        mutex_lock(batch->mutex);
+        const size_t index = batch->next_job++;
+        mutex_unlock(batch->mutex);
+
+        if (index >= batch->job_count)
+            break;
+
+        lpf_batch_job_t* job = &batch->jobs[index];
+        low_pass_filter_t lpf = *batch->settings;
+        lpf.cutoff = job->cutoff;
+        lpf.window_type = job->window_type;
+        lpf.workspace = workspace;
+        lpf.workspace_size = workspace_size;
+        lpf.thread_pool = thread_pool;
+        lpf.input_mapping = input_mapping;
+
+        job->result = lpf_filter_file(&lpf,
+                                      job->input_file,
+                                      job->output_file,
+                                      job->window_type,
+                                      &job->frames_filtered);
+
+        workspace = lpf.workspace;
+        workspace_size = lpf.workspace_size;
+        thread_pool = lpf.thread_pool;
+    }
+
+    free(workspace);
+    thread_pool_destroy(thread_pool);
+    free(input_mapping);
+}
+
+// -----------------------------------------------------------------------------
+// Opens a file with libsndfile, or stdin or stdout if it is named
+// LPF_STDIO_NAME.
+//
+// Arguments:
+//     file_name - name of file to open
+//     mode      - SFM_READ or SFM_WRITE
+//     info      - format of the file, as for sf_open
+//
+// Returns:
+//     pointer to open file, or NULL on failure
+// -----------------------------------------------------------------------------
+SNDFILE* open_sound_file(const char* file_name, int mode, SF_INFO* info)
+{
+    if (strcmp(file_name, LPF_STDIO_NAME))
+        return sf_open(file_name, mode, info);
+
+    const int fd = mode == SFM_READ ? LPF_STDIN_FD : LPF_STDOUT_FD;
+
+#ifdef _WIN32
+    // the standard streams start in text mode, which mangles sample data
+    _setmode(fd, _O_BINARY);
+#endif
+
+    return sf_open_fd(fd, mode, info, SF_FALSE);
+}
+
+// -----------------------------------------------------------------------------
+// Opens the input of lpf_filter_file: mapped into memory if it is a WAV file
+// mapped_wav_t handles, through libsndfile otherwise, or as headerless samples
+// if lpf_set_raw_format was given.
+//
+// Arguments:
+//     lpf             - pointer to low pass filter data
+//     input_file_name - name of file to open, or LPF_STDIO_NAME
+//     wav_info        - receives the format of the file
+//     input_wav       - receives the open file
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool open_input_file(const low_pass_filter_t* lpf,
+                     const char* input_file_name,
+                     SF_INFO* wav_info,
+                     audio_file_t* input_wav)
+{
+    *wav_info = lpf->raw_format;
+
+    if (!wav_info->format && lpf->input_mapping &&
+        strcmp(input_file_name, LPF_STDIO_NAME))
+        input_wav->mapped = mapped_wav_open_init(
+            lpf->input_mapping, input_file_name, wav_info);
+    if (!input_wav->mapped)
+        input_wav->sndfile =
+            open_sound_file(input_file_name, SFM_READ, wav_info);
+
+    return input_wav->mapped || input_wav->sndfile;
+}
+
+// -----------------------------------------------------------------------------
+// Creates an output file for an input of the given format, with the same
+// sample format, at the decimated rate. A file of a format mapped_wav_t
+// handles is created at its full length and mapped into memory, its state
+// taken from the workspace.
+//
+// Arguments:
+//     lpf               - pointer to initialised low pass filter data
+//     output_file_name  - name of file to create, or LPF_STDIO_NAME
+//     input_info        - format of the input
+//     frames_to_process - number of frames in the input
+//     output_wav        - receives the open file
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error open_output_file(low_pass_filter_t* lpf,
+                                const char* output_file_name,
+                                const SF_INFO* input_info,
+                                sf_count_t frames_to_process,
+                                audio_file_t* output_wav)
+{
+    SF_INFO wav_info = *input_info;
+
+    const int sample_format = wav_info.format & SF_FORMAT_SUBMASK;
+    const bool raw_input =
+        (wav_info.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_RAW;
+
+    if (!strcmp(output_file_name, LPF_STDIO_NAME))
+        wav_info.format = (raw_input ? SF_FORMAT_RAW : SF_FORMAT_AU);
+    else if (raw_input)
+        wav_info.format = SF_FORMAT_WAV;
+    else
+        wav_info.format &= SF_FORMAT_TYPEMASK;
+
+    wav_info.format |= sample_format;
+
+    if (wav_info.samplerate % lpf->decimation)
+    {
+        eprintf("sample rate is not a multiple of the decimation factor\n");
+        return LPF_SAMPLE_RATE_ERROR;
+    }
+    wav_info.samplerate /= lpf->decimation;
+    if (!sf_format_check(&wav_info))
+        wav_info.format = (wav_info.format & SF_FORMAT_TYPEMASK) |
+                          SF_FORMAT_FLOAT;
+
+    // every output frame comes from an input frame or the flushed tail
+    if (wav_info.seekable && strcmp(output_file_name, LPF_STDIO_NAME))
+    {
+        const sf_count_t max_frames =
+            (frames_to_process + compensated_delay(lpf) + lpf->decimation - 1) /
+            lpf->decimation;
+        void* memory = workspace_alloc(lpf, mapped_wav_size());
+        if (memory)
+            output_wav->mapped = mapped_wav_create_init(
+                memory, output_file_name, &wav_info, max_frames);
+    }
+    if (!output_wav->mapped)
+        output_wav->sndfile =
+            open_sound_file(output_file_name, SFM_WRITE, &wav_info);
+
+    if (!output_wav->mapped && !output_wav->sndfile)
+    {
+        eprintf("unable to open output file %s\n", output_file_name);
+        return LPF_FILE_OPEN_ERROR;
+    }
+
+    return LPF_NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Reads frames from a file as sf_readf_float does, from whichever way it is
+// open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_read(audio_file_t* file,
+                           float* audio_buffer,
+                           sf_count_t frames)
+{
+    if (file->mapped)
+        return mapped_wav_read(file->mapped, audio_buffer, frames);
+
+    return sf_readf_float(file->sndfile, audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Writes frames to a file as sf_writef_float does, to whichever way it is
+// open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_write(audio_file_t* file,
+                            const float* audio_buffer,
+                            sf_count_t frames)
+{
+    if (file->mapped)
+        return mapped_wav_write(file->mapped, audio_buffer, frames);
+
+    return sf_writef_float(file->sndfile, audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Reads 16 or 24 bit PCM frames from a file as sf_readf_short or sf_readf_int
+// does, from whichever way it is open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_read_pcm(audio_file_t* file,
+                               void* audio_buffer,
+                               sf_count_t frames,
+                               int sample_bits)
+{
+    if (file->mapped)
+        return mapped_wav_read_pcm(file->mapped, audio_buffer, frames);
+    else if (sample_bits == 16)
+        return sf_readf_short(file->sndfile, (short*)audio_buffer, frames);
+
+    return sf_readf_int(file->sndfile, (int*)audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Writes 16 or 24 bit PCM frames to a file as sf_writef_short or sf_writef_int
+// does, to whichever way it is open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_write_pcm(audio_file_t* file,
+                                const void* audio_buffer,
+                                sf_count_t frames,
+                                int sample_bits)
+{
+    if (file->mapped)
+        return mapped_wav_write_pcm(file->mapped, audio_buffer, frames);
+    else if (sample_bits == 16)
+        return sf_writef_short(
+            file->sndfile, (const short*)audio_buffer, frames);
+
+    return sf_writef_int(file->sndfile, (const int*)audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Reads frames from a file as sf_readf_double does, from whichever way it is
+// open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_read_double(audio_file_t* file,
+                                  double* audio_buffer,
+                                  sf_count_t frames)
+{
+    if (file->mapped)
+        return mapped_wav_read_double(file->mapped, audio_buffer, frames);
+
+    return sf_readf_double(file->sndfile, audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Writes frames to a file as sf_writef_double does, to whichever way it is
+// open.
+// -----------------------------------------------------------------------------
+sf_count_t audio_file_write_double(audio_file_t* file,
+                                   const double* audio_buffer,
+                                   sf_count_t frames)
+{
+    if (file->mapped)
+        return mapped_wav_write_double(file->mapped, audio_buffer, frames);
+
+    return sf_writef_double(file->sndfile, audio_buffer, frames);
+}
+
+// -----------------------------------------------------------------------------
+// Closes a file opened either way, returning nonzero on failure.
+// -----------------------------------------------------------------------------
+int audio_file_close(audio_file_t* file)
+{
+    if (file->mapped)
+        return mapped_wav_close(file->mapped);
+
+    return sf_close(file->sndfile);
+}
+
+// -----------------------------------------------------------------------------
+// Filters an open file one block at a time on the calling thread, or with
+// reading and writing on their own threads when lpf->pipeline_depth is set.
+//
+// Arguments:
+//     lpf               - pointer to initialised low pass filter data
+//     input_wav         - file to read from
+//     output_wav        - file to write to
+//     frames_to_process - number of frames in input_wav
+//     frames_processed  - receives the number of frames written
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error filter_file_serial(low_pass_filter_t* lpf,
+                                  audio_file_t* input_wav,
+                                  audio_file_t* output_wav,
+                                  sf_count_t frames_to_process,
+                                  sf_count_t* frames_processed)
+{
+    // overlap-save costs the same per FFT however few frames it is given, so
+    // read at least a whole FFT step at a time
+    size_t block_size = lpf->buffer_size;
+    if (lpf->convolver && overlap_save_step(lpf->convolver) > block_size)
+        block_size = overlap_save_step(lpf->convolver);
+
+    if (lpf->pipeline_depth > 0 && input_wav->sndfile && output_wav->sndfile)
+    {
+        const enum pipeline_status status = pipeline_run(input_wav->sndfile,
+                                                         output_wav->sndfile,
+                                                         lpf->channel_count,
+                                                         block_size,
+                                                         lpf->pipeline_depth,
+                                                         frames_to_process,
+                                                         filter_block,
+                                                         lpf,
+                                                         frames_processed);
+        switch (status)
+        {
+        case PIPELINE_OK:
+            return flush_filter(lpf, output_wav, frames_processed);
+        case PIPELINE_INIT_ERROR: return LPF_FILTER_INIT_ERROR;
+        case PIPELINE_WRITE_ERROR:
+            eprintf("not all frames were written to the output file\n");
+            return LPF_FILE_WRITE_ERROR;
+        }
+    }
+
+    float* audio_buffer = (float*)workspace_alloc(
+        lpf, block_size * (size_t)lpf->channel_count * sizeof(float));
+    if (!audio_buffer)
+        return LPF_FILTER_INIT_ERROR;
+
+    enum lpf_error retcode = LPF_NO_ERROR;
+    sf_count_t frames_remaining = frames_to_process;
+    *frames_processed = 0;
+
+    while (frames_remaining > 0)
+    {
+        uint64_t mark = stage_start(lpf);
+
+        const sf_count_t frames_read =
+            audio_file_read(input_wav, audio_buffer, block_size);
+
+        mark = stage_end(lpf, &lpf->stats.read_ns, mark);
+
+        if (frames_read <= 0)
+            break;
+
+        frames_remaining -= frames_read;
+        lpf->stats.frames_read += frames_read;
+
+        const sf_count_t frames_filtered =
+            filter_buffer(lpf, audio_buffer, frames_read);
+
+        mark = filter_end(lpf, mark);
+
+        const sf_count_t frames_written =
+            audio_file_write(output_wav, audio_buffer, frames_filtered);
+
+        stage_end(lpf, &lpf->stats.write_ns, mark);
+
+        if (frames_written != frames_filtered)
+        {
+            eprintf("not all frames were written to the output file\n");
+            retcode = LPF_FILE_WRITE_ERROR;
+            break;
+        }
+
+        *frames_processed += frames_written;
+    }
+
+    if (retcode == LPF_NO_ERROR)
+        retcode = flush_filter(lpf, output_wav, frames_processed);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of frames lpf_filter_file trims from the start of the output
+// and flushes from the end, zero unless delay compensation applies.
+// -----------------------------------------------------------------------------
+sf_count_t compensated_delay(const low_pass_filter_t* lpf)
+{
+    if (!lpf->delay_compensation || lpf->phase != LPF_PHASE_LINEAR ||
+        lpf->engine == LPF_ENGINE_IIR)
+        return 0;
+
+    return lpf->order / 2;
+}
+
+// -----------------------------------------------------------------------------
+// Feeds the filter the silence that flushes out a delay compensated tail, and
+// writes the result.
+//
+// Arguments:
+//     lpf              - pointer to low pass filter data that has filtered
+//                        the whole input
+//     output_wav       - file to write to
+//     frames_processed - number of frames written, added to
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error flush_filter(low_pass_filter_t* lpf,
+                            audio_file_t* output_wav,
+                            sf_count_t* frames_processed)
+{
+    const sf_count_t frames = compensated_delay(lpf);
+    if (frames == 0)
+        return LPF_NO_ERROR;
+
+    float* silence = (float*)workspace_alloc(
+        lpf, (size_t)frames * lpf->channel_count * sizeof(float));
+    if (!silence)
+        return LPF_FILTER_INIT_ERROR;
+
+    const sf_count_t frames_filtered = filter_buffer(lpf, silence, frames);
+    const sf_count_t frames_written =
+        audio_file_write(output_wav, silence, frames_filtered);
+
+    *frames_processed += frames_written;
+
+    if (frames_written != frames_filtered)
+    {
+        eprintf("not all frames were written to the output file\n");
+        return LPF_FILE_WRITE_ERROR;
+    }
+
+    return LPF_NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Adapts filter_buffer to the pipeline's filter stage.
+// -----------------------------------------------------------------------------
+sf_count_t filter_block(void* context, float* audio_buffer, sf_count_t frames)
+{
+    low_pass_filter_t* lpf = (low_pass_filter_t*)context;
+    const uint64_t start = stage_start(lpf);
+
+    const sf_count_t frames_filtered = filter_buffer(lpf, audio_buffer, frames);
+
+    filter_end(lpf, start);
+    lpf->stats.frames_read += frames;
+
+    return frames_filtered;
+}
+
+// -----------------------------------------------------------------------------
+// Filters an open file on lpf->thread_count threads, a chunk at a time. Chunks
+// are read into a buffer that keeps the last order input frames of the
+// previous chunk in front of them, which is all the history any output needs,
+// so each chunk can be split freely between threads. With lpf->pipeline_depth
+// set, reading and writing run on their own threads around the threaded
+// filter, as they do around the serial one.
+//
+// Arguments:
+//     lpf               - pointer to initialised low pass filter data
+//     input_wav         - file to read from
+//     output_wav        - file to write to
+//     frames_to_process - number of frames in input_wav
+//     frames_processed  - receives the number of frames written
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error filter_file_threaded(low_pass_filter_t* lpf,
+                                    audio_file_t* input_wav,
+                                    audio_file_t* output_wav,
+                                    sf_count_t frames_to_process,
+                                    sf_count_t* frames_processed)
+{
+    const int channels = lpf->channel_count;
+    const size_t history = (size_t)lpf->order;
+
+    const size_t segment_frames = segment_frames_for(lpf->buffer_size);
+
+    // the threads are kept from file to file
+    if (!lpf->thread_pool)
+        lpf->thread_pool = thread_pool_create(lpf->thread_count);
+    if (!lpf->thread_pool)
+        return LPF_FILTER_INIT_ERROR;
+
+    const int job_count = thread_pool_size(lpf->thread_pool);
+    void* memory = workspace_alloc(
+        lpf,
+        parallel_filter_size(
+            lpf->order + 1, channels, job_count, segment_frames));
+    if (!memory)
+        return LPF_FILTER_INIT_ERROR;
+
+    threaded_file_t file;
+    file.lpf = lpf;
+    file.pf = parallel_filter_init(memory,
+                                   lpf->coeffs,
+                                   lpf->order + 1,
+                                   lpf->block_dot_product,
+                                   lpf->block_folded_dot_product,
+                                   channels,
+                                   lpf->thread_pool,
+                                   segment_frames);
+
+    const size_t chunk_frames = parallel_filter_chunk_frames(file.pf);
+    file.input = (float*)workspace_alloc(
+        lpf, (history + chunk_frames) * channels * sizeof(float));
+    file.output = (float*)workspace_alloc(
+        lpf, chunk_frames * channels * sizeof(float));
+    float* chunk = file.input + history * channels;
+
+    enum lpf_error retcode = file.input && file.output
+                                 ? LPF_NO_ERROR
+                                 : LPF_FILTER_INIT_ERROR;
+    *frames_processed = 0;
+
+    if (retcode == LPF_NO_ERROR && lpf->pipeline_depth > 0 &&
+        input_wav->sndfile && output_wav->sndfile)
+    {
+        const enum pipeline_status status = pipeline_run(input_wav->sndfile,
+                                                         output_wav->sndfile,
+                                                         channels,
+                                                         chunk_frames,
+                                                         lpf->pipeline_depth,
+                                                         frames_to_process,
+                                                         filter_chunk_block,
+                                                         &file,
+                                                         frames_processed);
+        if (status == PIPELINE_INIT_ERROR)
+        {
+            retcode = LPF_FILTER_INIT_ERROR;
+        }
+        else if (status == PIPELINE_WRITE_ERROR)
+        {
+            eprintf("not all frames were written to the output file\n");
+            retcode = LPF_FILE_WRITE_ERROR;
+        }
+    }
+    else
+    {
+        sf_count_t frames_remaining = frames_to_process;
+
+        while (retcode == LPF_NO_ERROR && frames_remaining > 0)
+        {
+            uint64_t mark = stage_start(lpf);
+
+            const sf_count_t frames_read = audio_file_read(
+                input_wav, chunk, (sf_count_t)chunk_frames);
+
+            mark = stage_end(lpf, &lpf->stats.read_ns, mark);
+
+            if (frames_read <= 0)
+                break;
+
+            frames_remaining -= frames_read;
+            lpf->stats.frames_read += frames_read;
+
+            const sf_count_t frames_kept =
+                filter_chunk(&file, chunk, frames_read);
+
+            mark = filter_end(lpf, mark);
+
+            const sf_count_t frames_written =
+                audio_file_write(output_wav, chunk, frames_kept);
+            if (frames_written != frames_kept)
+            {
+                eprintf("not all frames were written to the output file\n");
+                retcode = LPF_FILE_WRITE_ERROR;
+            }
+
+            stage_end(lpf, &lpf->stats.write_ns, mark);
+
+            *frames_processed += frames_written;
+        }
+    }
+
+    // once the input is exhausted, silence flushes out a delay compensated
+    // tail
+    sf_count_t frames_to_flush = compensated_delay(lpf);
+    while (retcode == LPF_NO_ERROR && frames_to_flush > 0)
+    {
+        const sf_count_t frames = frames_to_flush < (sf_count_t)chunk_frames
+                                      ? frames_to_flush
+                                      : (sf_count_t)chunk_frames;
+        memset(chunk, 0, (size_t)frames * channels * sizeof(float));
+        frames_to_flush -= frames;
+
+        const sf_count_t frames_kept = filter_chunk(&file, chunk, frames);
+        const sf_count_t frames_written =
+            audio_file_write(output_wav, chunk, frames_kept);
+
+        *frames_processed += frames_written;
+
+        if (frames_written != frames_kept)
+        {
+            eprintf("not all frames were written to the output file\n");
+            retcode = LPF_FILE_WRITE_ERROR;
+        }
+    }
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a chunk of a file on several threads, in place. The chunk is copied
+// behind the history unless it was read there, and the outputs before the
+// first input are dropped when compensating for the filter delay.
+//
+// Arguments:
+//     file         - file being filtered
+//     audio_buffer - chunk of at most parallel_filter_chunk_frames frames
+//     frames       - length of chunk
+//
+// Returns:
+//     number of output frames at the start of audio_buffer
+// -----------------------------------------------------------------------------
+sf_count_t filter_chunk(threaded_file_t* file,
+                        float* audio_buffer,
+                        sf_count_t frames)
+{
+    low_pass_filter_t* lpf = file->lpf;
+    const int channels = lpf->channel_count;
+    const size_t history = (size_t)lpf->order;
+    float* chunk = file->input + history * channels;
+
+    if (audio_buffer != chunk)
+        memcpy(chunk, audio_buffer, (size_t)frames * channels * sizeof(float));
+
+    parallel_filter_process(file->pf, chunk, file->output, (size_t)frames);
+
+    // the end of the chunk is the next one's history
+    memmove(file->input,
+            file->input + (size_t)frames * channels,
+            history * channels * sizeof(float));
+
+    sf_count_t trim = lpf->frames_to_trim;
+    if (trim > frames)
+        trim = frames;
+    lpf->frames_to_trim -= trim;
+
+    memcpy(audio_buffer,
+           file->output + (size_t)trim * channels,
+           (size_t)(frames - trim) * channels * sizeof(float));
+
+    return frames - trim;
+}
+
+// -----------------------------------------------------------------------------
+// Adapts filter_chunk to the pipeline's filter stage.
+// -----------------------------------------------------------------------------
+sf_count_t filter_chunk_block(void* context,
+                              float* audio_buffer,
+                              sf_count_t frames)
+{
+    threaded_file_t* file = (threaded_file_t*)context;
+    const uint64_t start = stage_start(file->lpf);
+
+    const sf_count_t frames_filtered = filter_chunk(file, audio_buffer, frames);
+
+    filter_end(file->lpf, start);
+    file->lpf->stats.frames_read += frames;
+
+    return frames_filtered;
+}
+
+// -----------------------------------------------------------------------------
+// Filters an open file of 16 or 24 bit PCM in fixed point, one block at a time
+// on the calling thread. Samples are read and written as integers of their
+// own width and never converted to float.
+//
+// Arguments:
+//     lpf               - pointer to low pass filter data initialised for
+//                         fixed point
+//     input_wav         - file to read from
+//     output_wav        - file to write to
+//     frames_to_process - number of frames in input_wav
+//     frames_processed  - receives the number of frames written
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error filter_file_fixed(low_pass_filter_t* lpf,
+                                 audio_file_t* input_wav,
+                                 audio_file_t* output_wav,
+                                 sf_count_t frames_to_process,
+                                 sf_count_t* frames_processed)
+{
+    const int bits = lpf->fixed_point_bits;
+    const size_t frame_size = (size_t)lpf->channel_count *
+                              (bits == 16 ? sizeof(int16_t) : sizeof(int32_t));
+    const sf_count_t block_size = (sf_count_t)lpf->buffer_size;
+
+    unsigned char* audio_buffer =
+        (unsigned char*)workspace_alloc(lpf, lpf->buffer_size * frame_size);
+    if (!audio_buffer)
+        return LPF_FILTER_INIT_ERROR;
+
+    enum lpf_error retcode = LPF_NO_ERROR;
+    sf_count_t frames_remaining = frames_to_process;
+    sf_count_t frames_to_flush = compensated_delay(lpf);
+    *frames_processed = 0;
+
+    while (retcode == LPF_NO_ERROR)
+    {
+        uint64_t mark = stage_start(lpf);
+
+        sf_count_t frames_read =
+            frames_remaining > 0
+                ? audio_file_read_pcm(input_wav, audio_buffer, block_size, bits)
+                : 0;
+
+        mark = stage_end(lpf, &lpf->stats.read_ns, mark);
+
+        // once the input is exhausted, silence flushes out a delay
+        // compensated tail
+        if (frames_read <= 0)
+        {
+            if (frames_to_flush == 0)
+                break;
+
+            frames_read =
+                frames_to_flush < block_size ? frames_to_flush : block_size;
+            memset(audio_buffer, 0, (size_t)frames_read * frame_size);
+            frames_to_flush -= frames_read;
+            frames_remaining = 0;
+        }
+        else
+        {
+            frames_remaining -= frames_read;
+            lpf->stats.frames_read += frames_read;
+        }
+
+        fixed_fir_process(lpf->fixed_fir, audio_buffer, (size_t)frames_read);
+
+        mark = filter_end(lpf, mark);
+
+        // and the outputs before the first input are dropped
+        sf_count_t trim = lpf->frames_to_trim;
+        if (trim > frames_read)
+            trim = frames_read;
+        lpf->frames_to_trim -= trim;
+
+        const sf_count_t frames_kept = frames_read - trim;
+        const sf_count_t frames_written =
+            audio_file_write_pcm(output_wav,
+                                 audio_buffer + (size_t)trim * frame_size,
+                                 frames_kept,
+                                 bits);
+        if (frames_written != frames_kept)
+        {
+            eprintf("not all frames were written to the output file\n");
+            retcode = LPF_FILE_WRITE_ERROR;
+        }
+
+        stage_end(lpf, &lpf->stats.write_ns, mark);
+
+        *frames_processed += frames_written;
+    }
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters an open file in one of the higher precision arithmetics, one block
+// at a time on the calling thread. Samples are read and written as doubles,
+// so each output is rounded once, to the width of the file.
+//
+// Arguments:
+//     lpf               - pointer to low pass filter data initialised for a
+//                         higher precision arithmetic
+//     input_wav         - file to read from
+//     output_wav        - file to write to
+//     frames_to_process - number of frames in input_wav
+//     frames_processed  - receives the number of frames written
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error filter_file_precise(low_pass_filter_t* lpf,
+                                   audio_file_t* input_wav,
+                                   audio_file_t* output_wav,
+                                   sf_count_t frames_to_process,
+                                   sf_count_t* frames_processed)
+{
+    const int channels = lpf->channel_count;
+    const sf_count_t block_size = (sf_count_t)lpf->buffer_size;
+
+    double* audio_buffer = (double*)workspace_alloc(
+        lpf, lpf->buffer_size * channels * sizeof(double));
+    if (!audio_buffer)
+        return LPF_FILTER_INIT_ERROR;
+
+    enum lpf_error retcode = LPF_NO_ERROR;
+    sf_count_t frames_remaining = frames_to_process;
+    sf_count_t frames_to_flush = compensated_delay(lpf);
+    *frames_processed = 0;
+
+    while (retcode == LPF_NO_ERROR)
+    {
+        uint64_t mark = stage_start(lpf);
+
+        sf_count_t frames_read =
+            frames_remaining > 0
+                ? audio_file_read_double(input_wav, audio_buffer, block_size)
+                : 0;
+
+        mark = stage_end(lpf, &lpf->stats.read_ns, mark);
+
+        // once the input is exhausted, silence flushes out a delay
+        // compensated tail
+        if (frames_read <= 0)
+        {
+            if (frames_to_flush == 0)
+                break;
+
+            frames_read =
+                frames_to_flush < block_size ? frames_to_flush : block_size;
+            memset(audio_buffer,
+                   0,
+                   (size_t)frames_read * channels * sizeof(double));
+            frames_to_flush -= frames_read;
+            frames_remaining = 0;
+        }
+        else
+        {
+            frames_remaining -= frames_read;
+            lpf->stats.frames_read += frames_read;
+        }
+
+        precise_fir_process(
+            lpf->precise_fir, audio_buffer, (size_t)frames_read);
+
+        mark = filter_end(lpf, mark);
+
+        // and the outputs before the first input are dropped
+        sf_count_t trim = lpf->frames_to_trim;
+        if (trim > frames_read)
+            trim = frames_read;
+        lpf->frames_to_trim -= trim;
+
+        const sf_count_t frames_kept = frames_read - trim;
+        const sf_count_t frames_written =
+            audio_file_write_double(output_wav,
+                                    audio_buffer + (size_t)trim * channels,
+                                    frames_kept);
+        if (frames_written != frames_kept)
+        {
+            eprintf("not all frames were written to the output file\n");
+            retcode = LPF_FILE_WRITE_ERROR;
+        }
+
+        stage_end(lpf, &lpf->stats.write_ns, mark);
+
+        *frames_processed += frames_written;
+    }
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Filters an open file with a filter bank, one block at a time on the calling
+// thread, writing each band to its own file.
+//
+// Arguments:
+//     lpf               - pointer to low pass filter data, for the delay to
+//                         trim and the stats
+//     bank              - filter bank with one band per output
+//     input_wav         - file to read from
+//     output_wavs       - files to write to, one per band
+//     band_count        - number of bands
+//     frames_to_process - number of frames in input_wav
+//     frames_processed  - receives the number of frames written to each output
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error filter_file_bank(low_pass_filter_t* lpf,
+                                filter_bank_t* bank,
+                                audio_file_t* input_wav,
+                                audio_file_t* output_wavs,
+                                size_t band_count,
+                                sf_count_t frames_to_process,
+                                sf_count_t* frames_processed)
+{
+    const int channels = lpf->channel_count;
+
+    // an FFT bank is only efficient given at least a step at a time
+    size_t block_frames = lpf->buffer_size;
+    if (filter_bank_step(bank) > block_frames)
+        block_frames = filter_bank_step(bank);
+
+    const sf_count_t block_size = (sf_count_t)block_frames;
+    const size_t block_samples = block_frames * channels;
+
+    float* input =
+        (float*)workspace_alloc(lpf, block_samples * sizeof(float));
+    float* output = (float*)workspace_alloc(
+        lpf, block_samples * band_count * sizeof(float));
+    float** outputs =
+        (float**)workspace_alloc(lpf, band_count * sizeof(float*));
+    if (!input || !output || !outputs)
+        return LPF_FILTER_INIT_ERROR;
+
+    for (size_t b = 0; b < band_count; ++b)
+        outputs[b] = output + b * block_samples;
+
+    enum lpf_error retcode = LPF_NO_ERROR;
+    sf_count_t frames_remaining = frames_to_process;
+    sf_count_t frames_to_flush = compensated_delay(lpf);
+    *frames_processed = 0;
+
+    while (retcode == LPF_NO_ERROR)
+    {
+        uint64_t mark = stage_start(lpf);
+
+        sf_count_t frames_read =
+            frames_remaining > 0
+                ? audio_file_read(input_wav, input, block_size)
+                : 0;
+
+        mark = stage_end(lpf, &lpf->stats.read_ns, mark);
+
+        // once the input is exhausted, silence flushes out a delay
+        // compensated tail
+        if (frames_read <= 0)
+        {
+            if (frames_to_flush == 0)
+                break;
+
+            frames_read =
+                frames_to_flush < block_size ? frames_to_flush : block_size;
+            memset(input, 0, (size_t)frames_read * channels * sizeof(float));
+            frames_to_flush -= frames_read;
+            frames_remaining = 0;
+        }
+        else
+        {
+            frames_remaining -= frames_read;
+            lpf->stats.frames_read += frames_read;
+        }
+
+        filter_bank_process(bank, input, outputs, (size_t)frames_read);
+
+        mark = filter_end(lpf, mark);
+
+        // and the outputs before the first input are dropped
+        sf_count_t trim = lpf->frames_to_trim;
+        if (trim > frames_read)
+            trim = frames_read;
+        lpf->frames_to_trim -= trim;
+
+        // count only the frames every band's file received
+        const sf_count_t frames_kept = frames_read - trim;
+        sf_count_t frames_written = frames_kept;
+        for (size_t b = 0; b < band_count; ++b)
+        {
+            const sf_count_t band_written =
+                audio_file_write(&output_wavs[b],
+                                 outputs[b] + trim * channels,
+                                 frames_kept);
+            if (band_written != frames_kept)
+            {
+                eprintf("not all frames were written to the output file\n");
+                retcode = LPF_FILE_WRITE_ERROR;
+            }
+            if (band_written < frames_written)
+                frames_written = band_written;
+        }
+
+        stage_end(lpf, &lpf->stats.write_ns, mark);
+
+        *frames_processed += frames_written;
+    }
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the sample width lpf_filter_file filters a file of sample_format at in
+// fixed point: 16 or 24, or 0 to filter it in float. A filter convolved by FFT,
+// as uses_fft decides for lpf_workspace_size, is filtered in float.
+// -----------------------------------------------------------------------------
+int fixed_point_width(const low_pass_filter_t* lpf,
+                      int sample_format,
+                      size_t filter_length)
+{
+    if (lpf->arithmetic != LPF_ARITHMETIC_FIXED ||
+        lpf->engine == LPF_ENGINE_IIR || uses_fft(lpf, filter_length) ||
+        lpf->envelope_length > 0 || lpf->decimation != 1)
+        return 0;
+
+    switch (sample_format)
+    {
+    case SF_FORMAT_PCM_16: return 16;
+    case SF_FORMAT_PCM_24: return 24;
+    default: return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether lpf_filter_file filters in one of the higher precision
+// arithmetics, which it does for any sample format under the same conditions
+// as fixed point, except that on the automatic engine it does at any length.
+// -----------------------------------------------------------------------------
+bool uses_precise(const low_pass_filter_t* lpf)
+{
+    return (lpf->arithmetic == LPF_ARITHMETIC_DOUBLE_SUM ||
+            lpf->arithmetic == LPF_ARITHMETIC_KAHAN ||
+            lpf->arithmetic == LPF_ARITHMETIC_DOUBLE) &&
+           lpf->engine != LPF_ENGINE_IIR && lpf->engine != LPF_ENGINE_FFT &&
+           lpf->envelope_length == 0 && lpf->decimation == 1;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the precise_fir_t mode of the higher precision arithmetic set.
+// -----------------------------------------------------------------------------
+enum precise_fir_mode precise_mode(const low_pass_filter_t* lpf)
+{
+    if (lpf->arithmetic == LPF_ARITHMETIC_DOUBLE_SUM)
+        return PRECISE_FIR_DOUBLE_SUM;
+    else if (lpf->arithmetic == LPF_ARITHMETIC_KAHAN)
+        return PRECISE_FIR_COMPENSATED;
+
+    return PRECISE_FIR_DOUBLE;
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether lpf_filter_file may filter on several threads: a direct form
+// float filter, unmodulated and undecimated, with more than one thread set.
+// -----------------------------------------------------------------------------
+bool uses_threads(const low_pass_filter_t* lpf, size_t filter_length)
+{
+    return lpf->thread_count > 1 && lpf->engine != LPF_ENGINE_IIR &&
+           !uses_fft(lpf, filter_length) && lpf->envelope_length == 0 &&
+           lpf->decimation == 1 && !uses_precise(lpf);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the frames of one channel each thread filters per chunk, the block size
+// or LPF_THREAD_SEGMENT_FRAMES, whichever is longer.
+// -----------------------------------------------------------------------------
+size_t segment_frames_for(size_t buffer_size)
+{
+    return buffer_size > LPF_THREAD_SEGMENT_FRAMES ? buffer_size
+                                                   : LPF_THREAD_SEGMENT_FRAMES;
+}
+
+// -----------------------------------------------------------------------------
+// Initialises coefficients.
+//
+// Arguments:
+//     lpf - lpf - pointer to low pass filter data
+//     sample_rate - sample rate
+//     cutoff - -6dB point of filter
+//     window_type - window to apply to filter coefficients
+//
+// Returns:
+//     LPF_NO_ERROR on success
+// -----------------------------------------------------------------------------
+enum lpf_error init_filter(low_pass_filter_t* lpf,
+                           float sample_rate,
+                           int channels,
+                           enum window_t window_type)
+{
+    // anything left from an earlier file or lpf_prepare
+    release_filter(lpf);
+
+    // before sizing anything by it
+    if (design_order(lpf, sample_rate) > LPF_MAX_ORDER)
+        return LPF_CUTOFF_ERROR;
+
+    lpf->buffer_size = block_size_for(
+        lpf, (size_t)design_order(lpf, sample_rate) + 1, channels);
+
+    const enum lpf_error workspace_error = reserve_workspace(
+        lpf, lpf_workspace_size(lpf, sample_rate, channels));
+    if (workspace_error)
+        return workspace_error;
+
+    const bool modulated = lpf->envelope_length > 0;
+    const float highest_cutoff =
+        modulated ? lpf->envelope_highest : lpf->cutoff;
+
+    if (highest_cutoff <= 0)
+        return LPF_CUTOFF_ERROR;
+    else if (sample_rate <= 0)
+        return LPF_SAMPLE_RATE_ERROR;
+    else if (2.0f * highest_cutoff * lpf->decimation > sample_rate)
+        return LPF_CUTOFF_ERROR;
+
+    lpf->newest_sample = 0;
+    lpf->decimation_phase = 0;
+    lpf->frames_to_trim = 0;
+    lpf->channel_count = channels;
+    lpf->sample_rate = sample_rate;
+    lpf->envelope_index = 0;
+    lpf->manual_cutoff = 0.0f;
+    lpf->modulation_frame = 0;
+
+    // the IIR engine has neither taps nor a delay line
+    if (lpf->engine == LPF_ENGINE_IIR)
+    {
+        void* memory = workspace_alloc(
+            lpf,
+            biquad_cascade_size(lpf->iir_response, lpf->iir_order, channels));
+        if (memory)
+            lpf->iir = biquad_cascade_init(memory,
+                                           lpf->iir_response,
+                                           lpf->iir_order,
+                                           modulated ? modulated_cutoff(lpf)
+                                                     : lpf->cutoff,
+                                           sample_rate,
+                                           channels);
+        return lpf->iir ? LPF_NO_ERROR : LPF_FILTER_INIT_ERROR;
+    }
+
+    const enum lpf_error spec_error =
+        apply_design_spec(lpf, highest_cutoff, sample_rate, &window_type);
+    if (spec_error)
+        return spec_error;
+
+    filter_design_t design;
+    design.cutoff = lpf->cutoff;
+    design.sample_rate = sample_rate;
+    design.order = lpf->order;
+    design.window_type = window_type;
+    design.kaiser_beta = lpf->kaiser_beta;
+    design.phase = lpf->phase;
+
+    // the higher precision arithmetics design their own coefficients and
+    // keep their own delay lines
+    if (lpf->precise)
+    {
+        const enum precise_fir_mode mode = precise_mode(lpf);
+        void* memory = workspace_alloc(
+            lpf,
+            precise_fir_size(
+                lpf->order + 1, channels, mode, lpf->buffer_size));
+        if (memory)
+            lpf->precise_fir = precise_fir_init(memory,
+                                                &design,
+                                                channels,
+                                                mode,
+                                                lpf->buffer_size,
+                                                lpf->simd_level);
+        return lpf->precise_fir ? LPF_NO_ERROR : LPF_FILTER_INIT_ERROR;
+    }
+
+    const size_t filter_length = (size_t)lpf->order + 1ull;
+    lpf->past_input_samples = (float*)workspace_alloc(
+        lpf, delay_line_length(lpf) * (size_t)channels * sizeof(float));
+
+    // a modulated filter interpolates its own coefficients from a bank, and
+    // a batch shares one design of each distinct filter between its workers
+    if (modulated)
+    {
+        void* memory = workspace_alloc(
+            lpf,
+            cutoff_bank_size(
+                &design, lpf->envelope_lowest, lpf->envelope_highest));
+        if (memory)
+            lpf->cutoff_bank = cutoff_bank_init(memory,
+                                                &design,
+                                                lpf->envelope_lowest,
+                                                lpf->envelope_highest);
+        if (lpf->cutoff_bank)
+            lpf->coeffs =
+                (float*)workspace_alloc(lpf, filter_length * sizeof(float));
+        if (lpf->coeffs)
+        {
+            cutoff_bank_interpolate(
+                lpf->cutoff_bank, modulated_cutoff(lpf), lpf->coeffs);
+        }
+    }
+    else if (lpf->coeff_cache)
+    {
+        lpf->coeffs = (float*)coeff_cache_get(lpf->coeff_cache, &design);
+    }
+    else
+    {
+        lpf->coeffs =
+            (float*)workspace_alloc(lpf, filter_length * sizeof(float));
+        if (lpf->coeffs && !design_low_pass(lpf->coeffs, &design))
+            lpf->coeffs = NULL;
+    }
+
+    if (!lpf->coeffs || !lpf->past_input_samples)
+        return LPF_FILTER_INIT_ERROR;
+
+    // linear phase coefficients let each pair of taps share one multiply
+    lpf->dot_product =
+        fir_select_kernel(lpf->simd_level, lpf->coeffs, (int)filter_length);
+    lpf->block_folded_dot_product = fir_select_block_folded_kernel(
+        lpf->simd_level, lpf->coeffs, (int)filter_length);
+
+    if (lpf->fixed_point_bits)
+    {
+        void* memory = workspace_alloc(lpf,
+                                       fixed_fir_size((int)filter_length,
+                                                      channels,
+                                                      lpf->fixed_point_bits,
+                                                      lpf->buffer_size));
+        if (memory)
+            lpf->fixed_fir = fixed_fir_init(memory,
+                                            lpf->coeffs,
+                                            (int)filter_length,
+                                            channels,
+                                            lpf->fixed_point_bits,
+                                            lpf->buffer_size,
+                                            lpf->simd_level);
+        return lpf->fixed_fir ? LPF_NO_ERROR : LPF_FILTER_INIT_ERROR;
+    }
+
+    if (uses_fft(lpf, filter_length))
+    {
+        void* memory = workspace_alloc(
+            lpf, overlap_save_size(filter_length, channels));
+        if (!memory)
+            return LPF_FILTER_INIT_ERROR;
+
+        lpf->convolver =
+            overlap_save_init(memory, lpf->coeffs, filter_length, channels);
+    }
+
+    return LPF_NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Fixes the order for this sample rate and the window to kaiser when a design
+// spec is set, since the spec's transition width is in Hz.
+//
+// Arguments:
+//     lpf            - pointer to low pass filter data
+//     highest_cutoff - highest cutoff the filter will be designed for
+//     sample_rate    - sample rate
+//     window_type    - window to design with, replaced by kaiser
+//
+// Returns:
+//     LPF_NO_ERROR, or LPF_CUTOFF_ERROR if the stopband is above Nyquist or
+//     the order is above LPF_MAX_ORDER
+// -----------------------------------------------------------------------------
+enum lpf_error apply_design_spec(low_pass_filter_t* lpf,
+                                 float highest_cutoff,
+                                 float sample_rate,
+                                 enum window_t* window_type)
+{
+    if (lpf->transition_width > 0)
+    {
+        if (2.0f * highest_cutoff + lpf->transition_width > sample_rate)
+            return LPF_CUTOFF_ERROR;
+        else if (design_order(lpf, sample_rate) > LPF_MAX_ORDER)
+            return LPF_CUTOFF_ERROR;
+
+        lpf->order = design_order(lpf, sample_rate);
+        *window_type = KAISER;
+    }
+
+    return LPF_NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Prints which limit a cutoff rejected with LPF_CUTOFF_ERROR broke.
+//
+// Arguments:
+//     lpf            - pointer to low pass filter data
+//     highest_cutoff - highest cutoff the filter was to be designed for
+//     sample_rate    - input sample rate
+// -----------------------------------------------------------------------------
+void print_cutoff_error(const low_pass_filter_t* lpf,
+                        float highest_cutoff,
+                        float sample_rate)
+{
+    if (highest_cutoff <= 0)
+        eprintf("cutoff must be positive\n");
+    else if (2.0f * highest_cutoff * lpf->decimation > sample_rate)
+        eprintf("cutoff is above the output Nyquist frequency\n");
+    else if (2.0f * highest_cutoff + lpf->transition_width > sample_rate)
+        eprintf("stopband edge is above the Nyquist frequency\n");
+    else
+        eprintf("design spec needs an order above %d\n", LPF_MAX_ORDER);
+}
+
+// -----------------------------------------------------------------------------
+// Processes buffer.
+//
+// Each channel's history is a mirrored delay line: every sample is written
+// both at newest_sample and filter_length places after it, so the last
+// filter_length inputs, newest first, are always contiguous from newest_sample
+// and the taps are a single unit-stride dot product, done by the SIMD kernel
+// selected for this CPU, folded when the coefficients are symmetric. When
+// decimating, every input enters the history but only the kept outputs are
+// computed, packed at the start of the buffer.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     audio_buffer - buffer of samples
+//     samples_read - length of buffer
+//
+// Returns:
+//     number of output frames at the start of audio_buffer
+// -----------------------------------------------------------------------------
+sf_count_t filter_buffer(low_pass_filter_t* lpf,
+                         float* audio_buffer,
+                         sf_count_t frames_read)
+{
+    if (!lpf->envelope_length)
+        return filter_segment(lpf, audio_buffer, frames_read);
+
+    // a modulated filter moves its cutoff every LPF_MODULATION_FRAMES input
+    // frames, counted from the start so that the output does not depend on
+    // how the input is split into buffers, and the outputs of each segment
+    // are packed after those of the segments before
+    const int channels = lpf->channel_count;
+    sf_count_t frames_out = 0;
+    sf_count_t frames = 0;
+
+    for (sf_count_t offset = 0; offset < frames_read; offset += frames)
+    {
+        const sf_count_t phase = lpf->modulation_frame % LPF_MODULATION_FRAMES;
+        frames = LPF_MODULATION_FRAMES - phase;
+        if (frames > frames_read - offset)
+            frames = frames_read - offset;
+
+        if (phase == 0)
+        {
+            const float cutoff = modulated_cutoff(lpf);
+            if (lpf->iir)
+                biquad_cascade_set_cutoff(lpf->iir, cutoff, lpf->sample_rate);
+            else
+                cutoff_bank_interpolate(lpf->cutoff_bank, cutoff, lpf->coeffs);
+        }
+
+        float* segment = audio_buffer + offset * channels;
+        const sf_count_t segment_out = filter_segment(lpf, segment, frames);
+        memmove(audio_buffer + frames_out * channels,
+                segment,
+                (size_t)segment_out * channels * sizeof(float));
+
+        frames_out += segment_out;
+        lpf->modulation_frame += frames;
+    }
+
+    return frames_out;
+}
+
+// -----------------------------------------------------------------------------
+// Filters buffer with the current coefficients, using the engine chosen by
+// init_filter.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     audio_buffer - buffer of samples
+//     frames_read  - length of buffer
+//
+// Returns:
+//     number of output frames at the start of audio_buffer
+// -----------------------------------------------------------------------------
+sf_count_t filter_segment(low_pass_filter_t* lpf,
+                          float* audio_buffer,
+                          sf_count_t frames_read)
+{
+    if (lpf->iir)
+    {
+        biquad_cascade_process(lpf->iir, audio_buffer, (size_t)frames_read);
+        return decimate_buffer(lpf, audio_buffer, frames_read);
+    }
+    else if (lpf->convolver)
+    {
+        overlap_save_process(lpf->convolver, audio_buffer, (size_t)frames_read);
+        return decimate_buffer(lpf, audio_buffer, frames_read);
+    }
+    else if (lpf->planar)
+    {
+        return filter_buffer_planar(lpf, audio_buffer, frames_read);
+    }
+
+    const int filter_length = lpf->order + 1;
+    sf_count_t frames_out = 0;
+
+    for (int i = 0; i < frames_read; ++i)
+    {
+        if (--lpf->newest_sample < 0)
+            lpf->newest_sample = filter_length - 1;
+
+        // outputs before the first input are dropped when compensating for
+        // the filter delay
+        bool keep = false;
+        if (lpf->frames_to_trim > 0)
+        {
+            --lpf->frames_to_trim;
+        }
+        else
+        {
+            keep = lpf->decimation_phase == 0;
+            if (++lpf->decimation_phase == lpf->decimation)
+                lpf->decimation_phase = 0;
+        }
+
+        // Channels in a frame are interleaved - indexing from the first will
+        // find the rest. An output never lands after the input it is
+        // computed from, so no unread input is overwritten.
+        for (int c = 0; c < lpf->channel_count; ++c)
+        {
+            float* history = lpf->past_input_samples +
+                             2 * filter_length * c + lpf->newest_sample;
+
+            history[0] = audio_buffer[i * lpf->channel_count + c];
+            history[filter_length] = history[0];
+
+            if (keep)
+            {
+                audio_buffer[frames_out * lpf->channel_count + c] =
+                    lpf->dot_product(lpf->coeffs, history, filter_length);
+            }
+        }
+
+        if (keep)
+            ++frames_out;
+    }
+
+    return frames_out;
+}
+
+// -----------------------------------------------------------------------------
+// Packs every decimation-th frame of a filtered buffer at its start, after
+// dropping any frames still to be trimmed, carrying the phase over to the next
+// buffer.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     audio_buffer - buffer of filtered interleaved samples
+//     frames_read  - length of buffer
+//
+// Returns:
+//     number of frames kept
+// -----------------------------------------------------------------------------
+sf_count_t decimate_buffer(low_pass_filter_t* lpf,
+                           float* audio_buffer,
+                           sf_count_t frames_read)
+{
+    if (lpf->decimation == 1 && lpf->frames_to_trim == 0)
+        return frames_read;
+
+    sf_count_t trim = lpf->frames_to_trim;
+    if (trim > frames_read)
+        trim = frames_read;
+    lpf->frames_to_trim -= trim;
+
+    const int channels = lpf->channel_count;
+    const sf_count_t first =
+        trim + (lpf->decimation - lpf->decimation_phase) % lpf->decimation;
+    sf_count_t frames_out = 0;
+
+    for (sf_count_t i = first; i < frames_read; i += lpf->decimation)
+    {
+        memmove(audio_buffer + frames_out * channels,
+                audio_buffer + i * channels,
+                channels * sizeof(float));
+        ++frames_out;
+    }
+
+    lpf->decimation_phase = (int)((lpf->decimation_phase + frames_read - trim) %
+                                  lpf->decimation);
+
+    return frames_out;
+}
+
+// -----------------------------------------------------------------------------
+// Processes buffer one channel at a time.
+//
+// Each channel's line holds buffer_size samples followed by filter_length - 1
+// samples of history, all newest first. A block is deinterleaved, reversed,
+// into the end of the sample regions so that it sits directly in front of the
+// history and every output is a dot product over a contiguous window, and
+// consecutive outputs' windows are one sample apart, so fir_filter_line
+// computes them all tap-major. Outputs go to a planar scratch area after the
+// lines, which is reinterleaved in one pass. When decimating only the kept
+// outputs are computed, one dot product each, and they are packed at the start
+// of the buffer.
+//
+// Arguments:
+//     lpf          - pointer to low pass filter data
+//     audio_buffer - buffer of interleaved samples
+//     frames_read  - length of buffer
+//
+// Returns:
+//     number of output frames at the start of audio_buffer
+// -----------------------------------------------------------------------------
+sf_count_t filter_buffer_planar(low_pass_filter_t* lpf,
+                                float* audio_buffer,
+                                sf_count_t frames_read)
+{
+    const int filter_length = lpf->order + 1;
+    const int channels = lpf->channel_count;
+    const size_t capacity = lpf->buffer_size;
+    const size_t line_length = capacity + filter_length - 1;
+    const size_t decimation = (size_t)lpf->decimation;
+    float* output = lpf->past_input_samples + line_length * channels;
+    sf_count_t frames_out = 0;
+
+    for (sf_count_t offset = 0; offset < frames_read; offset += capacity)
+    {
+        size_t frames = (size_t)(frames_read - offset);
+        if (frames > capacity)
+            frames = capacity;
+
+        float* block = audio_buffer + offset * channels;
+        const size_t first = capacity - frames;
+
+        // index of the first kept output in this block, after any still to
+        // be trimmed, and how many follow
+        size_t trim = (size_t)lpf->frames_to_trim;
+        if (trim > frames)
+            trim = frames;
+        lpf->frames_to_trim -= trim;
+
+        const size_t first_kept =
+            trim + (decimation - lpf->decimation_phase) % decimation;
+        const size_t kept =
+            frames > first_kept ? (frames - first_kept - 1) / decimation + 1
+                                : 0;
+        lpf->decimation_phase =
+            (int)((lpf->decimation_phase + frames - trim) % decimation);
+
+        for (size_t i = 0; i < frames; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                lpf->past_input_samples[line_length * c + capacity - 1 - i] =
+                    block[i * channels + c];
+            }
+        }
+
+        for (int c = 0; c < channels; ++c)
+        {
+            const float* line = lpf->past_input_samples + line_length * c;
+            float* channel_output = output + capacity * c;
+
+            // consecutive outputs are filtered together, tap-major
+            if (decimation == 1)
+            {
+                fir_filter_line(lpf->block_dot_product,
+                                lpf->block_folded_dot_product,
+                                lpf->coeffs,
+                                filter_length,
+                                line + capacity - 1 - first_kept,
+                                channel_output,
+                                kept);
+                continue;
+            }
+
+            for (size_t k = 0; k < kept; ++k)
+            {
+                const size_t i = first_kept + k * decimation;
+                channel_output[k] = lpf->dot_product(
+                    lpf->coeffs, line + capacity - 1 - i, filter_length);
+            }
+        }
+
+        // the block has been copied into the lines, so the packed output may
+        // overwrite it
+        float* block_output = audio_buffer + frames_out * channels;
+        for (size_t k = 0; k < kept; ++k)
+        {
+            for (int c = 0; c < channels; ++c)
+                block_output[k * channels + c] = output[capacity * c + k];
+        }
+        frames_out += kept;
+
+        // the newest filter_length - 1 samples become the next history
+        for (int c = 0; c < channels; ++c)
+        {
+            float* line = lpf->past_input_samples + line_length * c;
+            memmove(line + capacity,
+                    line + first,
+                    (filter_length - 1) * sizeof(float));
+        }
+    }
+
+    return frames_out;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of floats each channel needs in past_input_samples. Each
+// channel has its own mirrored delay line of twice the filter length, or in
+// planar mode a line holding one block followed by its history plus one block
+// of planar output.
+//
+// Arguments:
+//     lpf - pointer to low pass filter data
+//
+// Returns:
+//     floats per channel
+// -----------------------------------------------------------------------------
+size_t delay_line_length(const low_pass_filter_t* lpf)
+{
+    const size_t filter_length = (size_t)lpf->order + 1;
+
+    return lpf->planar ? 2 * lpf->buffer_size + filter_length - 1
+                       : 2 * filter_length;
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether a filter of filter_length taps is convolved by FFT, as it is
+// with the FFT engine or, with the automatic engine, from
+// LPF_FFT_CROSSOVER_TAPS taps on. A filter following an envelope never is.
+// -----------------------------------------------------------------------------
+bool uses_fft(const low_pass_filter_t* lpf, size_t filter_length)
+{
+    if (lpf->envelope_length > 0)
+        return false;
+
+    return lpf->engine == LPF_ENGINE_FFT ||
+           (lpf->engine == LPF_ENGINE_AUTO &&
+            filter_length >= LPF_FFT_CROSSOVER_TAPS);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the block size to filter a file with: the one set, or with
+// LPF_BLOCK_AUTO the largest power of two whose working set fits in half the
+// L2 cache, as described for lpf_set_block_size.
+//
+// Arguments:
+//     lpf           - pointer to low pass filter data
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels
+//
+// Returns:
+//     frames per block
+// -----------------------------------------------------------------------------
+size_t block_size_for(const low_pass_filter_t* lpf,
+                      size_t filter_length,
+                      int channels)
+{
+    if (!lpf->auto_block_size)
+        return lpf->buffer_size;
+
+    const size_t budget = cpu_cache_size(2) / 2;
+    const size_t history = filter_length - 1;
+
+    size_t block_frames = LPF_AUTO_BLOCK_MIN;
+    while (block_frames < LPF_AUTO_BLOCK_MAX)
+    {
+        const size_t frames = 2 * block_frames;
+
+        // the file's block, then the delay line or, in planar mode, each
+        // channel's line and planar output
+        size_t floats = frames * channels + filter_length;
+        floats += lpf->planar ? (2 * frames + history) * channels
+                              : 2 * filter_length * channels;
+
+        if (floats * sizeof(float) > budget)
+            break;
+
+        block_frames = frames;
+    }
+
+    return block_frames;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the order a filter is designed with at this sample rate: that of its
+// design spec if one is set, otherwise the order set on it.
+// -----------------------------------------------------------------------------
+int design_order(const low_pass_filter_t* lpf, float sample_rate)
+{
+    if (lpf->transition_width > 0)
+    {
+        return kaiser_design_order(
+            lpf->stopband_attenuation, lpf->transition_width, sample_rate);
+    }
+
+    return lpf->order;
+}
+
+// -----------------------------------------------------------------------------
+// Makes sure the workspace holds at least size bytes, growing one the filter
+// owns. Must only be called with nothing allocated from the workspace.
+//
+// Arguments:
+//     lpf  - pointer to low pass filter data
+//     size - bytes needed, from lpf_workspace_size
+//
+// Returns:
+//     LPF_NO_ERROR, LPF_WORKSPACE_ERROR if a workspace given to
+//     lpf_set_workspace is too small, or LPF_FILTER_INIT_ERROR if one cannot
+//     be allocated
+// -----------------------------------------------------------------------------
+enum lpf_error reserve_workspace(low_pass_filter_t* lpf, size_t size)
+{
+    if (lpf->workspace_size >= size)
+        return LPF_NO_ERROR;
+
+    if (!lpf->workspace_owned)
+        return LPF_WORKSPACE_ERROR;
+
+    free(lpf->workspace);
+    lpf->workspace = (unsigned char*)malloc(size);
+    lpf->workspace_size = lpf->workspace ? size : 0;
+
+    return lpf->workspace ? LPF_NO_ERROR : LPF_FILTER_INIT_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Takes the next zeroed, aligned buffer from the workspace. Everything taken
+// is given back at once by release_filter.
+//
+// Arguments:
+//     lpf   - pointer to low pass filter data
+//     bytes - size of buffer
+//
+// Returns:
+//     pointer to buffer, or NULL if the workspace is used up
+// -----------------------------------------------------------------------------
+void* workspace_alloc(low_pass_filter_t* lpf, size_t bytes)
+{
+    if (!lpf->workspace)
+        return NULL;
+
+    const uintptr_t address = (uintptr_t)lpf->workspace + lpf->workspace_used;
+    const size_t padding = (size_t)(-address % WORKSPACE_ALIGNMENT);
+    const size_t rounded = workspace_round(bytes);
+
+    if (padding + rounded > lpf->workspace_size - lpf->workspace_used)
+        return NULL;
+
+    unsigned char* buffer = lpf->workspace + lpf->workspace_used + padding;
+    lpf->workspace_used += padding + rounded;
+    memset(buffer, 0, bytes);
+
+    return buffer;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the cutoff a modulated filter should have at the current frame, from
+// lpf_set_cutoff if it has been called and otherwise from the envelope.
+// Breakpoints are passed only forwards, so over a whole file this costs a
+// constant time per call.
+//
+// Arguments:
+//     lpf - pointer to low pass filter data with an envelope
+//
+// Returns:
+//     cutoff in Hz
+// -----------------------------------------------------------------------------
+float modulated_cutoff(low_pass_filter_t* lpf)
+{
+    if (lpf->manual_cutoff > 0)
+    {
+        if (lpf->manual_cutoff < lpf->envelope_lowest)
+            return lpf->envelope_lowest;
+        else if (lpf->manual_cutoff > lpf->envelope_highest)
+            return lpf->envelope_highest;
+        return lpf->manual_cutoff;
+    }
+
+    const float* times = lpf->envelope_times;
+    const float* cutoffs = lpf->envelope_cutoffs;
+    const float time =
+        (float)((double)lpf->modulation_frame / lpf->sample_rate);
+
+    size_t i = lpf->envelope_index;
+    while (i + 1 < lpf->envelope_length && times[i + 1] <= time)
+        ++i;
+    lpf->envelope_index = i;
+
+    if (time <= times[i] || i + 1 == lpf->envelope_length)
+        return cutoffs[i];
+
+    const float fraction = (time - times[i]) / (times[i + 1] - times[i]);
+    return cutoffs[i] * powf(cutoffs[i + 1] / cutoffs[i], fraction);
+}
+
+// -----------------------------------------------------------------------------
+// Gives back the per-file state set up by init_filter, all of it carved from
+// the workspace. Coefficients from a cache belong to the cache and are left
+// alone.
+//
+// Arguments:
+//     lpf - pointer to low pass filter data
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void release_filter(low_pass_filter_t* lpf)
+{
+    lpf->coeffs = NULL;
+    lpf->past_input_samples = NULL;
+    lpf->convolver = NULL;
+    lpf->iir = NULL;
+    lpf->cutoff_bank = NULL;
+    lpf->fixed_fir = NULL;
+    lpf->precise_fir = NULL;
+    lpf->workspace_used = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Reads the clock at the start of a timed stage, if stats are being gathered.
+// -----------------------------------------------------------------------------
+uint64_t stage_start(const low_pass_filter_t* lpf)
+{
+    return lpf->collect_stats ? stats_clock_ns() : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Adds the time since start to a stage's total, if stats are being gathered.
+//
+// Arguments:
+//     lpf      - pointer to low pass filter data
+//     stage_ns - total the time is added to
+//     start    - time the stage started, from stage_start or stage_end
+//
+// Returns:
+//     the time now, which starts the next stage
+// -----------------------------------------------------------------------------
+uint64_t stage_end(const low_pass_filter_t* lpf,
+                   uint64_t* stage_ns,
+                   uint64_t start)
+{
+    if (!lpf->collect_stats)
+        return 0;
+
+    const uint64_t now = stats_clock_ns();
+    *stage_ns += now - start;
+    return now;
+}
+
+// -----------------------------------------------------------------------------
+// Ends the filter stage of a block, adding it to the latency histogram as well
+// as the stage's total.
+// -----------------------------------------------------------------------------
+uint64_t filter_end(low_pass_filter_t* lpf, uint64_t start)
+{
+    if (!lpf->collect_stats)
+        return 0;
+
+    const uint64_t now = stats_clock_ns();
+    stats_add_block(&lpf->stats, now - start);
+    return now;
+}
+
+// -----------------------------------------------------------------------------
+// Fills in the stats that cover a whole file once it is closed.
+//
+// Arguments:
+//     lpf            - pointer to low pass filter data
+//     frames_written - number of frames written to each output
+//     start          - time the file was opened, from stage_start
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void finish_stats(low_pass_filter_t* lpf,
+                  sf_count_t frames_written,
+                  uint64_t start)
+{
+    if (!lpf->collect_stats)
+        return;
+
+    lpf_stats_t* stats = &lpf->stats;
+    stats->frames_written = frames_written;
+    stats->sample_rate = (int)lpf->sample_rate;
+    stats->channels = lpf->channel_count;
+    stage_end(lpf, &stats->total_ns, start);
+    stats->peak_memory_bytes = stats_peak_memory();
+
+    if (stats->total_ns && stats->sample_rate)
+        stats->realtime_factor = (double)stats->frames_read /
+                                 stats->sample_rate /
+                                 (stats->total_ns * 1e-9);
+}
+
+// -----------------------------------------------------------------------------
+// Deallocates low_pass_filter_t object and its arrays.
+//
+// Arguments:
+//      lpf - low_pass_filter_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_destroy(low_pass_filter_t* lpf)
+{
+    if (lpf)
+    {
+        release_filter(lpf);
+        if (lpf->workspace_owned)
+            free(lpf->workspace);
+        thread_pool_destroy(lpf->thread_pool);
+        free(lpf->envelope_times);
+        free(lpf->envelope_cutoffs);
+        free(lpf->input_mapping);
+        free(lpf);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Frees the windows kept by every filter in the process. Filters designed
+// afterwards generate their windows again. Must not be called while any filter
+// is being designed, by lpf_filter_file, lpf_filter_batch or lpf_prepare.
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void lpf_clear_window_cache(void)
+{
+    window_cache_clear();
+}
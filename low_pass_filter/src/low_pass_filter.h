@@ -3,10 +3,23 @@
 
 #include <math.h>
 #include <sndfile.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #define eprintf(...) fprintf(stderr, __VA_ARGS__)
 
+// File name that lpf_filter_file takes to mean stdin or stdout.
+#define LPF_STDIO_NAME "-"
+
+// Block size that lpf_create and lpf_set_block_size take to mean one picked
+// to fit the cache.
+#define LPF_BLOCK_AUTO 0
+
+// Highest filter order lpf_set_order takes and a design spec may work out to.
+#define LPF_MAX_ORDER 65536
+
 typedef struct low_pass_filter low_pass_filter_t;
 
 enum window_t
@@ -29,14 +42,219 @@ enum lpf_error
     LPF_FILTER_INIT_ERROR,
     LPF_FILTER_FILE_ERROR,
     LPF_FILE_WRITE_ERROR,
+    LPF_SIMD_UNSUPPORTED_ERROR,
+    LPF_WORKSPACE_ERROR,
+};
+
+// Convolution engine used by lpf_filter_file. LPF_ENGINE_AUTO uses direct form
+// below LPF_FFT_CROSSOVER_TAPS taps and FFT overlap-save from there on.
+// LPF_ENGINE_IIR replaces the FIR with a cascade of biquads.
+enum lpf_engine
+{
+    LPF_ENGINE_AUTO,
+    LPF_ENGINE_DIRECT,
+    LPF_ENGINE_FFT,
+    LPF_ENGINE_IIR,
+};
+
+// Response of the IIR engine. Butterworth is maximally flat and 3dB down at the
+// cutoff. Linkwitz-Riley is a Butterworth of half the order applied twice, 6dB
+// down at the cutoff like the FIR designs.
+enum lpf_iir_response
+{
+    LPF_IIR_BUTTERWORTH,
+    LPF_IIR_LINKWITZ_RILEY,
+};
+
+// Phase response of the filter design. Linear phase delays every frequency by
+// order / 2 samples; minimum phase has the same magnitude response with far
+// less delay, at the cost of phase distortion.
+enum lpf_phase
+{
+    LPF_PHASE_LINEAR,
+    LPF_PHASE_MINIMUM,
+};
+
+// Arithmetic lpf_filter_file filters in. LPF_ARITHMETIC_FIXED filters 16 and
+// 24 bit PCM as integers with Q15 and Q31 coefficients, without converting to
+// float, in direct form. It falls back to float for anything else, and for a
+// filter the engine convolves by FFT: any with LPF_ENGINE_FFT, and from
+// LPF_FFT_CROSSOVER_TAPS taps on with LPF_ENGINE_AUTO. The rest keep more
+// precision than float for long filters: float samples and coefficients
+// summed in double, the same summed in float with Kahan compensation, or
+// double throughout, coefficients included. A minimum phase filter is the
+// exception: its coefficients are designed in float and widened.
+enum lpf_arithmetic
+{
+    LPF_ARITHMETIC_FLOAT,
+    LPF_ARITHMETIC_FIXED,
+    LPF_ARITHMETIC_DOUBLE_SUM,
+    LPF_ARITHMETIC_KAHAN,
+    LPF_ARITHMETIC_DOUBLE,
+};
+
+// Instruction set used by the direct form tap kernel.
+enum lpf_simd
+{
+    LPF_SIMD_AUTO,
+    LPF_SIMD_SCALAR,
+    LPF_SIMD_SSE,
+    LPF_SIMD_AVX2,
+    LPF_SIMD_AVX512,
+    LPF_SIMD_NEON,
 };
 
+// Number of bins in the block latency histogram of lpf_stats_t.
+#define LPF_STATS_LATENCY_BINS 24
+
+// Measurements of the last lpf_filter_file, gathered when lpf_set_stats is on.
+// Times are wall clock nanoseconds. Reading, filtering and writing are timed
+// block by block; with a pipeline, reading and writing overlap filtering on
+// their own threads and are left at 0. realtime_factor is seconds of audio
+// filtered per second taken, from opening the files to closing them.
+// peak_memory_bytes is the process's peak resident memory so far.
+// block_latency counts blocks by how long filtering them took: bin 0 under a
+// microsecond, bin i from 2^(i - 1) up to 2^i microseconds, and the last bin
+// everything longer.
+typedef struct lpf_stats
+{
+    sf_count_t frames_read;
+    sf_count_t frames_written;
+    int sample_rate;
+    int channels;
+    uint64_t read_ns;
+    uint64_t filter_ns;
+    uint64_t write_ns;
+    uint64_t total_ns;
+    double realtime_factor;
+    size_t peak_memory_bytes;
+    sf_count_t blocks;
+    uint64_t max_block_ns;
+    sf_count_t block_latency[LPF_STATS_LATENCY_BINS];
+} lpf_stats_t;
+
+// One file of a batch. result and frames_filtered are filled in by
+// lpf_filter_batch.
+typedef struct lpf_batch_job
+{
+    const char* input_file;
+    const char* output_file;
+    float cutoff;
+    enum window_t window_type;
+    enum lpf_error result;
+    sf_count_t frames_filtered;
+} lpf_batch_job_t;
+
+// One output of a filter bank: a file and the cutoff it is filtered at.
+typedef struct lpf_band
+{
+    const char* output_file;
+    float cutoff;
+} lpf_band_t;
+
 low_pass_filter_t* lpf_create(float cutoff, enum window_t window_type, size_t buffer_size);
 
+void lpf_set_order(low_pass_filter_t* lpf, int order);
+
+enum lpf_error lpf_set_cutoff_envelope(low_pass_filter_t* lpf,
+                                       const float* times,
+                                       const float* cutoffs,
+                                       size_t point_count);
+
+void lpf_set_cutoff(low_pass_filter_t* lpf, float cutoff);
+
+enum lpf_error lpf_set_design_spec(low_pass_filter_t* lpf,
+                                   float passband_edge,
+                                   float stopband_edge,
+                                   float attenuation_db);
+
+void lpf_set_phase(low_pass_filter_t* lpf, enum lpf_phase phase);
+
+void lpf_set_delay_compensation(low_pass_filter_t* lpf,
+                                bool delay_compensation);
+
+void lpf_set_engine(low_pass_filter_t* lpf, enum lpf_engine engine);
+
+void lpf_set_iir_design(low_pass_filter_t* lpf,
+                        enum lpf_iir_response response,
+                        int order);
+
+enum lpf_error lpf_set_simd(low_pass_filter_t* lpf, enum lpf_simd simd);
+
+void lpf_set_planar(low_pass_filter_t* lpf, bool planar);
+
+void lpf_set_block_size(low_pass_filter_t* lpf, size_t block_frames);
+
+size_t lpf_get_block_size(const low_pass_filter_t* lpf);
+
+void lpf_set_arithmetic(low_pass_filter_t* lpf, enum lpf_arithmetic arithmetic);
+
+void lpf_set_stats(low_pass_filter_t* lpf, bool collect_stats);
+
+void lpf_get_stats(const low_pass_filter_t* lpf, lpf_stats_t* stats);
+
+// Once a workspace is big enough, every per-file object of lpf_filter_file,
+// lpf_prepare and lpf_filter_bank is carved from it. These still allocate:
+// - a pipeline depth above 0, its reader and writer threads and block ring,
+//   for each file
+// - a file libsndfile opens rather than a mapping, that is stdin, stdout,
+//   raw samples and any format mapped_wav_t does not handle, inside libsndfile
+// - a minimum phase design, its FFT buffers, for each file
+// - the first use of each distinct window, and of each distinct design in a
+//   batch, an entry of the window or coefficient cache
+// - the first threaded file after the thread count changes, the thread pool
+// - lpf_filter_batch, each worker's workspace, pool and input mapping
+size_t lpf_workspace_size(const low_pass_filter_t* lpf,
+                          float sample_rate,
+                          int channels);
+
+size_t lpf_bank_workspace_size(const low_pass_filter_t* lpf,
+                               float sample_rate,
+                               int channels,
+                               size_t band_count);
+
+void lpf_set_workspace(low_pass_filter_t* lpf, void* workspace, size_t size);
+
+void lpf_set_thread_count(low_pass_filter_t* lpf, int thread_count);
+
+void lpf_set_pipeline_depth(low_pass_filter_t* lpf, int pipeline_depth);
+
+void lpf_set_decimation(low_pass_filter_t* lpf, int decimation);
+
+enum lpf_error lpf_prepare(low_pass_filter_t* lpf,
+                           float sample_rate,
+                           int channels);
+
+size_t lpf_process(low_pass_filter_t* lpf,
+                   const float* input,
+                   float* output,
+                   size_t frames);
+
+void lpf_reset(low_pass_filter_t* lpf);
+
+void lpf_set_raw_format(low_pass_filter_t* lpf,
+                        int sample_rate,
+                        int channels,
+                        int format);
+
 enum lpf_error lpf_filter_file(low_pass_filter_t* lpf,
                                const char* input_file,
                                const char* output_file,
                                enum window_t window_type,
                                sf_count_t* frames_filtered);
 
+enum lpf_error lpf_filter_bank(low_pass_filter_t* lpf,
+                               const char* input_file,
+                               const lpf_band_t* bands,
+                               size_t band_count,
+                               enum window_t window_type,
+                               sf_count_t* frames_filtered);
+
+enum lpf_error lpf_filter_batch(low_pass_filter_t* lpf,
+                                lpf_batch_job_t* jobs,
+                                size_t job_count,
+                                int worker_count);
+
 void lpf_destroy(low_pass_filter_t* lpf);
+
+void lpf_clear_window_cache(void);
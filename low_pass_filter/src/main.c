@@ -1,5 +1,6 @@
 
 #include <ctype.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,23 +17,69 @@ enum errors
     INPUT_FILE_FORMAT_ERROR,
     OUTPUT_FILE_FORMAT_ERROR,
     UNKNOWN_WINDOW_ERROR,
+    THREAD_COUNT_ERROR,
+    BATCH_FILE_ERROR,
+    RAW_FORMAT_ERROR,
+    DECIMATION_ERROR,
+    FILTER_DESIGN_ERROR,
+    UNKNOWN_PHASE_ERROR,
+    UNKNOWN_RESPONSE_ERROR,
+    ENVELOPE_FILE_ERROR,
+    UNKNOWN_ARITHMETIC_ERROR,
+    STATS_FILE_ERROR,
+    BANK_FILE_ERROR,
+    BLOCK_SIZE_ERROR,
 };
 
+// longest line accepted in a batch, bank or envelope file
+#define MAX_BATCH_LINE 4096
+
+// largest block size accepted by -b, in frames
+#define MAX_BLOCK_FRAMES 1048576
+
 void print_usage(const char* prog_name);
 void print_manual_page(const char* prog_name);
 bool is_wav_file(const char* file_name);
+bool is_stream(const char* file_name);
 float get_cutoff(const char* file_name);
 enum window_t get_window_type(const char* window_type);
+int get_count(const char* count);
+int get_bounded_count(const char* count, int max_count);
+int get_sample_rate(const char* sample_rate);
+float get_attenuation(const char* attenuation);
+int get_phase_mode(const char* phase_mode);
+int get_iir_response(const char* iir_response);
+int get_arithmetic(const char* arithmetic);
+int get_raw_encoding(const char* encoding);
+char* copy_string(const char* string);
+int filter_batch(low_pass_filter_t* lpf,
+                 const char* batch_file_name,
+                 enum window_t window_type,
+                 int worker_count);
+int filter_bands(low_pass_filter_t* lpf,
+                 const char* input_file_name,
+                 const char* bank_file_name,
+                 enum window_t window_type,
+                 sf_count_t* frames_filtered);
+int read_envelope(low_pass_filter_t* lpf, const char* envelope_file_name);
+void write_stats(FILE* stats_file, const lpf_stats_t* stats);
 
 int main(int argc, const char** argv)
 {
+    // batch mode takes a batch file in place of input, output and cutoff, and
+    // bank mode a bank file in place of output and cutoff
+    const bool batch = argc > 1 && !strcmp(argv[1], "--batch");
+    const bool bank = argc > 1 && !strcmp(argv[1], "--bank");
+    const bool single = !batch && !bank;
+    const int first_option = batch ? 3 : 4;
+
     // user help
     if (argc == 1)
     {
         print_manual_page(argv[0]);
         return NO_ERROR;
     }
-    else if (argc != 4 && argc != 6)
+    else if (argc < first_option || (argc - first_option) % 2)
     {
         eprintf("invalid arguments\n\n");
         print_usage(argv[0]);
@@ -40,61 +87,346 @@ int main(int argc, const char** argv)
     }
 
     // parses input
-    const char* input_file_name = argv[1];
-    if (!is_wav_file(input_file_name))
+    const char* input_file_name = bank ? argv[2] : argv[1];
+    const char* output_file_name = bank ? argv[3] : argv[2];
+    float cutoff = 0.0f;
+    if (!batch)
     {
-        eprintf("input file %s does not exist\n", input_file_name);
-        return INPUT_FILE_FORMAT_ERROR;
+        if (!is_wav_file(input_file_name) && !is_stream(input_file_name))
+        {
+            eprintf("input file %s does not exist\n", input_file_name);
+            return INPUT_FILE_FORMAT_ERROR;
+        }
     }
-    const char* output_file_name = argv[2];
-    if (!is_wav_file(output_file_name))
+    if (single)
     {
-        eprintf("output file %s does not exist\n", output_file_name);
-        return OUTPUT_FILE_FORMAT_ERROR;
-    }
+        if (!is_wav_file(output_file_name) && !is_stream(output_file_name))
+        {
+            eprintf("output file %s does not exist\n", output_file_name);
+            return OUTPUT_FILE_FORMAT_ERROR;
+        }
 
-    const float cutoff = get_cutoff(argv[3]);
-    if (!cutoff)
-    {
-        eprintf("cutoff frequency must be a positive numerical value between "
-                "20Hz and 20000Hz.\n");
-        return CUTOFF_VALUE_ERROR;
+        cutoff = get_cutoff(argv[3]);
+        if (!cutoff)
+        {
+            eprintf("cutoff frequency must be a positive numerical value "
+                    "between 20Hz and 20000Hz.\n");
+            return CUTOFF_VALUE_ERROR;
+        }
     }
 
+    // options come in pairs of flag and value
     enum window_t window_type = KAISER;
-    if (argc == 6)
+    int thread_count = 1;
+    int pipeline_depth = 0;
+    int worker_count = 0;
+    int raw_sample_rate = 0;
+    int raw_channels = 0;
+    int raw_encoding = SF_FORMAT_PCM_16;
+    int decimation = 1;
+    int order = 0;
+    float stopband_edge = 0.0f;
+    float attenuation = 0.0f;
+    int phase_mode = 0;
+    int iir_response = -1;
+    int arithmetic = LPF_ARITHMETIC_FLOAT;
+    int block_frames = LPF_BLOCK_AUTO;
+    const char* envelope_file_name = NULL;
+    const char* stats_file_name = NULL;
+    for (int i = first_option; i < argc; i += 2)
     {
-        if (strcmp(argv[4], "-w"))
+        if (!strcmp(argv[i], "-w"))
+        {
+            window_type = get_window_type(argv[i + 1]);
+            if (window_type == NULL_WINDOW)
+            {
+                eprintf("unknown window type %s.\n", argv[i + 1]);
+                return UNKNOWN_WINDOW_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-t"))
+        {
+            thread_count = get_count(argv[i + 1]);
+            if (thread_count < 0)
+            {
+                eprintf("thread count must be a non-negative integer.\n");
+                return THREAD_COUNT_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-p"))
+        {
+            pipeline_depth = get_count(argv[i + 1]);
+            if (pipeline_depth < 0)
+            {
+                eprintf("pipeline depth must be a non-negative integer.\n");
+                return COMMAND_LINE_ARGS_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-d"))
+        {
+            decimation = get_count(argv[i + 1]);
+            if (decimation <= 0)
+            {
+                eprintf("decimation factor must be a positive integer.\n");
+                return DECIMATION_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-b"))
+        {
+            block_frames = get_bounded_count(argv[i + 1], MAX_BLOCK_FRAMES);
+            if (block_frames < 0)
+            {
+                eprintf("block size must be an integer from 0 to %d.\n",
+                        MAX_BLOCK_FRAMES);
+                return BLOCK_SIZE_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-o"))
         {
-            eprintf("unknown command line option %s.\n", argv[4]);
+            order = get_bounded_count(argv[i + 1], LPF_MAX_ORDER);
+            if (order <= 0)
+            {
+                eprintf("filter order must be an integer from 1 to %d.\n",
+                        LPF_MAX_ORDER);
+                return FILTER_DESIGN_ERROR;
+            }
+        }
+        else if (single && !strcmp(argv[i], "-s"))
+        {
+            stopband_edge = get_cutoff(argv[i + 1]);
+            if (stopband_edge <= cutoff)
+            {
+                eprintf("stopband edge must be above the cutoff and no more "
+                        "than 20000Hz.\n");
+                return FILTER_DESIGN_ERROR;
+            }
+        }
+        else if (single && !strcmp(argv[i], "-a"))
+        {
+            attenuation = get_attenuation(argv[i + 1]);
+            if (!attenuation)
+            {
+                eprintf("attenuation must be between 20dB and 200dB.\n");
+                return FILTER_DESIGN_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-l"))
+        {
+            phase_mode = get_phase_mode(argv[i + 1]);
+            if (phase_mode < 0)
+            {
+                eprintf("unknown phase mode %s.\n", argv[i + 1]);
+                return UNKNOWN_PHASE_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-i"))
+        {
+            iir_response = get_iir_response(argv[i + 1]);
+            if (iir_response < 0)
+            {
+                eprintf("unknown IIR response %s.\n", argv[i + 1]);
+                return UNKNOWN_RESPONSE_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-n"))
+        {
+            arithmetic = get_arithmetic(argv[i + 1]);
+            if (arithmetic < 0)
+            {
+                eprintf("unknown arithmetic %s.\n", argv[i + 1]);
+                return UNKNOWN_ARITHMETIC_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-m"))
+        {
+            envelope_file_name = argv[i + 1];
+        }
+        else if (!batch && !strcmp(argv[i], "--stats"))
+        {
+            stats_file_name = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "-r"))
+        {
+            raw_sample_rate = get_sample_rate(argv[i + 1]);
+            if (raw_sample_rate <= 0)
+            {
+                eprintf("sample rate must be a positive integer.\n");
+                return RAW_FORMAT_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-c"))
+        {
+            raw_channels = get_count(argv[i + 1]);
+            if (raw_channels <= 0)
+            {
+                eprintf("channel count must be a positive integer.\n");
+                return RAW_FORMAT_ERROR;
+            }
+        }
+        else if (!strcmp(argv[i], "-e"))
+        {
+            raw_encoding = get_raw_encoding(argv[i + 1]);
+            if (!raw_encoding)
+            {
+                eprintf("unknown raw encoding %s.\n", argv[i + 1]);
+                return RAW_FORMAT_ERROR;
+            }
+        }
+        else if (batch && !strcmp(argv[i], "-j"))
+        {
+            worker_count = get_count(argv[i + 1]);
+            if (worker_count < 0)
+            {
+                eprintf("job count must be a non-negative integer.\n");
+                return THREAD_COUNT_ERROR;
+            }
+        }
+        else
+        {
+            eprintf("unknown command line option %s.\n", argv[i]);
             return COMMAND_LINE_ARGS_ERROR;
         }
+    }
 
-        window_type = get_window_type(argv[5]);
-        if (window_type == NULL_WINDOW)
+    if (!raw_sample_rate != !raw_channels)
+    {
+        eprintf("raw input needs both -r and -c.\n");
+        return RAW_FORMAT_ERROR;
+    }
+
+    if (order && stopband_edge)
+    {
+        eprintf("give either an order or a stopband edge, not both.\n");
+        return FILTER_DESIGN_ERROR;
+    }
+    else if (attenuation && !stopband_edge)
+    {
+        eprintf("an attenuation needs a stopband edge.\n");
+        return FILTER_DESIGN_ERROR;
+    }
+    else if (iir_response >= 0 && stopband_edge)
+    {
+        eprintf("a stopband edge only applies to the FIR filter.\n");
+        return FILTER_DESIGN_ERROR;
+    }
+    else if (iir_response >= 0 && order > 16)
+    {
+        eprintf("IIR filter order must be between 1 and 16.\n");
+        return FILTER_DESIGN_ERROR;
+    }
+
+    low_pass_filter_t* lpf = lpf_create(cutoff, window_type, block_frames);
+    if (!lpf)
+    {
+        eprintf("unable to create filter\n");
+        return FILTER_FILE_ERROR;
+    }
+
+    if (iir_response >= 0)
+    {
+        lpf_set_engine(lpf, LPF_ENGINE_IIR);
+        lpf_set_iir_design(
+            lpf, (enum lpf_iir_response)iir_response, order ? order : 4);
+    }
+    else if (order)
+    {
+        lpf_set_order(lpf, order);
+    }
+    if (stopband_edge)
+    {
+        if (lpf_set_design_spec(lpf,
+                                cutoff,
+                                stopband_edge,
+                                attenuation ? attenuation : 60.0f))
+        {
+            eprintf("design spec needs an order above %d.\n", LPF_MAX_ORDER);
+            lpf_destroy(lpf);
+            return FILTER_DESIGN_ERROR;
+        }
+        window_type = KAISER;
+    }
+    if (envelope_file_name)
+    {
+        const int envelope_retcode = read_envelope(lpf, envelope_file_name);
+        if (envelope_retcode != NO_ERROR)
         {
-            eprintf("unknown window type %s.\n", argv[5]);
-            return UNKNOWN_WINDOW_ERROR;
+            lpf_destroy(lpf);
+            return envelope_retcode;
         }
     }
+    lpf_set_thread_count(lpf, thread_count);
+    lpf_set_pipeline_depth(lpf, pipeline_depth);
+    lpf_set_decimation(lpf, decimation);
+    lpf_set_phase(lpf, phase_mode == 1 ? LPF_PHASE_MINIMUM : LPF_PHASE_LINEAR);
+    lpf_set_delay_compensation(lpf, phase_mode == 2);
+    lpf_set_arithmetic(lpf, (enum lpf_arithmetic)arithmetic);
+    lpf_set_stats(lpf, stats_file_name != NULL);
+    if (raw_sample_rate)
+        lpf_set_raw_format(lpf, raw_sample_rate, raw_channels, raw_encoding);
+
+    if (batch)
+    {
+        const int batch_retcode =
+            filter_batch(lpf, argv[2], window_type, worker_count);
+        lpf_destroy(lpf);
+        return batch_retcode;
+    }
+
+    // stdout may be carrying the filtered audio
+    FILE* report = single && is_stream(output_file_name) ? stderr : stdout;
 
-    low_pass_filter_t* lpf = lpf_create(cutoff, window_type, 512);
+    // opened first, so a bad name fails before the file is filtered
+    FILE* stats_file = NULL;
+    if (stats_file_name)
+    {
+        stats_file =
+            is_stream(stats_file_name) ? report : fopen(stats_file_name, "w");
+        if (!stats_file)
+        {
+            eprintf("unable to open stats file %s\n", stats_file_name);
+            lpf_destroy(lpf);
+            return STATS_FILE_ERROR;
+        }
+    }
 
     sf_count_t frames_filtered = 0;
-    enum lpf_error retcode = lpf_filter_file(lpf,
-                                             input_file_name,
-                                             output_file_name,
-                                             window_type,
-                                             &frames_filtered);
-
-    if (retcode == LPF_NO_ERROR)
-        printf("--- filtered %lld frames! ---\n", frames_filtered);
-    else
-        return FILTER_FILE_ERROR;
+    int retcode = NO_ERROR;
+    if (bank)
+    {
+        retcode = filter_bands(lpf,
+                               input_file_name,
+                               output_file_name,
+                               window_type,
+                               &frames_filtered);
+    }
+    else if (lpf_filter_file(lpf,
+                             input_file_name,
+                             output_file_name,
+                             window_type,
+                             &frames_filtered) != LPF_NO_ERROR)
+    {
+        retcode = FILTER_FILE_ERROR;
+    }
+
+    if (retcode == NO_ERROR)
+        fprintf(report, "--- filtered %lld frames! ---\n", frames_filtered);
+
+    if (stats_file)
+    {
+        if (retcode == NO_ERROR)
+        {
+            lpf_stats_t stats;
+            lpf_get_stats(lpf, &stats);
+            write_stats(stats_file, &stats);
+        }
+
+        if (stats_file != report)
+            fclose(stats_file);
+    }
 
     lpf_destroy(lpf);
 
-    return NO_ERROR;
+    return retcode;
 }
 
 // -----------------------------------------------------------------------------
@@ -103,7 +435,20 @@ int main(int argc, const char** argv)
 void print_usage(const char* prog_name)
 {
     printf("usage: %s [<input_wave_file> <output_wave_file> ", prog_name);
-    printf("<cutoff_frequency> [-w <window_type>]]\n");
+    printf("<cutoff_frequency> [-w <window_type>] [-t <thread_count>] ");
+    printf("[-p <pipeline_depth>]\n");
+    printf("       [-o <order> | -s <stopband_edge> [-a <attenuation>]] ");
+    printf("[-d <decimation>]\n       [-l <phase_mode>] ");
+    printf("[-i <iir_response>] [-m <envelope_file>]\n       ");
+    printf("[-n <arithmetic>] [-b <block_frames>] ");
+    printf("[--stats <stats_file>]\n       ");
+    printf("[-r <sample_rate> -c <channels> [-e <encoding>]]]\n");
+    printf("       %s --bank <input_wave_file> <bank_file> ", prog_name);
+    printf("[-w <window_type>] [-o <order>]\n");
+    printf("       [-l <phase_mode>] [--stats <stats_file>]\n");
+    printf("       %s --batch <batch_file> [-w <window_type>] ", prog_name);
+    printf("[-j <job_count>]\n");
+    printf("       [-t <thread_count>] [-p <pipeline_depth>]\n");
 }
 
 // -----------------------------------------------------------------------------
@@ -121,12 +466,116 @@ void print_manual_page(const char* prog_name)
 
     printf("DESCRIPTION\n\n");
     printf("%s opens a WAVE file <input_wave_file> and filters ", prog_name);
-    printf("it using a\n126th order FIR Low Pass Filter with cutoff ");
+    printf("it using a\nFIR Low Pass Filter, by default of order 126, with ");
+    printf("cutoff ");
     printf("frequency <cutoff_frequency>\nbetween 20Hz and 20kHz. An ");
     printf("optional window function [-w <window_type>] can\nbe selected, ");
     printf("with the variants listed below. The default window is ");
     printf("bartlett.\nThe filtered data is then saved to a new WAVE file ");
     printf("<output_wave_file>.\n\n");
+    printf("[-o <order>] sets the filter order, from 1 to %d. ",
+           LPF_MAX_ORDER);
+    printf("Alternatively\n[-s <stopband_edge>] designs the filter from a ");
+    printf("spec: <cutoff_frequency> becomes\nthe passband edge, the ");
+    printf("stopband is attenuated by [-a <attenuation>] dB (default\n60) ");
+    printf("and a kaiser window of the lowest order meeting the spec is ");
+    printf("used. A spec\nneeding an order above %d is ", LPF_MAX_ORDER);
+    printf("rejected.\n\n");
+    printf("Filtering can be spread over [-t <thread_count>] threads, ");
+    printf("0 using one per\nlogical processor. The default is 1. ");
+    printf("Output is identical whatever the\nthread count.\n\n");
+    printf("Single threaded filtering can overlap disk I/O with ");
+    printf("processing by reading,\nfiltering and writing on separate ");
+    printf("threads that pass a ring of\n[-p <pipeline_depth>] blocks ");
+    printf("between them. The default of 0 disables this.\nIt has no ");
+    printf("effect when the input or output is a WAV file of 16 or 24 bit ");
+    printf("PCM\nor float, other than stdin or stdout, as those are mapped ");
+    printf("into memory rather\nthan read and written.\n\n");
+    printf("The file is read, filtered and written [-b <block_frames>] ");
+    printf("frames at a time, at\nmost %d. The default of 0 ",
+           MAX_BLOCK_FRAMES);
+    printf("picks the largest block that still fits in the\nprocessor's ");
+    printf("L2 cache alongside the filter, so each block is filtered ");
+    printf("straight\nfrom cache. Within a block the FIR runs tap by tap ");
+    printf("across a tile of outputs,\nwhich is about twice as fast as one ");
+    printf("output at a time.\n\n");
+    printf("[-l <phase_mode>] selects how the filter delays the ");
+    printf("signal:\n");
+    printf(" - linear (default), every frequency is delayed by half the ");
+    printf("order\n");
+    printf(" - minimum, the same magnitude response with far less delay, ");
+    printf("for\n   monitoring\n");
+    printf(" - compensated, linear phase with the delay removed, so the ");
+    printf("output lines\n   up with the input sample for sample. An ");
+    printf("odd order leaves it half a\n   sample behind.\n\n");
+    printf("[-i <iir_response>] replaces the FIR with a far cheaper IIR ");
+    printf("filter whose phase\nis not linear, made of second order ");
+    printf("sections. [-o <order>] then sets its\norder, from 1 to 16, ");
+    printf("with a default of 4. Valid responses are:\n");
+    printf(" - butterworth, maximally flat and 3dB down at the cutoff\n");
+    printf(" - linkwitz-riley, a butterworth of half the order applied ");
+    printf("twice, 6dB down\n   at the cutoff like the FIR\n\n");
+    printf("[-m <envelope_file>] sweeps the cutoff instead of holding it ");
+    printf("at\n<cutoff_frequency>. Each line of the file holds a time in ");
+    printf("seconds and a cutoff\nfrequency, times in increasing order. ");
+    printf("The cutoff moves evenly in pitch from\none line to the next ");
+    printf("and holds before the first and after the last. Blank\nlines ");
+    printf("and lines starting with # are ignored. Filters across the ");
+    printf("range are\ndesigned up front and blended as the cutoff moves, ");
+    printf("so the sweep is smooth.\n\n");
+    printf("[-n <arithmetic>] selects what the FIR computes in:\n");
+    printf(" - float (default)\n");
+    printf(" - fixed, for 16 and 24 bit PCM input, which is filtered as ");
+    printf("integers without\n   converting to float, with 15 and 31 bit ");
+    printf("coefficients. 24 bit output is\n   as accurate as float; ");
+    printf("16 bit output strays a few bits further, more\n   at high ");
+    printf("orders. Other input, decimation, sweeps, the IIR filter and\n");
+    printf("   orders float would filter by FFT use float. Runs on one ");
+    printf("thread.\n");
+    printf(" - double-sum, which keeps float samples and coefficients but ");
+    printf("sums each output\n   in double\n");
+    printf(" - kahan, which sums in float with Kahan compensation\n");
+    printf(" - double, which designs, stores and sums everything in double\n");
+    printf("   These three take any input and leave float output a tenth as ");
+    printf("far from exact.\n   They run on one thread in direct form at ");
+    printf("every order, so cost 4 times\n   float at order 126 and up to ");
+    printf("30 times at orders float would filter by\n   FFT. Decimation, ");
+    printf("sweeps and the IIR filter use float.\n\n");
+    printf("[--stats <stats_file>] writes measurements of the run to ");
+    printf("<stats_file> as JSON,\nor - to print them with the report: ");
+    printf("frames read and written, time spent\nreading, filtering and ");
+    printf("writing, the realtime factor, peak memory and a\nhistogram ");
+    printf("of how long each block took to filter. Timing costs a few clock ");
+    printf("reads\na block. Not available with --batch.\n\n");
+    printf("[-d <decimation>] keeps only every <decimation>th output ");
+    printf("sample, so the filter\nacts as the anti-aliasing stage of a ");
+    printf("downsampler. Only the kept samples\nare computed. The output ");
+    printf("sample rate is the input rate divided by\n<decimation>, which ");
+    printf("must divide it exactly, and the cutoff must not exceed\nhalf ");
+    printf("the output rate. The default of 1 keeps every sample.\n\n");
+    printf("Either file name may be - to read from stdin or write to ");
+    printf("stdout, so the filter\ncan sit in a pipeline. Streams are ");
+    printf("filtered as they arrive and never seeked.\nGiving ");
+    printf("[-r <sample_rate> -c <channels>] reads the input as raw ");
+    printf("samples in\n[-e <encoding>], one of s16 (default), s24, ");
+    printf("s32 or f32, little endian. Output\nto stdout is raw in the ");
+    printf("same encoding, or AU if the input has a header.\n\n");
+    printf("With --batch, every file listed in <batch_file> is filtered ");
+    printf("in one process.\nEach line holds an input file, an output ");
+    printf("file, a cutoff frequency and\noptionally a window type, ");
+    printf("separated by whitespace. Blank lines and lines\nstarting ");
+    printf("with # are ignored. [-j <job_count>] files are filtered at ");
+    printf("once, 0\n(the default) using one per logical processor, ");
+    printf("and each distinct filter is\ndesigned only once. Lines ");
+    printf("without a window use [-w <window_type>].\n\n");
+    printf("With --bank, <input_wave_file> is filtered at every cutoff ");
+    printf("listed in <bank_file>\nin a single pass. Each line holds an ");
+    printf("output file and a cutoff frequency,\nseparated by whitespace. ");
+    printf("Blank lines and lines starting with # are ignored.\nThe input ");
+    printf("is read once and each sample is used for four cutoffs at a ");
+    printf("time, so\nthis is much faster than filtering once per cutoff. ");
+    printf("Every band uses the same\norder, window and phase mode; the ");
+    printf("IIR filter, sweeps and decimation are not\navailable.\n\n");
     printf("Valid window types are:\n");
     printf(" - kaiser (default)\n");
     printf(" - blackman\n");
@@ -143,7 +592,20 @@ void print_manual_page(const char* prog_name)
     printf(" %d - CUTOFF_VALUE_ERROR\n", CUTOFF_VALUE_ERROR);
     printf(" %d - FILTER_FILE_ERROR\n", FILTER_FILE_ERROR);
     printf(" %d - INPUT_FILE_FORMAT_ERROR\n", INPUT_FILE_FORMAT_ERROR);
-    printf(" %d - OUTPUT_FILE_FORMAT_ERROR\n\n", OUTPUT_FILE_FORMAT_ERROR);
+    printf(" %d - OUTPUT_FILE_FORMAT_ERROR\n", OUTPUT_FILE_FORMAT_ERROR);
+    printf(" %d - UNKNOWN_WINDOW_ERROR\n", UNKNOWN_WINDOW_ERROR);
+    printf(" %d - THREAD_COUNT_ERROR\n", THREAD_COUNT_ERROR);
+    printf(" %d - BATCH_FILE_ERROR\n", BATCH_FILE_ERROR);
+    printf(" %d - RAW_FORMAT_ERROR\n", RAW_FORMAT_ERROR);
+    printf(" %d - DECIMATION_ERROR\n", DECIMATION_ERROR);
+    printf(" %d - FILTER_DESIGN_ERROR\n", FILTER_DESIGN_ERROR);
+    printf(" %d - UNKNOWN_PHASE_ERROR\n", UNKNOWN_PHASE_ERROR);
+    printf(" %d - UNKNOWN_RESPONSE_ERROR\n", UNKNOWN_RESPONSE_ERROR);
+    printf(" %d - ENVELOPE_FILE_ERROR\n", ENVELOPE_FILE_ERROR);
+    printf(" %d - UNKNOWN_ARITHMETIC_ERROR\n", UNKNOWN_ARITHMETIC_ERROR);
+    printf(" %d - STATS_FILE_ERROR\n", STATS_FILE_ERROR);
+    printf(" %d - BANK_FILE_ERROR\n", BANK_FILE_ERROR);
+    printf(" %d - BLOCK_SIZE_ERROR\n\n", BLOCK_SIZE_ERROR);
 
     printf("EXAMPLES\n\n");
     printf("%s\n", prog_name);
@@ -153,7 +615,25 @@ void print_manual_page(const char* prog_name)
     printf("%s input.wav output.wav 1000 -w hamming\n", prog_name);
     printf("%s input.wav output.wav 1000 -w hanning\n", prog_name);
     printf("%s input.wav output.wav 1000 -w kaiser\n", prog_name);
-    printf("%s input.wav output.wav 1000 -w rectangular\n\n", prog_name);
+    printf("%s input.wav output.wav 1000 -w rectangular\n", prog_name);
+    printf("%s input.wav output.wav 1000 -t 8\n", prog_name);
+    printf("%s input.wav output.wav 1000 -w hamming -t 0\n", prog_name);
+    printf("%s input.wav output.wav 1000 -p 4\n", prog_name);
+    printf("%s input.wav output.wav 1000 -b 4096\n", prog_name);
+    printf("%s input.wav output.wav 1000 -o 512\n", prog_name);
+    printf("%s input.wav output.wav 18000 -s 20000 -a 96\n", prog_name);
+    printf("%s input.wav output.wav 1000 -l minimum\n", prog_name);
+    printf("%s input.wav output.wav 1000 -l compensated\n", prog_name);
+    printf("%s input.wav output.wav 1000 -i butterworth -o 6\n", prog_name);
+    printf("%s input.wav output.wav 1000 -n fixed\n", prog_name);
+    printf("%s input.wav output.wav 1000 -o 4096 -n double\n", prog_name);
+    printf("%s input.wav output.wav 1000 -m sweep.txt\n", prog_name);
+    printf("%s input.wav output.wav 1000 --stats stats.json\n", prog_name);
+    printf("%s input.wav output.wav 20000 -d 2\n", prog_name);
+    printf("%s --batch files.txt -j 4\n", prog_name);
+    printf("%s --bank input.wav stems.txt -o 256\n", prog_name);
+    printf("sox in.flac -t wav - | %s - - 1000 | lame - out.mp3\n", prog_name);
+    printf("%s - out.wav 1000 -r 48000 -c 2 -e s24 < in.raw\n\n", prog_name);
 
     printf("AUTHOR\n\n");
     printf("Tom Mason | University of Surrey (UG - Music and Media)\n\n");
@@ -181,6 +661,20 @@ bool is_wav_file(const char* file_name)
         return true;
 }
 
+// -----------------------------------------------------------------------------
+// Checks whether file_name names stdin or stdout.
+//
+// Arguments:
+//     file_name - file name string to check
+//
+// Returns:
+//     true if file_name is LPF_STDIO_NAME
+// -----------------------------------------------------------------------------
+bool is_stream(const char* file_name)
+{
+    return !strcmp(file_name, LPF_STDIO_NAME);
+}
+
 // -----------------------------------------------------------------------------
 // Converts cutoff string to a float after checking it represents a valid
 // positive number between 20Hz and 20kHz.
@@ -216,6 +710,191 @@ float get_cutoff(const char* cutoff)
     return cutoff_val;
 }
 
+// -----------------------------------------------------------------------------
+// Converts a count string, such as a thread count, to an int after checking it
+// only contains digits.
+//
+// Arguments:
+//     count - string representing a non-negative count of at most 4 digits
+//
+// Returns:
+//     count, or -1 if the string is not a valid count
+// -----------------------------------------------------------------------------
+int get_count(const char* count)
+{
+    if (!strlen(count) || strlen(count) > 4)
+        return -1;
+
+    for (int i = 0; i < strlen(count); ++i)
+    {
+        if (!isdigit(count[i]))
+            return -1;
+    }
+
+    return atoi(count);
+}
+
+// -----------------------------------------------------------------------------
+// Converts a count string, such as an order or block size, to an int after
+// checking it only contains digits and is no more than a limit.
+//
+// Arguments:
+//     count     - string representing a non-negative count
+//     max_count - largest count accepted
+//
+// Returns:
+//     count, or -1 if the string is not a valid count or is above max_count
+// -----------------------------------------------------------------------------
+int get_bounded_count(const char* count, int max_count)
+{
+    // strtol would also take a sign and leading spaces
+    if (!isdigit(count[0]))
+        return -1;
+
+    char* end = NULL;
+    errno = 0;
+    const long value = strtol(count, &end, 10);
+    if (*end || errno == ERANGE || value > max_count)
+        return -1;
+
+    return (int)value;
+}
+
+// -----------------------------------------------------------------------------
+// Converts sample rate string to an int after checking it only contains digits.
+//
+// Arguments:
+//     sample_rate - string representing sample rate in Hz
+//
+// Returns:
+//     sample rate, or -1 if the string is not a valid rate
+// -----------------------------------------------------------------------------
+int get_sample_rate(const char* sample_rate)
+{
+    if (!strlen(sample_rate) || strlen(sample_rate) > 7)
+        return -1;
+
+    for (int i = 0; i < strlen(sample_rate); ++i)
+    {
+        if (!isdigit(sample_rate[i]))
+            return -1;
+    }
+
+    return atoi(sample_rate);
+}
+
+// -----------------------------------------------------------------------------
+// Converts attenuation string to a float after checking it represents a number
+// between 20dB and 200dB.
+//
+// Arguments:
+//     attenuation - string representing attenuation in dB
+//
+// Returns:
+//     attenuation as a float, or 0 if the string is not valid
+// -----------------------------------------------------------------------------
+float get_attenuation(const char* attenuation)
+{
+    char* end = NULL;
+    const float attenuation_val = strtof(attenuation, &end);
+
+    if (end == attenuation || *end != '\0')
+        return 0;
+
+    if (attenuation_val < 20.0f || attenuation_val > 200.0f)
+        return 0;
+
+    return attenuation_val;
+}
+
+// -----------------------------------------------------------------------------
+// Checks phase_mode against the supported phase modes.
+//
+// Arguments:
+//     phase_mode - name of phase mode as a string
+//
+// Returns:
+//     0 for linear, 1 for minimum, 2 for compensated and -1 if unknown
+// -----------------------------------------------------------------------------
+int get_phase_mode(const char* phase_mode)
+{
+    if (!strcmp(phase_mode, "linear"))
+        return 0;
+    else if (!strcmp(phase_mode, "minimum"))
+        return 1;
+    else if (!strcmp(phase_mode, "compensated"))
+        return 2;
+    else
+        return -1;
+}
+
+// -----------------------------------------------------------------------------
+// Checks iir_response against the supported IIR responses.
+//
+// Arguments:
+//     iir_response - name of IIR response as a string
+//
+// Returns:
+//     enum lpf_iir_response value, or -1 if unknown
+// -----------------------------------------------------------------------------
+int get_iir_response(const char* iir_response)
+{
+    if (!strcmp(iir_response, "butterworth"))
+        return LPF_IIR_BUTTERWORTH;
+    else if (!strcmp(iir_response, "linkwitz-riley"))
+        return LPF_IIR_LINKWITZ_RILEY;
+    else
+        return -1;
+}
+
+// -----------------------------------------------------------------------------
+// Checks arithmetic against the supported arithmetics.
+//
+// Arguments:
+//     arithmetic - name of arithmetic as a string
+//
+// Returns:
+//     enum lpf_arithmetic value, or -1 if unknown
+// -----------------------------------------------------------------------------
+int get_arithmetic(const char* arithmetic)
+{
+    if (!strcmp(arithmetic, "float"))
+        return LPF_ARITHMETIC_FLOAT;
+    else if (!strcmp(arithmetic, "fixed"))
+        return LPF_ARITHMETIC_FIXED;
+    else if (!strcmp(arithmetic, "double-sum"))
+        return LPF_ARITHMETIC_DOUBLE_SUM;
+    else if (!strcmp(arithmetic, "kahan"))
+        return LPF_ARITHMETIC_KAHAN;
+    else if (!strcmp(arithmetic, "double"))
+        return LPF_ARITHMETIC_DOUBLE;
+    else
+        return -1;
+}
+
+// -----------------------------------------------------------------------------
+// Converts a raw encoding name to a libsndfile sample format.
+//
+// Arguments:
+//     encoding - name of encoding as a string
+//
+// Returns:
+//     sample format, or 0 if the name is not recognised
+// -----------------------------------------------------------------------------
+int get_raw_encoding(const char* encoding)
+{
+    if (!strcmp(encoding, "s16"))
+        return SF_FORMAT_PCM_16;
+    else if (!strcmp(encoding, "s24"))
+        return SF_FORMAT_PCM_24;
+    else if (!strcmp(encoding, "s32"))
+        return SF_FORMAT_PCM_32;
+    else if (!strcmp(encoding, "f32"))
+        return SF_FORMAT_FLOAT;
+    else
+        return 0;
+}
+
 // -----------------------------------------------------------------------------
 // Checks window_type against supported window types and returns the appropriate
 // enum value.
@@ -243,3 +922,442 @@ enum window_t get_window_type(const char* window_type)
     else
         return NULL_WINDOW;
 }
+
+// -----------------------------------------------------------------------------
+// Copies a string into newly allocated memory.
+// -----------------------------------------------------------------------------
+char* copy_string(const char* string)
+{
+    char* copy = (char*)malloc(strlen(string) + 1);
+    if (copy)
+        strcpy(copy, string);
+    return copy;
+}
+
+// -----------------------------------------------------------------------------
+// Reads a batch file and filters every file listed in it with one call to
+// lpf_filter_batch. Each line is checked as the command line would be before
+// any file is filtered.
+//
+// Arguments:
+//     lpf             - filter whose settings every file is filtered with
+//     batch_file_name - name of file listing input, output, cutoff and window
+//     window_type     - window for lines that do not give one
+//     worker_count    - number of files filtered at once, 0 for one per
+//                       logical processor
+//
+// Returns:
+//     NO_ERROR if every file was filtered
+// -----------------------------------------------------------------------------
+int filter_batch(low_pass_filter_t* lpf,
+                 const char* batch_file_name,
+                 enum window_t window_type,
+                 int worker_count)
+{
+    FILE* batch_file = fopen(batch_file_name, "r");
+    if (!batch_file)
+    {
+        eprintf("unable to open batch file %s\n", batch_file_name);
+        return BATCH_FILE_ERROR;
+    }
+
+    lpf_batch_job_t* jobs = NULL;
+    size_t job_count = 0;
+    size_t job_capacity = 0;
+    int retcode = NO_ERROR;
+
+    char line[MAX_BATCH_LINE];
+    char input[MAX_BATCH_LINE];
+    char output[MAX_BATCH_LINE];
+    char cutoff[MAX_BATCH_LINE];
+    char window[MAX_BATCH_LINE];
+
+    for (int line_number = 1;
+         retcode == NO_ERROR && fgets(line, sizeof(line), batch_file);
+         ++line_number)
+    {
+        const int fields =
+            sscanf(line, "%s %s %s %s", input, output, cutoff, window);
+
+        if (fields <= 0 || input[0] == '#')
+            continue;
+
+        lpf_batch_job_t job = { 0 };
+        job.cutoff = fields >= 3 ? get_cutoff(cutoff) : 0.0f;
+        job.window_type = fields == 4 ? get_window_type(window) : window_type;
+
+        if (fields < 3)
+        {
+            eprintf("%s:%d: expected input, output and cutoff\n",
+                    batch_file_name, line_number);
+            retcode = BATCH_FILE_ERROR;
+        }
+        else if (!is_wav_file(input))
+        {
+            eprintf("%s:%d: input file %s does not exist\n",
+                    batch_file_name, line_number, input);
+            retcode = INPUT_FILE_FORMAT_ERROR;
+        }
+        else if (!is_wav_file(output))
+        {
+            eprintf("%s:%d: output file %s does not exist\n",
+                    batch_file_name, line_number, output);
+            retcode = OUTPUT_FILE_FORMAT_ERROR;
+        }
+        else if (!job.cutoff)
+        {
+            eprintf("%s:%d: cutoff frequency must be a positive numerical "
+                    "value between 20Hz and 20000Hz.\n",
+                    batch_file_name, line_number);
+            retcode = CUTOFF_VALUE_ERROR;
+        }
+        else if (job.window_type == NULL_WINDOW)
+        {
+            eprintf("%s:%d: unknown window type %s.\n",
+                    batch_file_name, line_number, window);
+            retcode = UNKNOWN_WINDOW_ERROR;
+        }
+        else
+        {
+            if (job_count == job_capacity)
+            {
+                job_capacity = job_capacity ? 2 * job_capacity : 16;
+                lpf_batch_job_t* grown = (lpf_batch_job_t*)realloc(
+                    jobs, job_capacity * sizeof(lpf_batch_job_t));
+                if (!grown)
+                {
+                    retcode = FILTER_FILE_ERROR;
+                    break;
+                }
+                jobs = grown;
+            }
+
+            job.input_file = copy_string(input);
+            job.output_file = copy_string(output);
+            jobs[job_count++] = job;
+
+            if (!job.input_file || !job.output_file)
+                retcode = FILTER_FILE_ERROR;
+        }
+    }
+
+    fclose(batch_file);
+
+    if (retcode == NO_ERROR)
+    {
+        lpf_filter_batch(lpf, jobs, job_count, worker_count);
+
+        for (size_t i = 0; i < job_count; ++i)
+        {
+            if (jobs[i].result == LPF_NO_ERROR)
+            {
+                printf("--- filtered %lld frames of %s! ---\n",
+                       jobs[i].frames_filtered,
+                       jobs[i].input_file);
+            }
+            else
+            {
+                eprintf("failed to filter %s\n", jobs[i].input_file);
+                retcode = FILTER_FILE_ERROR;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < job_count; ++i)
+    {
+        free((char*)jobs[i].input_file);
+        free((char*)jobs[i].output_file);
+    }
+    free(jobs);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Reads a bank file and filters the input at every cutoff listed in it with one
+// call to lpf_filter_bank. Each line is checked as the command line would be
+// before the input is read.
+//
+// Arguments:
+//     lpf             - filter whose settings every band is filtered with
+//     input_file_name - name of file to filter
+//     bank_file_name  - name of file listing output files and cutoffs
+//     window_type     - window of every band
+//     frames_filtered - receives the number of frames written to each output
+//
+// Returns:
+//     NO_ERROR if every band was filtered
+// -----------------------------------------------------------------------------
+int filter_bands(low_pass_filter_t* lpf,
+                 const char* input_file_name,
+                 const char* bank_file_name,
+                 enum window_t window_type,
+                 sf_count_t* frames_filtered)
+{
+    FILE* bank_file = fopen(bank_file_name, "r");
+    if (!bank_file)
+    {
+        eprintf("unable to open bank file %s\n", bank_file_name);
+        return BANK_FILE_ERROR;
+    }
+
+    lpf_band_t* bands = NULL;
+    size_t band_count = 0;
+    size_t band_capacity = 0;
+    int retcode = NO_ERROR;
+
+    char line[MAX_BATCH_LINE];
+    char output[MAX_BATCH_LINE];
+    char cutoff[MAX_BATCH_LINE];
+
+    for (int line_number = 1;
+         retcode == NO_ERROR && fgets(line, sizeof(line), bank_file);
+         ++line_number)
+    {
+        const int fields = sscanf(line, "%s %s", output, cutoff);
+
+        if (fields <= 0 || output[0] == '#')
+            continue;
+
+        lpf_band_t band = { 0 };
+        band.cutoff = fields == 2 ? get_cutoff(cutoff) : 0.0f;
+
+        if (fields != 2)
+        {
+            eprintf("%s:%d: expected an output file and a cutoff\n",
+                    bank_file_name, line_number);
+            retcode = BANK_FILE_ERROR;
+        }
+        else if (!is_wav_file(output))
+        {
+            eprintf("%s:%d: output file %s does not exist\n",
+                    bank_file_name, line_number, output);
+            retcode = OUTPUT_FILE_FORMAT_ERROR;
+        }
+        else if (!band.cutoff)
+        {
+            eprintf("%s:%d: cutoff frequency must be a positive numerical "
+                    "value between 20Hz and 20000Hz.\n",
+                    bank_file_name, line_number);
+            retcode = CUTOFF_VALUE_ERROR;
+        }
+        else
+        {
+            if (band_count == band_capacity)
+            {
+                band_capacity = band_capacity ? 2 * band_capacity : 16;
+                lpf_band_t* grown = (lpf_band_t*)realloc(
+                    bands, band_capacity * sizeof(lpf_band_t));
+                if (!grown)
+                {
+                    retcode = FILTER_FILE_ERROR;
+                    break;
+                }
+                bands = grown;
+            }
+
+            band.output_file = copy_string(output);
+            bands[band_count++] = band;
+
+            if (!band.output_file)
+                retcode = FILTER_FILE_ERROR;
+        }
+    }
+
+    fclose(bank_file);
+
+    if (retcode == NO_ERROR && band_count == 0)
+    {
+        eprintf("bank file %s has no bands\n", bank_file_name);
+        retcode = BANK_FILE_ERROR;
+    }
+
+    if (retcode == NO_ERROR &&
+        lpf_filter_bank(lpf,
+                        input_file_name,
+                        bands,
+                        band_count,
+                        window_type,
+                        frames_filtered) != LPF_NO_ERROR)
+    {
+        retcode = FILTER_FILE_ERROR;
+    }
+
+    for (size_t i = 0; i < band_count; ++i)
+        free((char*)bands[i].output_file);
+    free(bands);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Reads a breakpoint file and makes the filter's cutoff follow it. Each line is
+// checked before any of it is used.
+//
+// Arguments:
+//     lpf                - filter whose cutoff the envelope drives
+//     envelope_file_name - name of file listing times and cutoffs
+//
+// Returns:
+//     NO_ERROR if the envelope was read and set
+// -----------------------------------------------------------------------------
+int read_envelope(low_pass_filter_t* lpf, const char* envelope_file_name)
+{
+    FILE* envelope_file = fopen(envelope_file_name, "r");
+    if (!envelope_file)
+    {
+        eprintf("unable to open envelope file %s\n", envelope_file_name);
+        return ENVELOPE_FILE_ERROR;
+    }
+
+    float* times = NULL;
+    float* cutoffs = NULL;
+    size_t point_count = 0;
+    size_t point_capacity = 0;
+    int retcode = NO_ERROR;
+
+    char line[MAX_BATCH_LINE];
+    char time[MAX_BATCH_LINE];
+    char cutoff[MAX_BATCH_LINE];
+
+    for (int line_number = 1;
+         retcode == NO_ERROR && fgets(line, sizeof(line), envelope_file);
+         ++line_number)
+    {
+        const int fields = sscanf(line, "%s %s", time, cutoff);
+
+        if (fields <= 0 || time[0] == '#')
+            continue;
+
+        char* end = NULL;
+        const float time_val = strtof(time, &end);
+        const float cutoff_val = fields == 2 ? get_cutoff(cutoff) : 0.0f;
+
+        if (fields != 2)
+        {
+            eprintf("%s:%d: expected a time and a cutoff\n",
+                    envelope_file_name, line_number);
+            retcode = ENVELOPE_FILE_ERROR;
+        }
+        else if (end == time || *end != '\0' || time_val < 0 ||
+                 (point_count > 0 && time_val < times[point_count - 1]))
+        {
+            eprintf("%s:%d: time must be a number of seconds no earlier than "
+                    "the line before.\n",
+                    envelope_file_name, line_number);
+            retcode = ENVELOPE_FILE_ERROR;
+        }
+        else if (!cutoff_val)
+        {
+            eprintf("%s:%d: cutoff frequency must be a positive numerical "
+                    "value between 20Hz and 20000Hz.\n",
+                    envelope_file_name, line_number);
+            retcode = CUTOFF_VALUE_ERROR;
+        }
+        else
+        {
+            if (point_count == point_capacity)
+            {
+                point_capacity = point_capacity ? 2 * point_capacity : 16;
+                float* grown_times =
+                    (float*)realloc(times, point_capacity * sizeof(float));
+                if (grown_times)
+                    times = grown_times;
+                float* grown_cutoffs =
+                    (float*)realloc(cutoffs, point_capacity * sizeof(float));
+                if (grown_cutoffs)
+                    cutoffs = grown_cutoffs;
+
+                if (!grown_times || !grown_cutoffs)
+                {
+                    retcode = ENVELOPE_FILE_ERROR;
+                    break;
+                }
+            }
+
+            times[point_count] = time_val;
+            cutoffs[point_count] = cutoff_val;
+            ++point_count;
+        }
+    }
+
+    fclose(envelope_file);
+
+    if (retcode == NO_ERROR && point_count == 0)
+    {
+        eprintf("envelope file %s has no breakpoints\n", envelope_file_name);
+        retcode = ENVELOPE_FILE_ERROR;
+    }
+
+    if (retcode == NO_ERROR &&
+        lpf_set_cutoff_envelope(lpf, times, cutoffs, point_count) !=
+            LPF_NO_ERROR)
+    {
+        eprintf("unable to set envelope from %s\n", envelope_file_name);
+        retcode = ENVELOPE_FILE_ERROR;
+    }
+
+    free(times);
+    free(cutoffs);
+
+    return retcode;
+}
+
+// -----------------------------------------------------------------------------
+// Writes stats as a JSON object. Times are in nanoseconds. The latency
+// histogram gives each bin's upper edge in microseconds, null for the last,
+// which has none.
+//
+// Arguments:
+//     stats_file - file to write to
+//     stats      - stats of a run of lpf_filter_file
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void write_stats(FILE* stats_file, const lpf_stats_t* stats)
+{
+    fprintf(stats_file, "{\n");
+    fprintf(stats_file, "  \"frames_read\": %lld,\n", stats->frames_read);
+    fprintf(stats_file, "  \"frames_written\": %lld,\n", stats->frames_written);
+    fprintf(stats_file, "  \"sample_rate\": %d,\n", stats->sample_rate);
+    fprintf(stats_file, "  \"channels\": %d,\n", stats->channels);
+    fprintf(stats_file,
+            "  \"read_ns\": %llu,\n",
+            (unsigned long long)stats->read_ns);
+    fprintf(stats_file,
+            "  \"filter_ns\": %llu,\n",
+            (unsigned long long)stats->filter_ns);
+    fprintf(stats_file,
+            "  \"write_ns\": %llu,\n",
+            (unsigned long long)stats->write_ns);
+    fprintf(stats_file,
+            "  \"total_ns\": %llu,\n",
+            (unsigned long long)stats->total_ns);
+    fprintf(stats_file,
+            "  \"realtime_factor\": %.2f,\n",
+            stats->realtime_factor);
+    fprintf(stats_file,
+            "  \"peak_memory_bytes\": %llu,\n",
+            (unsigned long long)stats->peak_memory_bytes);
+    fprintf(stats_file, "  \"blocks\": %lld,\n", stats->blocks);
+    fprintf(stats_file,
+            "  \"max_block_ns\": %llu,\n",
+            (unsigned long long)stats->max_block_ns);
+
+    fprintf(stats_file, "  \"block_latency\": [\n");
+    for (int i = 0; i < LPF_STATS_LATENCY_BINS; ++i)
+    {
+        if (i + 1 < LPF_STATS_LATENCY_BINS)
+            fprintf(stats_file, "    {\"below_us\": %lu, ", 1ul << i);
+        else
+            fprintf(stats_file, "    {\"below_us\": null, ");
+
+        fprintf(stats_file,
+                "\"count\": %lld}%s\n",
+                stats->block_latency[i],
+                i + 1 < LPF_STATS_LATENCY_BINS ? "," : "");
+    }
+    fprintf(stats_file, "  ]\n");
+    fprintf(stats_file, "}\n");
+}
@@ -0,0 +1,836 @@
+
+#include "mapped_wav.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "workspace.h"
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+// Bytes of the input Windows is asked to page in ahead of the frame being
+// read. Mapped views get no read-ahead from FILE_FLAG_SEQUENTIAL_SCAN, which
+// only applies to ReadFile.
+#define MAPPED_WAV_PREFETCH_BYTES (4 << 20)
+
+// -----------------------------------------------------------------------------
+// Struct containing a WAV file mapped into memory whole, for reading or for
+// writing, and the position in its data chunk.
+// -----------------------------------------------------------------------------
+typedef struct mapped_wav
+{
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+    size_t prefetched;
+#else
+    int fd;
+#endif
+    unsigned char* base;
+    size_t mapped_size;
+    unsigned char* data;
+    size_t header_size;
+    bool writable;
+    int channels;
+    int samplerate;
+    int sample_format;
+    size_t frame_bytes;
+    sf_count_t frames;
+    sf_count_t position;
+} mapped_wav_t;
+
+bool map_file(mapped_wav_t* wav, const char* file_name, size_t size);
+
+bool unmap_file(mapped_wav_t* wav, size_t final_size);
+
+bool parse_header(mapped_wav_t* wav);
+
+void write_header(mapped_wav_t* wav, size_t data_bytes);
+
+static uint32_t read_u32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+           (uint32_t)p[3] << 24;
+}
+
+static unsigned read_u16(const unsigned char* p)
+{
+    return (unsigned)p[0] | (unsigned)p[1] << 8;
+}
+
+static unsigned char* put_u32(unsigned char* p, uint32_t value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+    return p + 4;
+}
+
+static unsigned char* put_u16(unsigned char* p, unsigned value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    return p + 2;
+}
+
+static unsigned char* put_id(unsigned char* p, const char* id)
+{
+    memcpy(p, id, 4);
+    return p + 4;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the bytes per sample of a libsndfile sample format that mapped_wav_t
+// handles, or 0 if it does not handle it.
+// -----------------------------------------------------------------------------
+static size_t sample_bytes(int sample_format)
+{
+    switch (sample_format)
+    {
+    case SF_FORMAT_PCM_16: return 2;
+    case SF_FORMAT_PCM_24: return 3;
+    case SF_FORMAT_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Gets the bytes mapped_wav_open_init and mapped_wav_create_init need.
+// -----------------------------------------------------------------------------
+size_t mapped_wav_size(void)
+{
+    return workspace_round(sizeof(mapped_wav_t));
+}
+
+// -----------------------------------------------------------------------------
+// Maps a WAV file into memory for reading and advises the system that it will
+// be read sequentially. Only RIFF WAV holding 16 or 24 bit PCM or 32 bit float
+// is mapped; anything else, and anything that fails to map, is left to
+// libsndfile.
+//
+// Arguments:
+//     memory    - mapped_wav_size bytes, kept until the file is closed
+//     file_name - name of file to open
+//     info      - receives the format of the file, as from sf_open
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if the file is
+//     not mapped
+// -----------------------------------------------------------------------------
+mapped_wav_t* mapped_wav_open_init(void* memory,
+                                   const char* file_name,
+                                   SF_INFO* info)
+{
+    mapped_wav_t* wav = (mapped_wav_t*)memory;
+    memset(wav, 0, sizeof(mapped_wav_t));
+
+    if (!map_file(wav, file_name, 0))
+        return NULL;
+
+    if (!parse_header(wav))
+    {
+        mapped_wav_close(wav);
+        return NULL;
+    }
+
+    memset(info, 0, sizeof(SF_INFO));
+    info->frames = wav->frames;
+    info->samplerate = wav->samplerate;
+    info->channels = wav->channels;
+    info->format = SF_FORMAT_WAV | wav->sample_format;
+    info->sections = 1;
+    info->seekable = SF_TRUE;
+
+    return wav;
+}
+
+// -----------------------------------------------------------------------------
+// Creates a WAV file big enough for max_frames and maps it into memory for
+// writing. The header is written and the file cut to the frames actually
+// written when it is closed.
+//
+// Arguments:
+//     memory     - mapped_wav_size bytes, kept until the file is closed
+//     file_name  - name of file to create
+//     info       - format to write, which must be WAV holding 16 or 24 bit
+//                  PCM or 32 bit float
+//     max_frames - most frames that will be written
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if the file is
+//     not mapped
+// -----------------------------------------------------------------------------
+mapped_wav_t* mapped_wav_create_init(void* memory,
+                                     const char* file_name,
+                                     const SF_INFO* info,
+                                     sf_count_t max_frames)
+{
+    const int sample_format = info->format & SF_FORMAT_SUBMASK;
+    const size_t bytes = sample_bytes(sample_format);
+
+    if ((info->format & SF_FORMAT_TYPEMASK) != SF_FORMAT_WAV || bytes == 0 ||
+        info->channels <= 0 || max_frames < 0)
+        return NULL;
+
+    // RIFF, fmt and data chunk headers, and for float the fmt extension
+    // size and the fact chunk that non-PCM formats must carry
+    const size_t header_size =
+        sample_format == SF_FORMAT_FLOAT ? 12 + 26 + 12 + 8 : 12 + 24 + 8;
+    const size_t frame_bytes = bytes * (size_t)info->channels;
+
+    // the RIFF chunk size is 32 bits; longer files are libsndfile's to refuse
+    if ((uint64_t)max_frames > (UINT32_MAX - header_size) / frame_bytes)
+        return NULL;
+
+    mapped_wav_t* wav = (mapped_wav_t*)memory;
+    memset(wav, 0, sizeof(mapped_wav_t));
+
+    wav->writable = true;
+    wav->header_size = header_size;
+    wav->channels = info->channels;
+    wav->samplerate = info->samplerate;
+    wav->sample_format = sample_format;
+    wav->frame_bytes = frame_bytes;
+    wav->frames = max_frames;
+
+    // one spare byte for the pad an odd length data chunk is followed by
+    if (!map_file(wav,
+                  file_name,
+                  header_size + (size_t)max_frames * frame_bytes + 1))
+        return NULL;
+
+    wav->data = wav->base + header_size;
+
+    return wav;
+}
+
+// -----------------------------------------------------------------------------
+// Converts frames straight from the mapped data chunk to float, scaled as
+// sf_readf_float scales them.
+//
+// Arguments:
+//     wav          - file opened by mapped_wav_open_init
+//     audio_buffer - receives frames * channels samples
+//     frames       - number of frames to read
+//
+// Returns:
+//     number of frames read, fewer than frames at the end of the file
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_read(mapped_wav_t* wav,
+                           float* audio_buffer,
+                           sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    const unsigned char* source =
+        wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+#ifdef _WIN32
+    const size_t end =
+        (size_t)(source - wav->base) + (size_t)frames * wav->frame_bytes;
+    if (end + MAPPED_WAV_PREFETCH_BYTES / 2 > wav->prefetched &&
+        wav->prefetched < wav->mapped_size)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = wav->base + wav->prefetched;
+        range.NumberOfBytes = wav->mapped_size - wav->prefetched;
+        if (range.NumberOfBytes > MAPPED_WAV_PREFETCH_BYTES)
+            range.NumberOfBytes = MAPPED_WAV_PREFETCH_BYTES;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+        wav->prefetched += range.NumberOfBytes;
+    }
+#endif
+
+    switch (wav->sample_format)
+    {
+    case SF_FORMAT_PCM_16:
+        for (size_t i = 0; i < samples; ++i, source += 2)
+        {
+            const int16_t sample = (int16_t)read_u16(source);
+            audio_buffer[i] = (float)sample * (1.0f / 0x8000);
+        }
+        break;
+    case SF_FORMAT_PCM_24:
+        for (size_t i = 0; i < samples; ++i, source += 3)
+        {
+            // the 24 bits go to the top of an int32 so its sign is theirs
+            const int32_t sample =
+                (int32_t)((uint32_t)source[0] << 8 | (uint32_t)source[1] << 16 |
+                          (uint32_t)source[2] << 24);
+            audio_buffer[i] = (float)sample * (1.0f / 0x80000000u);
+        }
+        break;
+    case SF_FORMAT_FLOAT:
+        // WAV is little endian, as is every target this builds for
+        memcpy(audio_buffer, source, samples * sizeof(float));
+        break;
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Converts float frames straight into the mapped data chunk, scaled as
+// sf_writef_float scales them and clipped to full scale.
+//
+// Arguments:
+//     wav          - file created by mapped_wav_create_init
+//     audio_buffer - frames * channels samples to write
+//     frames       - number of frames to write
+//
+// Returns:
+//     number of frames written, fewer than frames once max_frames is reached
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_write(mapped_wav_t* wav,
+                            const float* audio_buffer,
+                            sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    unsigned char* dest = wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+    switch (wav->sample_format)
+    {
+    case SF_FORMAT_PCM_16:
+        for (size_t i = 0; i < samples; ++i, dest += 2)
+        {
+            float scaled = audio_buffer[i] * 0x7FFF;
+            scaled = scaled > 0x7FFF ? 0x7FFF : scaled;
+            scaled = scaled < -0x8000 ? -0x8000 : scaled;
+            put_u16(dest, (unsigned)(int16_t)lrintf(scaled));
+        }
+        break;
+    case SF_FORMAT_PCM_24:
+        for (size_t i = 0; i < samples; ++i, dest += 3)
+        {
+            float scaled = audio_buffer[i] * 0x7FFFFF;
+            scaled = scaled > 0x7FFFFF ? 0x7FFFFF : scaled;
+            scaled = scaled < -0x800000 ? -0x800000 : scaled;
+            const uint32_t sample = (uint32_t)lrintf(scaled);
+            dest[0] = (unsigned char)sample;
+            dest[1] = (unsigned char)(sample >> 8);
+            dest[2] = (unsigned char)(sample >> 16);
+        }
+        break;
+    case SF_FORMAT_FLOAT:
+        memcpy(dest, audio_buffer, samples * sizeof(float));
+        break;
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Copies PCM frames straight from the mapped data chunk without converting
+// them to float: 16 bit samples to int16_t, and 24 bit samples to the top
+// three bytes of int32_t, as sf_readf_short and sf_readf_int give them.
+//
+// Arguments:
+//     wav          - 16 or 24 bit PCM file opened by mapped_wav_open_init
+//     audio_buffer - receives frames * channels samples
+//     frames       - number of frames to read
+//
+// Returns:
+//     number of frames read, fewer than frames at the end of the file
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_read_pcm(mapped_wav_t* wav,
+                               void* audio_buffer,
+                               sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    const unsigned char* source =
+        wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+    if (wav->sample_format == SF_FORMAT_PCM_16)
+    {
+        memcpy(audio_buffer, source, samples * sizeof(int16_t));
+    }
+    else
+    {
+        int32_t* dest = (int32_t*)audio_buffer;
+        for (size_t i = 0; i < samples; ++i, source += 3)
+            dest[i] = (int32_t)((uint32_t)source[0] << 8 |
+                                (uint32_t)source[1] << 16 |
+                                (uint32_t)source[2] << 24);
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Copies PCM frames straight into the mapped data chunk, the reverse of
+// mapped_wav_read_pcm. The low byte of a 24 bit sample's int32_t is dropped.
+//
+// Arguments:
+//     wav          - 16 or 24 bit PCM file created by mapped_wav_create_init
+//     audio_buffer - frames * channels samples to write
+//     frames       - number of frames to write
+//
+// Returns:
+//     number of frames written, fewer than frames once max_frames is reached
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_write_pcm(mapped_wav_t* wav,
+                                const void* audio_buffer,
+                                sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    unsigned char* dest = wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+    if (wav->sample_format == SF_FORMAT_PCM_16)
+    {
+        memcpy(dest, audio_buffer, samples * sizeof(int16_t));
+    }
+    else
+    {
+        const int32_t* source = (const int32_t*)audio_buffer;
+        for (size_t i = 0; i < samples; ++i, dest += 3)
+        {
+            const uint32_t sample = (uint32_t)source[i];
+            dest[0] = (unsigned char)(sample >> 8);
+            dest[1] = (unsigned char)(sample >> 16);
+            dest[2] = (unsigned char)(sample >> 24);
+        }
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Converts frames straight from the mapped data chunk to double, scaled as
+// sf_readf_double scales them.
+//
+// Arguments:
+//     wav          - file opened by mapped_wav_open_init
+//     audio_buffer - receives frames * channels samples
+//     frames       - number of frames to read
+//
+// Returns:
+//     number of frames read, fewer than frames at the end of the file
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_read_double(mapped_wav_t* wav,
+                                  double* audio_buffer,
+                                  sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    const unsigned char* source =
+        wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+    switch (wav->sample_format)
+    {
+    case SF_FORMAT_PCM_16:
+        for (size_t i = 0; i < samples; ++i, source += 2)
+        {
+            const int16_t sample = (int16_t)read_u16(source);
+            audio_buffer[i] = sample * (1.0 / 0x8000);
+        }
+        break;
+    case SF_FORMAT_PCM_24:
+        for (size_t i = 0; i < samples; ++i, source += 3)
+        {
+            const int32_t sample =
+                (int32_t)((uint32_t)source[0] << 8 | (uint32_t)source[1] << 16 |
+                          (uint32_t)source[2] << 24);
+            audio_buffer[i] = sample * (1.0 / 0x80000000u);
+        }
+        break;
+    case SF_FORMAT_FLOAT:
+        for (size_t i = 0; i < samples; ++i, source += 4)
+        {
+            float sample;
+            memcpy(&sample, source, sizeof(float));
+            audio_buffer[i] = sample;
+        }
+        break;
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Converts double frames straight into the mapped data chunk, scaled as
+// sf_writef_double scales them and clipped to full scale, so each sample is
+// rounded once, at the width of the file.
+//
+// Arguments:
+//     wav          - file created by mapped_wav_create_init
+//     audio_buffer - frames * channels samples to write
+//     frames       - number of frames to write
+//
+// Returns:
+//     number of frames written, fewer than frames once max_frames is reached
+// -----------------------------------------------------------------------------
+sf_count_t mapped_wav_write_double(mapped_wav_t* wav,
+                                   const double* audio_buffer,
+                                   sf_count_t frames)
+{
+    if (frames > wav->frames - wav->position)
+        frames = wav->frames - wav->position;
+    if (frames <= 0)
+        return 0;
+
+    unsigned char* dest = wav->data + (size_t)wav->position * wav->frame_bytes;
+    const size_t samples = (size_t)frames * wav->channels;
+
+    switch (wav->sample_format)
+    {
+    case SF_FORMAT_PCM_16:
+        for (size_t i = 0; i < samples; ++i, dest += 2)
+        {
+            double scaled = audio_buffer[i] * 0x7FFF;
+            scaled = scaled > 0x7FFF ? 0x7FFF : scaled;
+            scaled = scaled < -0x8000 ? -0x8000 : scaled;
+            put_u16(dest, (unsigned)(int16_t)lrint(scaled));
+        }
+        break;
+    case SF_FORMAT_PCM_24:
+        for (size_t i = 0; i < samples; ++i, dest += 3)
+        {
+            double scaled = audio_buffer[i] * 0x7FFFFF;
+            scaled = scaled > 0x7FFFFF ? 0x7FFFFF : scaled;
+            scaled = scaled < -0x800000 ? -0x800000 : scaled;
+            const uint32_t sample = (uint32_t)lrint(scaled);
+            dest[0] = (unsigned char)sample;
+            dest[1] = (unsigned char)(sample >> 8);
+            dest[2] = (unsigned char)(sample >> 16);
+        }
+        break;
+    case SF_FORMAT_FLOAT:
+        for (size_t i = 0; i < samples; ++i, dest += 4)
+        {
+            const float sample = (float)audio_buffer[i];
+            memcpy(dest, &sample, sizeof(float));
+        }
+        break;
+    }
+
+    wav->position += frames;
+
+    return frames;
+}
+
+// -----------------------------------------------------------------------------
+// Unmaps and closes a file. A file being written gets its header and is cut to
+// the frames written.
+//
+// Arguments:
+//     wav - file to close, may be NULL
+//
+// Returns:
+//     0 on success, as sf_close does
+// -----------------------------------------------------------------------------
+int mapped_wav_close(mapped_wav_t* wav)
+{
+    if (!wav)
+        return 0;
+
+    size_t final_size = wav->mapped_size;
+    if (wav->writable)
+    {
+        const size_t data_bytes = (size_t)wav->position * wav->frame_bytes;
+        wav->data[data_bytes] = 0;
+        write_header(wav, data_bytes);
+        final_size = wav->header_size + data_bytes + (data_bytes & 1);
+    }
+
+    return unmap_file(wav, final_size) ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// Finds the fmt and data chunks of a mapped file and checks that it holds a
+// sample format mapped_wav_t converts.
+//
+// Returns:
+//     true if the file can be read from the mapping
+// -----------------------------------------------------------------------------
+bool parse_header(mapped_wav_t* wav)
+{
+    const unsigned char* base = wav->base;
+    const size_t size = wav->mapped_size;
+
+    if (size < 12 || memcmp(base, "RIFF", 4) || memcmp(base + 8, "WAVE", 4))
+        return false;
+
+    unsigned format_tag = 0;
+    unsigned bits = 0;
+    unsigned block_align = 0;
+    size_t offset = 12;
+
+    while (offset + 8 <= size)
+    {
+        const unsigned char* chunk = base + offset;
+        const size_t length = read_u32(chunk + 4);
+        offset += 8;
+
+        if (!memcmp(chunk, "fmt ", 4) && length >= 16 && offset + length <= size)
+        {
+            format_tag = read_u16(chunk + 8);
+            wav->channels = (int)read_u16(chunk + 10);
+            wav->samplerate = (int)read_u32(chunk + 12);
+            block_align = read_u16(chunk + 20);
+            bits = read_u16(chunk + 22);
+
+            // extensible keeps the real format tag at the start of its GUID
+            if (format_tag == WAVE_FORMAT_EXTENSIBLE && length >= 40)
+            {
+                if (read_u16(chunk + 26) != bits)
+                    return false;
+                format_tag = read_u16(chunk + 32);
+            }
+        }
+        else if (!memcmp(chunk, "data", 4))
+        {
+            if (format_tag == WAVE_FORMAT_PCM && bits == 16)
+                wav->sample_format = SF_FORMAT_PCM_16;
+            else if (format_tag == WAVE_FORMAT_PCM && bits == 24)
+                wav->sample_format = SF_FORMAT_PCM_24;
+            else if (format_tag == WAVE_FORMAT_IEEE_FLOAT && bits == 32)
+                wav->sample_format = SF_FORMAT_FLOAT;
+            else
+                return false;
+
+            wav->frame_bytes =
+                sample_bytes(wav->sample_format) * (size_t)wav->channels;
+            if (wav->channels <= 0 || block_align != wav->frame_bytes)
+                return false;
+
+            // a truncated file, or a streamed one whose length was never
+            // filled in, is read as far as it goes
+            const size_t available = size - offset;
+            wav->data = (unsigned char*)base + offset;
+            wav->frames = (sf_count_t)((length < available ? length : available) /
+                                       wav->frame_bytes);
+            return true;
+        }
+
+        offset += length + (length & 1);
+    }
+
+    return false;
+}
+
+// -----------------------------------------------------------------------------
+// Writes the header of a file being written, for data_bytes of samples.
+// -----------------------------------------------------------------------------
+void write_header(mapped_wav_t* wav, size_t data_bytes)
+{
+    const bool is_float = wav->sample_format == SF_FORMAT_FLOAT;
+    const unsigned bytes = (unsigned)sample_bytes(wav->sample_format);
+    const unsigned block_align = bytes * (unsigned)wav->channels;
+
+    unsigned char* p = wav->base;
+    p = put_id(p, "RIFF");
+    p = put_u32(p, (uint32_t)(wav->header_size - 8 + data_bytes +
+                              (data_bytes & 1)));
+    p = put_id(p, "WAVE");
+
+    p = put_id(p, "fmt ");
+    p = put_u32(p, is_float ? 18 : 16);
+    p = put_u16(p, is_float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM);
+    p = put_u16(p, (unsigned)wav->channels);
+    p = put_u32(p, (uint32_t)wav->samplerate);
+    p = put_u32(p, (uint32_t)wav->samplerate * block_align);
+    p = put_u16(p, block_align);
+    p = put_u16(p, bytes * 8);
+
+    if (is_float)
+    {
+        p = put_u16(p, 0);
+        p = put_id(p, "fact");
+        p = put_u32(p, 4);
+        p = put_u32(p, (uint32_t)wav->position);
+    }
+
+    p = put_id(p, "data");
+    put_u32(p, (uint32_t)data_bytes);
+}
+
+// -----------------------------------------------------------------------------
+// Maps a whole file into memory, for reading if size is 0 or else for writing
+// after creating the file size bytes long, and advises the system it will be
+// accessed sequentially.
+// -----------------------------------------------------------------------------
+bool map_file(mapped_wav_t* wav, const char* file_name, size_t size)
+{
+#ifdef _WIN32
+    wav->file = CreateFileA(file_name,
+                            wav->writable ? GENERIC_READ | GENERIC_WRITE
+                                          : GENERIC_READ,
+                            wav->writable ? 0 : FILE_SHARE_READ,
+                            NULL,
+                            wav->writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                            NULL);
+    if (wav->file == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!wav->writable)
+    {
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(wav->file, &file_size) || file_size.QuadPart == 0 ||
+            (unsigned long long)file_size.QuadPart > SIZE_MAX)
+        {
+            CloseHandle(wav->file);
+            return false;
+        }
+        size = (size_t)file_size.QuadPart;
+    }
+
+    // a writable mapping of a given size extends the file to it
+    const unsigned long long mapping_size = size;
+    wav->mapping = CreateFileMappingA(wav->file,
+                                      NULL,
+                                      wav->writable ? PAGE_READWRITE
+                                                    : PAGE_READONLY,
+                                      (DWORD)(mapping_size >> 32),
+                                      (DWORD)mapping_size,
+                                      NULL);
+    if (wav->mapping)
+    {
+        wav->base = (unsigned char*)MapViewOfFile(
+            wav->mapping, wav->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0,
+            0);
+    }
+
+    if (!wav->base)
+    {
+        if (wav->mapping)
+            CloseHandle(wav->mapping);
+        CloseHandle(wav->file);
+        return false;
+    }
+#else
+    wav->fd = wav->writable ? open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0666)
+                            : open(file_name, O_RDONLY);
+    if (wav->fd < 0)
+        return false;
+
+    bool sized = true;
+    if (wav->writable)
+    {
+    #ifdef __linux__
+        // reserves the blocks, so a full disk fails here rather than as a
+        // SIGBUS when a page of the mapping is first written
+        sized = posix_fallocate(wav->fd, 0, (off_t)size) == 0;
+    #else
+        sized = ftruncate(wav->fd, (off_t)size) == 0;
+    #endif
+    }
+    else
+    {
+        struct stat file_status;
+        sized = fstat(wav->fd, &file_status) == 0 && file_status.st_size > 0 &&
+                (unsigned long long)file_status.st_size <= SIZE_MAX;
+        if (sized)
+            size = (size_t)file_status.st_size;
+    }
+
+    void* base = MAP_FAILED;
+    if (sized)
+    {
+        base = mmap(NULL,
+                    size,
+                    wav->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED,
+                    wav->fd,
+                    0);
+    }
+
+    if (base == MAP_FAILED)
+    {
+        close(wav->fd);
+        return false;
+    }
+
+    wav->base = (unsigned char*)base;
+    madvise(base, size, MADV_SEQUENTIAL);
+#endif
+
+    wav->mapped_size = size;
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Unmaps and closes a file mapped by map_file, cutting it to final_size bytes
+// if it was written.
+//
+// Returns:
+//     false if a written file could not be cut to length
+// -----------------------------------------------------------------------------
+bool unmap_file(mapped_wav_t* wav, size_t final_size)
+{
+    bool cut = true;
+
+#ifdef _WIN32
+    UnmapViewOfFile(wav->base);
+    CloseHandle(wav->mapping);
+
+    if (wav->writable)
+    {
+        LARGE_INTEGER end;
+        end.QuadPart = (LONGLONG)final_size;
+        cut = SetFilePointerEx(wav->file, end, NULL, FILE_BEGIN) &&
+              SetEndOfFile(wav->file);
+    }
+
+    CloseHandle(wav->file);
+#else
+    munmap(wav->base, wav->mapped_size);
+
+    if (wav->writable)
+        cut = ftruncate(wav->fd, (off_t)final_size) == 0;
+
+    close(wav->fd);
+#endif
+
+    return cut;
+}
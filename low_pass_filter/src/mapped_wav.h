@@ -0,0 +1,43 @@
+#pragma once
+
+#include <sndfile.h>
+#include <stddef.h>
+
+typedef struct mapped_wav mapped_wav_t;
+
+size_t mapped_wav_size(void);
+
+mapped_wav_t* mapped_wav_open_init(void* memory,
+                                   const char* file_name,
+                                   SF_INFO* info);
+
+mapped_wav_t* mapped_wav_create_init(void* memory,
+                                     const char* file_name,
+                                     const SF_INFO* info,
+                                     sf_count_t max_frames);
+
+sf_count_t mapped_wav_read(mapped_wav_t* wav,
+                           float* audio_buffer,
+                           sf_count_t frames);
+
+sf_count_t mapped_wav_write(mapped_wav_t* wav,
+                            const float* audio_buffer,
+                            sf_count_t frames);
+
+sf_count_t mapped_wav_read_pcm(mapped_wav_t* wav,
+                               void* audio_buffer,
+                               sf_count_t frames);
+
+sf_count_t mapped_wav_write_pcm(mapped_wav_t* wav,
+                                const void* audio_buffer,
+                                sf_count_t frames);
+
+sf_count_t mapped_wav_read_double(mapped_wav_t* wav,
+                                  double* audio_buffer,
+                                  sf_count_t frames);
+
+sf_count_t mapped_wav_write_double(mapped_wav_t* wav,
+                                   const double* audio_buffer,
+                                   sf_count_t frames);
+
+int mapped_wav_close(mapped_wav_t* wav);
@@ -0,0 +1,231 @@
+
+#include "overlap_save.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft.h"
+#include "workspace.h"
+
+// -----------------------------------------------------------------------------
+// Struct containing data needed to convolve interleaved audio with a fixed
+// impulse response using FFT overlap-save.
+//
+// Each FFT frame holds filter_length - 1 samples of history followed by up to
+// step new samples. Circular wrap-around only corrupts the first
+// filter_length - 1 outputs of the frame, which are discarded. Channels are
+// transformed in pairs, one in the real part and one in the imaginary part,
+// which is valid because the impulse response is real.
+// -----------------------------------------------------------------------------
+typedef struct overlap_save
+{
+    fft_plan_t* plan;
+    size_t filter_length;
+    size_t step;
+    int channel_count;
+    float* response_real;
+    float* response_imag;
+    float* history;
+    float* frame_real;
+    float* frame_imag;
+} overlap_save_t;
+
+void overlap_save_chunk(overlap_save_t* ols,
+                        float* audio_buffer,
+                        size_t frames,
+                        int channel);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes overlap_save_init needs for a filter of filter_length taps,
+// its FFT plan and its buffers.
+//
+// Arguments:
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels to process
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t overlap_save_size(size_t filter_length, int channels)
+{
+    const size_t size = overlap_save_step_for(filter_length) + filter_length - 1;
+
+    return workspace_round(sizeof(overlap_save_t)) + fft_plan_size(size) +
+           4 * workspace_round(size * sizeof(float)) +
+           workspace_round(((filter_length - 1) * (size_t)channels + 1) *
+                           sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Builds an overlap_save_t object in memory and transforms the impulse
+// response. The FFT size is the smallest power of two of at least twice the
+// filter length, so each frame yields at least filter_length new outputs.
+//
+// Arguments:
+//     memory        - overlap_save_size bytes of zeroed memory
+//     coeffs        - impulse response
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels to process
+//
+// Returns:
+//     pointer to the object, at the start of memory
+// -----------------------------------------------------------------------------
+overlap_save_t* overlap_save_init(void* memory,
+                                  const float* coeffs,
+                                  size_t filter_length,
+                                  int channels)
+{
+    const size_t step = overlap_save_step_for(filter_length);
+    const size_t size = step + filter_length - 1;
+    const size_t frame_bytes = size * sizeof(float);
+
+    unsigned char* cursor = (unsigned char*)memory;
+    overlap_save_t* ols =
+        (overlap_save_t*)workspace_carve(&cursor, sizeof(overlap_save_t));
+
+    ols->plan = fft_init(workspace_carve(&cursor, fft_plan_size(size)), size);
+    ols->filter_length = filter_length;
+    ols->step = step;
+    ols->channel_count = channels;
+    ols->response_real = (float*)workspace_carve(&cursor, frame_bytes);
+    ols->response_imag = (float*)workspace_carve(&cursor, frame_bytes);
+    ols->history = (float*)workspace_carve(
+        &cursor,
+        ((filter_length - 1) * (size_t)channels + 1) * sizeof(float));
+    ols->frame_real = (float*)workspace_carve(&cursor, frame_bytes);
+    ols->frame_imag = (float*)workspace_carve(&cursor, frame_bytes);
+
+    // the inverse transform is unscaled, so fold 1 / size into the response
+    for (size_t i = 0; i < filter_length; ++i)
+        ols->response_real[i] = coeffs[i] / (float)size;
+
+    fft_forward(ols->plan, ols->response_real, ols->response_imag);
+
+    return ols;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved frames in place. Output is aligned with the
+// direct form filter, so the buffer may be any length.
+//
+// Arguments:
+//     ols          - pointer to overlap-save data
+//     audio_buffer - buffer of interleaved samples
+//     frames       - number of frames in buffer
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void overlap_save_process(overlap_save_t* ols,
+                          float* audio_buffer,
+                          size_t frames)
+{
+    size_t offset = 0;
+    while (offset < frames)
+    {
+        size_t chunk = frames - offset;
+        if (chunk > ols->step)
+            chunk = ols->step;
+
+        float* chunk_start = audio_buffer + offset * ols->channel_count;
+        for (int c = 0; c < ols->channel_count; c += 2)
+            overlap_save_chunk(ols, chunk_start, chunk, c);
+
+        offset += chunk;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Convolves up to step frames of one channel pair, starting at channel. The
+// imaginary part is left silent when channel is the last of an odd count.
+// -----------------------------------------------------------------------------
+void overlap_save_chunk(overlap_save_t* ols,
+                        float* audio_buffer,
+                        size_t frames,
+                        int channel)
+{
+    const size_t size = fft_size(ols->plan);
+    const size_t overlap = ols->filter_length - 1;
+    const int stride = ols->channel_count;
+    const int paired = channel + 1 < ols->channel_count;
+
+    float* real = ols->frame_real;
+    float* imag = ols->frame_imag;
+    float* history_real = ols->history + overlap * channel;
+    float* history_imag = history_real + overlap;
+
+    memcpy(real, history_real, overlap * sizeof(float));
+    if (paired)
+        memcpy(imag, history_imag, overlap * sizeof(float));
+    else
+        memset(imag, 0, overlap * sizeof(float));
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        real[overlap + i] = audio_buffer[i * stride + channel];
+        imag[overlap + i] = paired ? audio_buffer[i * stride + channel + 1] : 0;
+    }
+
+    for (size_t i = overlap + frames; i < size; ++i)
+    {
+        real[i] = 0.0f;
+        imag[i] = 0.0f;
+    }
+
+    // history for the next chunk is the newest overlap samples of this frame
+    memcpy(history_real, real + frames, overlap * sizeof(float));
+    if (paired)
+        memcpy(history_imag, imag + frames, overlap * sizeof(float));
+
+    fft_forward(ols->plan, real, imag);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const float re = real[i] * ols->response_real[i] -
+                         imag[i] * ols->response_imag[i];
+        const float im = real[i] * ols->response_imag[i] +
+                         imag[i] * ols->response_real[i];
+        real[i] = re;
+        imag[i] = im;
+    }
+
+    fft_inverse(ols->plan, real, imag);
+
+    for (size_t i = 0; i < frames; ++i)
+    {
+        audio_buffer[i * stride + channel] = real[overlap + i];
+        if (paired)
+            audio_buffer[i * stride + channel + 1] = imag[overlap + i];
+    }
+}
+
+size_t overlap_save_step(const overlap_save_t* ols) { return ols->step; }
+
+// -----------------------------------------------------------------------------
+// Gets the step of an overlap_save_t for a filter of filter_length taps
+// without creating one, for sizing buffers in advance.
+// -----------------------------------------------------------------------------
+size_t overlap_save_step_for(size_t filter_length)
+{
+    size_t size = 2;
+    while (size < 2 * filter_length) size *= 2;
+
+    return size - (filter_length - 1);
+}
+
+// -----------------------------------------------------------------------------
+// Clears the history so the next buffer is filtered as if preceded by silence.
+//
+// Arguments:
+//     ols - pointer to overlap-save data
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void overlap_save_reset(overlap_save_t* ols)
+{
+    memset(ols->history,
+           0,
+           (ols->filter_length - 1) * (size_t)ols->channel_count *
+               sizeof(float));
+}
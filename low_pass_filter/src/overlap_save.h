@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct overlap_save overlap_save_t;
+
+size_t overlap_save_size(size_t filter_length, int channels);
+
+overlap_save_t* overlap_save_init(void* memory,
+                                  const float* coeffs,
+                                  size_t filter_length,
+                                  int channels);
+
+void overlap_save_process(overlap_save_t* ols,
+                          float* audio_buffer,
+                          size_t frames);
+
+size_t overlap_save_step(const overlap_save_t* ols);
+
+size_t overlap_save_step_for(size_t filter_length);
+
+void overlap_save_reset(overlap_save_t* ols);
@@ -0,0 +1,271 @@
+
+#include "parallel_filter.h"
+
+#include <stdlib.h>
+
+#include "workspace.h"
+
+// -----------------------------------------------------------------------------
+// Work for one task: a run of units of a chunk, where unit u is frame
+// u % frames of channel u / frames. A run covers the end of one channel, any
+// whole channels after it and the start of the next.
+// -----------------------------------------------------------------------------
+typedef struct filter_job
+{
+    const struct parallel_filter* pf;
+    const float* input;
+    float* output;
+    size_t frames;
+    size_t first_unit;
+    size_t end_unit;
+    float* line;
+    float* sums;
+} filter_job_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing data needed to filter chunks of interleaved audio on
+// several threads.
+//
+// Filtering is stateless per chunk: the caller keeps filter_length - 1 frames
+// of previous input in front of each chunk, so any channel or time range can
+// be computed independently and the result is identical to a serial run in
+// planar mode, which filters tap-major with the same block kernels.
+//
+// Each chunk is cut into one run of units per thread of the pool, every run
+// the same length to within a unit, so threads get equal work whatever the
+// channel count: 3 channels on 2 threads are a channel and a half each, and 33
+// channels on 32 threads a channel and 1/32 each. Cutting a channel only costs
+// copying filter_length - 1 frames of its history once more. Chunks are long
+// enough that each thread has about segment_frames units of work, so the
+// signalling of the pool is small beside it.
+// -----------------------------------------------------------------------------
+typedef struct parallel_filter
+{
+    const float* coeffs;
+    int filter_length;
+    block_dot_product_fn block_dot_product;
+    block_folded_dot_product_fn block_folded_dot_product;
+    int channel_count;
+    int job_count;
+    size_t chunk_frames;
+    thread_pool_t* pool;
+    filter_job_t* jobs;
+    float* lines;
+} parallel_filter_t;
+
+void filter_job_run(void* arg);
+size_t run_frames_of(size_t chunk_frames, int channels, int job_count);
+
+// -----------------------------------------------------------------------------
+// Gets the chunk length a parallel filter uses: about segment_frames units of
+// work per thread, never shorter than segment_frames, so that a channel is not
+// cut into runs barely longer than the history copied for each.
+//
+// Arguments:
+//     channels       - number of interleaved channels
+//     job_count      - threads of the pool
+//     segment_frames - units of work each thread filters per chunk
+//
+// Returns:
+//     frames per chunk
+// -----------------------------------------------------------------------------
+size_t parallel_chunk_frames(int channels,
+                             int job_count,
+                             size_t segment_frames)
+{
+    const size_t chunk_frames =
+        (segment_frames * job_count + channels - 1) / channels;
+
+    return chunk_frames < segment_frames ? segment_frames : chunk_frames;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the longest piece of one channel a run of a chunk can hold.
+// -----------------------------------------------------------------------------
+size_t run_frames_of(size_t chunk_frames, int channels, int job_count)
+{
+    const size_t run_frames =
+        (chunk_frames * channels + job_count - 1) / job_count;
+
+    return run_frames < chunk_frames ? run_frames : chunk_frames;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the bytes parallel_filter_init needs for a filter, its jobs and a
+// history line and output buffer per thread.
+//
+// Arguments:
+//     filter_length  - number of coefficients
+//     channels       - number of interleaved channels
+//     job_count      - threads of the pool
+//     segment_frames - units of work each thread filters per chunk
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t parallel_filter_size(int filter_length,
+                            int channels,
+                            int job_count,
+                            size_t segment_frames)
+{
+    const size_t run_frames = run_frames_of(
+        parallel_chunk_frames(channels, job_count, segment_frames),
+        channels,
+        job_count);
+    const size_t line_length = 2 * run_frames + filter_length - 1;
+
+    return workspace_round(sizeof(parallel_filter_t)) +
+           workspace_round(job_count * sizeof(filter_job_t)) +
+           workspace_round(line_length * job_count * sizeof(float));
+}
+
+// -----------------------------------------------------------------------------
+// Builds a parallel_filter_t object in memory, with a history line and output
+// buffer per thread of the pool.
+//
+// Arguments:
+//     memory         - parallel_filter_size bytes of zeroed memory
+//     coeffs         - filter coefficients, must outlive the object
+//     filter_length  - number of coefficients
+//     kernel         - block kernel
+//     folded         - folded block kernel for symmetric coefficients, or
+//                      NULL
+//     channels       - number of interleaved channels
+//     pool           - threads to filter on, must outlive the object
+//     segment_frames - units of work each thread filters per chunk
+//
+// Returns:
+//     pointer to the object, at the start of memory
+// -----------------------------------------------------------------------------
+parallel_filter_t* parallel_filter_init(void* memory,
+                                        const float* coeffs,
+                                        int filter_length,
+                                        block_dot_product_fn kernel,
+                                        block_folded_dot_product_fn folded,
+                                        int channels,
+                                        thread_pool_t* pool,
+                                        size_t segment_frames)
+{
+    const int job_count = thread_pool_size(pool);
+
+    unsigned char* cursor = (unsigned char*)memory;
+    parallel_filter_t* pf =
+        (parallel_filter_t*)workspace_carve(&cursor, sizeof(parallel_filter_t));
+
+    pf->coeffs = coeffs;
+    pf->filter_length = filter_length;
+    pf->block_dot_product = kernel;
+    pf->block_folded_dot_product = folded;
+    pf->channel_count = channels;
+    pf->job_count = job_count;
+    pf->pool = pool;
+    pf->chunk_frames =
+        parallel_chunk_frames(channels, job_count, segment_frames);
+
+    const size_t run_frames =
+        run_frames_of(pf->chunk_frames, channels, job_count);
+    const size_t history_length = run_frames + filter_length - 1;
+    const size_t line_length = history_length + run_frames;
+    pf->jobs = (filter_job_t*)workspace_carve(
+        &cursor, job_count * sizeof(filter_job_t));
+    pf->lines = (float*)workspace_carve(
+        &cursor, line_length * job_count * sizeof(float));
+
+    for (int t = 0; t < job_count; ++t)
+    {
+        pf->jobs[t].pf = pf;
+        pf->jobs[t].line = pf->lines + line_length * t;
+        pf->jobs[t].sums = pf->jobs[t].line + history_length;
+    }
+
+    return pf;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the largest chunk parallel_filter_process accepts.
+// -----------------------------------------------------------------------------
+size_t parallel_filter_chunk_frames(const parallel_filter_t* pf)
+{
+    return pf->chunk_frames;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a chunk of interleaved frames, cut into equal runs of channel frames
+// for the threads of the pool, of which the calling thread is one.
+//
+// Arguments:
+//     pf     - pointer to parallel filter data
+//     input  - first frame of the chunk, preceded by filter_length - 1 frames
+//              of history
+//     output - buffer of at least frames interleaved frames
+//     frames - chunk length, at most parallel_filter_chunk_frames
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void parallel_filter_process(parallel_filter_t* pf,
+                             const float* input,
+                             float* output,
+                             size_t frames)
+{
+    const size_t units = frames * pf->channel_count;
+
+    for (int t = 0; t < pf->job_count; ++t)
+    {
+        filter_job_t* job = &pf->jobs[t];
+        job->input = input;
+        job->output = output;
+        job->frames = frames;
+        job->first_unit = units * t / pf->job_count;
+        job->end_unit = units * (t + 1) / pf->job_count;
+    }
+
+    thread_pool_run(pf->pool,
+                    filter_job_run,
+                    pf->jobs,
+                    sizeof(filter_job_t),
+                    pf->job_count);
+}
+
+// -----------------------------------------------------------------------------
+// Filters the units of one job, a piece of one channel at a time. Each piece
+// is copied newest first into the job's line, along with the filter_length - 1
+// frames before it, and filtered tap-major by fir_filter_line as in the serial
+// path.
+// -----------------------------------------------------------------------------
+void filter_job_run(void* arg)
+{
+    filter_job_t* job = (filter_job_t*)arg;
+    const parallel_filter_t* pf = job->pf;
+    const int channels = pf->channel_count;
+    const int history = pf->filter_length - 1;
+    const size_t frames = job->frames;
+
+    for (size_t unit = job->first_unit; unit < job->end_unit;)
+    {
+        const size_t c = unit / frames;
+        const size_t first_frame = unit % frames;
+        size_t end_frame = frames;
+        if (c * frames + end_frame > job->end_unit)
+            end_frame = job->end_unit - c * frames;
+
+        const size_t count = end_frame - first_frame;
+        const float* newest = job->input + (end_frame - 1) * channels + c;
+
+        for (size_t k = 0; k < count + history; ++k)
+            job->line[k] = newest[-(ptrdiff_t)(k * channels)];
+
+        fir_filter_line(pf->block_dot_product,
+                        pf->block_folded_dot_product,
+                        pf->coeffs,
+                        pf->filter_length,
+                        job->line + count - 1,
+                        job->sums,
+                        count);
+
+        for (size_t i = 0; i < count; ++i)
+            job->output[(first_frame + i) * channels + c] = job->sums[i];
+
+        unit = c * frames + end_frame;
+    }
+}
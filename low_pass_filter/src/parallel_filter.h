@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "fir_kernels.h"
+#include "thread.h"
+
+typedef struct parallel_filter parallel_filter_t;
+
+size_t parallel_chunk_frames(int channels,
+                             int job_count,
+                             size_t segment_frames);
+
+size_t parallel_filter_size(int filter_length,
+                            int channels,
+                            int job_count,
+                            size_t segment_frames);
+
+parallel_filter_t* parallel_filter_init(void* memory,
+                                        const float* coeffs,
+                                        int filter_length,
+                                        block_dot_product_fn kernel,
+                                        block_folded_dot_product_fn folded,
+                                        int channels,
+                                        thread_pool_t* pool,
+                                        size_t segment_frames);
+
+size_t parallel_filter_chunk_frames(const parallel_filter_t* pf);
+
+void parallel_filter_process(parallel_filter_t* pf,
+                             const float* input,
+                             float* output,
+                             size_t frames);
@@ -0,0 +1,226 @@
+
+#include "pipeline.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "thread.h"
+
+// -----------------------------------------------------------------------------
+// One slot of the ring. frames counts frames read and output_frames those left
+// to write after filtering. frames of zero marks the end of the stream.
+// -----------------------------------------------------------------------------
+typedef struct pipeline_block
+{
+    float* samples;
+    sf_count_t frames;
+    sf_count_t output_frames;
+} pipeline_block_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing data shared by the reader, filter and writer stages.
+//
+// Blocks travel round the ring in order, reader to filter to writer and back
+// to the reader, and are only ever touched by the stage that owns them. Each
+// stage waits on the semaphore counting the blocks handed to it, so buffers
+// are passed by index and never copied.
+// -----------------------------------------------------------------------------
+typedef struct pipeline
+{
+    SNDFILE* input_wav;
+    SNDFILE* output_wav;
+    size_t block_frames;
+    int block_count;
+    sf_count_t frames_to_process;
+    sf_count_t frames_written;
+    bool write_failed;
+    pipeline_block_t* blocks;
+    float* samples;
+    semaphore_t* empty_blocks;
+    semaphore_t* read_blocks;
+    semaphore_t* filtered_blocks;
+} pipeline_t;
+
+void pipeline_read(void* arg);
+void pipeline_write(void* arg);
+
+// -----------------------------------------------------------------------------
+// Reads, filters and writes a file with each stage on its own thread, so disk
+// I/O overlaps filtering. The reader and writer run on new threads and the
+// filter runs on the calling thread.
+//
+// Arguments:
+//     input_wav         - file to read from
+//     output_wav        - file to write to
+//     channels          - number of interleaved channels
+//     block_frames      - frames per block
+//     block_count       - number of blocks in the ring, at least 2
+//     frames_to_process - number of frames in input_wav
+//     filter            - function that filters a block in place and returns
+//                         the number of frames to write
+//     context           - first argument to filter
+//     frames_processed  - receives the number of frames written
+//
+// Returns:
+//     PIPELINE_OK on success
+// -----------------------------------------------------------------------------
+enum pipeline_status pipeline_run(SNDFILE* input_wav,
+                                  SNDFILE* output_wav,
+                                  int channels,
+                                  size_t block_frames,
+                                  int block_count,
+                                  sf_count_t frames_to_process,
+                                  pipeline_filter_fn filter,
+                                  void* context,
+                                  sf_count_t* frames_processed)
+{
+    if (block_count < 2)
+        block_count = 2;
+
+    pipeline_t pipeline = { 0 };
+    pipeline.input_wav = input_wav;
+    pipeline.output_wav = output_wav;
+    pipeline.block_frames = block_frames;
+    pipeline.block_count = block_count;
+    pipeline.frames_to_process = frames_to_process;
+    pipeline.blocks =
+        (pipeline_block_t*)calloc(block_count, sizeof(pipeline_block_t));
+    pipeline.samples = (float*)calloc(
+        block_frames * (size_t)channels * block_count, sizeof(float));
+    pipeline.empty_blocks = semaphore_create(block_count);
+    pipeline.read_blocks = semaphore_create(0);
+    pipeline.filtered_blocks = semaphore_create(0);
+
+    enum pipeline_status status = PIPELINE_INIT_ERROR;
+    thread_t* reader = NULL;
+    thread_t* writer = NULL;
+
+    if (pipeline.blocks && pipeline.samples && pipeline.empty_blocks &&
+        pipeline.read_blocks && pipeline.filtered_blocks)
+    {
+        for (int i = 0; i < block_count; ++i)
+        {
+            pipeline.blocks[i].samples =
+                pipeline.samples + block_frames * (size_t)channels * i;
+        }
+
+        reader = thread_start(pipeline_read, &pipeline);
+        writer = reader ? thread_start(pipeline_write, &pipeline) : NULL;
+    }
+
+    if (writer)
+    {
+        for (int i = 0;; i = (i + 1) % block_count)
+        {
+            semaphore_wait(pipeline.read_blocks);
+
+            // the block belongs to the writer once posted, so read its length
+            // first
+            pipeline_block_t* block = &pipeline.blocks[i];
+            const sf_count_t frames = block->frames;
+            if (frames > 0)
+                block->output_frames = filter(context, block->samples, frames);
+
+            semaphore_post(pipeline.filtered_blocks);
+
+            if (frames == 0)
+                break;
+        }
+
+        thread_join(reader);
+        thread_join(writer);
+
+        status = pipeline.write_failed ? PIPELINE_WRITE_ERROR : PIPELINE_OK;
+    }
+    else if (reader)
+    {
+        // the reader stops at the first block it cannot hand on, so feed it
+        // an end of stream by draining what it reads
+        for (int i = 0;; i = (i + 1) % block_count)
+        {
+            semaphore_wait(pipeline.read_blocks);
+            const sf_count_t frames = pipeline.blocks[i].frames;
+            semaphore_post(pipeline.empty_blocks);
+            if (frames == 0)
+                break;
+        }
+        thread_join(reader);
+    }
+
+    *frames_processed = pipeline.frames_written;
+
+    semaphore_destroy(pipeline.empty_blocks);
+    semaphore_destroy(pipeline.read_blocks);
+    semaphore_destroy(pipeline.filtered_blocks);
+    free(pipeline.samples);
+    free(pipeline.blocks);
+
+    return status;
+}
+
+// -----------------------------------------------------------------------------
+// Reader stage. Fills empty blocks until the input is exhausted, then hands on
+// an empty block to mark the end of the stream.
+// -----------------------------------------------------------------------------
+void pipeline_read(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*)arg;
+    sf_count_t frames_remaining = pipeline->frames_to_process;
+
+    for (int i = 0;; i = (i + 1) % pipeline->block_count)
+    {
+        semaphore_wait(pipeline->empty_blocks);
+
+        pipeline_block_t* block = &pipeline->blocks[i];
+        sf_count_t frames = 0;
+
+        if (frames_remaining > 0)
+        {
+            frames = sf_readf_float(pipeline->input_wav,
+                                    block->samples,
+                                    (sf_count_t)pipeline->block_frames);
+            if (frames < 0)
+                frames = 0;
+        }
+
+        frames_remaining -= frames;
+        block->frames = frames;
+
+        semaphore_post(pipeline->read_blocks);
+
+        if (frames == 0)
+            break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Writer stage. Writes filtered blocks and returns them to the reader. After a
+// failed write it keeps consuming blocks, without writing, until the end of
+// the stream so the other stages are not left waiting.
+// -----------------------------------------------------------------------------
+void pipeline_write(void* arg)
+{
+    pipeline_t* pipeline = (pipeline_t*)arg;
+
+    for (int i = 0;; i = (i + 1) % pipeline->block_count)
+    {
+        semaphore_wait(pipeline->filtered_blocks);
+
+        pipeline_block_t* block = &pipeline->blocks[i];
+        if (block->frames == 0)
+            break;
+
+        if (!pipeline->write_failed)
+        {
+            const sf_count_t frames_written = sf_writef_float(
+                pipeline->output_wav, block->samples, block->output_frames);
+
+            if (frames_written != block->output_frames)
+                pipeline->write_failed = true;
+
+            pipeline->frames_written += frames_written;
+        }
+
+        semaphore_post(pipeline->empty_blocks);
+    }
+}
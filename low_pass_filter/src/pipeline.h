@@ -0,0 +1,27 @@
+#pragma once
+
+#include <sndfile.h>
+#include <stddef.h>
+
+// Filters a block of interleaved frames in place, returning how many frames
+// from the start of the block are to be written.
+typedef sf_count_t (*pipeline_filter_fn)(void* context,
+                                         float* audio_buffer,
+                                         sf_count_t frames);
+
+enum pipeline_status
+{
+    PIPELINE_OK,
+    PIPELINE_INIT_ERROR,
+    PIPELINE_WRITE_ERROR,
+};
+
+enum pipeline_status pipeline_run(SNDFILE* input_wav,
+                                  SNDFILE* output_wav,
+                                  int channels,
+                                  size_t block_frames,
+                                  int block_count,
+                                  sf_count_t frames_to_process,
+                                  pipeline_filter_fn filter,
+                                  void* context,
+                                  sf_count_t* frames_processed);
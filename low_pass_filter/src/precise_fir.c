@@ -0,0 +1,249 @@
+#include "precise_fir.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fir_kernels.h"
+#include "workspace.h"
+
+// -----------------------------------------------------------------------------
+// Struct containing an FIR filter that keeps more precision than the float
+// path, for long filters whose float sums lose bits.
+//
+// Samples come and go as doubles. In the float storage modes each line and
+// the coefficients are floats, as in the float path, and only the sum is
+// carried further: in double, where each product of two floats is exact, or
+// in float with Kahan compensation. In double mode the coefficients are
+// designed in double and the lines hold the samples as read.
+//
+// Each channel has a line holding filter_length - 1 samples of history then
+// a block of input, oldest first, and the coefficients are stored reversed,
+// so every output is a forward dot product from its oldest tap.
+// -----------------------------------------------------------------------------
+typedef struct precise_fir
+{
+    int filter_length;
+    int channel_count;
+    enum precise_fir_mode mode;
+    size_t block_frames;
+    size_t line_length;
+    float* coeffs;
+    double* coeffs_double;
+    void* lines;
+    dot_product_wide_fn dot_product_wide;
+    dot_product_fn dot_product_compensated;
+    dot_product_double_fn dot_product_double;
+} precise_fir_t;
+
+void process_float_lines(precise_fir_t* fir,
+                         double* audio_buffer,
+                         size_t frames);
+
+void process_double_lines(precise_fir_t* fir,
+                          double* audio_buffer,
+                          size_t frames);
+
+// -----------------------------------------------------------------------------
+// Gets the bytes precise_fir_init needs for a filter, its coefficients and its
+// history.
+//
+// Arguments:
+//     filter_length - number of coefficients
+//     channels      - number of interleaved channels
+//     mode          - how samples are stored and summed
+//     block_frames  - most frames passed to one precise_fir_process call
+//
+// Returns:
+//     size in bytes
+// -----------------------------------------------------------------------------
+size_t precise_fir_size(int filter_length,
+                        int channels,
+                        enum precise_fir_mode mode,
+                        size_t block_frames)
+{
+    const size_t sample_size =
+        mode == PRECISE_FIR_DOUBLE ? sizeof(double) : sizeof(float);
+    const size_t line_length = (size_t)filter_length - 1 + block_frames;
+
+    return workspace_round(sizeof(precise_fir_t)) +
+           workspace_round((size_t)filter_length * sample_size) +
+           workspace_round(line_length * channels * sample_size);
+}
+
+// -----------------------------------------------------------------------------
+// Builds a precise_fir_t object in memory and designs its coefficients, in
+// double for double mode and as the float path designs them otherwise.
+//
+// Arguments:
+//     memory       - precise_fir_size bytes of zeroed memory
+//     design       - cutoff, sample rate, order, window and phase of the filter
+//     channels     - number of interleaved channels
+//     mode         - how samples are stored and summed
+//     block_frames - most frames passed to one precise_fir_process call
+//     level        - instruction set of the tap kernel
+//
+// Returns:
+//     pointer to the object, at the start of memory, or NULL if the filter
+//     could not be designed
+// -----------------------------------------------------------------------------
+precise_fir_t* precise_fir_init(void* memory,
+                                const filter_design_t* design,
+                                int channels,
+                                enum precise_fir_mode mode,
+                                size_t block_frames,
+                                enum simd_level level)
+{
+    const int length = design->order + 1;
+    const bool is_double = mode == PRECISE_FIR_DOUBLE;
+    const size_t sample_size = is_double ? sizeof(double) : sizeof(float);
+
+    unsigned char* cursor = (unsigned char*)memory;
+    precise_fir_t* fir =
+        (precise_fir_t*)workspace_carve(&cursor, sizeof(precise_fir_t));
+
+    fir->filter_length = length;
+    fir->channel_count = channels;
+    fir->mode = mode;
+    fir->block_frames = block_frames;
+    fir->line_length = (size_t)length - 1 + block_frames;
+    fir->dot_product_wide = fir_dot_product_wide_kernel(level);
+    fir->dot_product_compensated = fir_dot_product_compensated_kernel(level);
+    fir->dot_product_double = fir_dot_product_double_kernel(level);
+
+    void* coeffs = workspace_carve(&cursor, (size_t)length * sample_size);
+    fir->lines =
+        workspace_carve(&cursor, fir->line_length * channels * sample_size);
+
+    // designed in order, then reversed in place
+    if (is_double)
+    {
+        fir->coeffs_double = (double*)coeffs;
+        if (!design_low_pass_double(fir->coeffs_double, design))
+            return NULL;
+
+        for (int j = 0; j < length / 2; ++j)
+        {
+            const double tap = fir->coeffs_double[j];
+            fir->coeffs_double[j] = fir->coeffs_double[length - 1 - j];
+            fir->coeffs_double[length - 1 - j] = tap;
+        }
+    }
+    else
+    {
+        fir->coeffs = (float*)coeffs;
+        if (!design_low_pass(fir->coeffs, design))
+            return NULL;
+
+        for (int j = 0; j < length / 2; ++j)
+        {
+            const float tap = fir->coeffs[j];
+            fir->coeffs[j] = fir->coeffs[length - 1 - j];
+            fir->coeffs[length - 1 - j] = tap;
+        }
+    }
+
+    return fir;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a buffer of interleaved samples in place, continuing from the
+// previous call.
+//
+// Arguments:
+//     fir          - pointer to precise filter data
+//     audio_buffer - buffer of interleaved samples
+//     frames       - length of buffer
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void precise_fir_process(precise_fir_t* fir,
+                         double* audio_buffer,
+                         size_t frames)
+{
+    const int channels = fir->channel_count;
+
+    for (size_t done = 0; done < frames; done += fir->block_frames)
+    {
+        const size_t block = frames - done < fir->block_frames
+                                 ? frames - done
+                                 : fir->block_frames;
+
+        if (fir->mode == PRECISE_FIR_DOUBLE)
+            process_double_lines(fir, audio_buffer + done * channels, block);
+        else
+            process_float_lines(fir, audio_buffer + done * channels, block);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Clears the history, as though the next sample were the first.
+// -----------------------------------------------------------------------------
+void precise_fir_reset(precise_fir_t* fir)
+{
+    const size_t sample_size =
+        fir->mode == PRECISE_FIR_DOUBLE ? sizeof(double) : sizeof(float);
+    memset(fir->lines, 0, fir->line_length * fir->channel_count * sample_size);
+}
+
+// -----------------------------------------------------------------------------
+// Filters up to block_frames frames with float lines, one channel at a time,
+// summing in double or with compensation by mode.
+// -----------------------------------------------------------------------------
+void process_float_lines(precise_fir_t* fir,
+                         double* audio_buffer,
+                         size_t frames)
+{
+    const int channels = fir->channel_count;
+    const int length = fir->filter_length;
+    const size_t history = (size_t)length - 1;
+    const bool compensated = fir->mode == PRECISE_FIR_COMPENSATED;
+
+    for (int c = 0; c < channels; ++c)
+    {
+        float* line = (float*)fir->lines + c * fir->line_length;
+
+        for (size_t n = 0; n < frames; ++n)
+            line[history + n] = (float)audio_buffer[n * channels + c];
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            const float* window = line + n;
+            audio_buffer[n * channels + c] =
+                compensated
+                    ? fir->dot_product_compensated(fir->coeffs, window, length)
+                    : fir->dot_product_wide(fir->coeffs, window, length);
+        }
+
+        memmove(line, line + frames, history * sizeof(float));
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Filters up to block_frames frames with double lines, one channel at a time.
+// -----------------------------------------------------------------------------
+void process_double_lines(precise_fir_t* fir,
+                          double* audio_buffer,
+                          size_t frames)
+{
+    const int channels = fir->channel_count;
+    const int length = fir->filter_length;
+    const size_t history = (size_t)length - 1;
+
+    for (int c = 0; c < channels; ++c)
+    {
+        double* line = (double*)fir->lines + c * fir->line_length;
+
+        for (size_t n = 0; n < frames; ++n)
+            line[history + n] = audio_buffer[n * channels + c];
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            audio_buffer[n * channels + c] =
+                fir->dot_product_double(fir->coeffs_double, line + n, length);
+        }
+
+        memmove(line, line + frames, history * sizeof(double));
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "cpu_features.h"
+#include "filter_design.h"
+
+// How a precise_fir_t stores and sums: float samples and coefficients summed in
+// double, the same summed in float with Kahan compensation, or double
+// throughout.
+enum precise_fir_mode
+{
+    PRECISE_FIR_DOUBLE_SUM,
+    PRECISE_FIR_COMPENSATED,
+    PRECISE_FIR_DOUBLE,
+};
+
+typedef struct precise_fir precise_fir_t;
+
+size_t precise_fir_size(int filter_length,
+                        int channels,
+                        enum precise_fir_mode mode,
+                        size_t block_frames);
+
+precise_fir_t* precise_fir_init(void* memory,
+                                const filter_design_t* design,
+                                int channels,
+                                enum precise_fir_mode mode,
+                                size_t block_frames,
+                                enum simd_level level);
+
+void precise_fir_process(precise_fir_t* fir,
+                         double* audio_buffer,
+                         size_t frames);
+
+void precise_fir_reset(precise_fir_t* fir);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "low_pass_filter.h"
+
+uint64_t stats_clock_ns(void);
+
+size_t stats_peak_memory(void);
+
+void stats_add_block(lpf_stats_t* stats, uint64_t nanoseconds);
@@ -0,0 +1,505 @@
+
+#include "thread.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Struct wrapping a native thread handle and the function it runs.
+// -----------------------------------------------------------------------------
+typedef struct thread
+{
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    thread_function function;
+    void* arg;
+} thread_t;
+
+// -----------------------------------------------------------------------------
+// Struct wrapping a counting semaphore. POSIX unnamed semaphores are not
+// available everywhere, so outside Windows it is built from a mutex and a
+// condition variable.
+// -----------------------------------------------------------------------------
+typedef struct semaphore
+{
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    int count;
+#endif
+} semaphore_t;
+
+// -----------------------------------------------------------------------------
+// Struct wrapping a native mutex.
+// -----------------------------------------------------------------------------
+typedef struct mutex
+{
+#ifdef _WIN32
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t handle;
+#endif
+} mutex_t;
+
+// -----------------------------------------------------------------------------
+// Struct containing threads that wait to be handed tasks, so that work can be
+// split between them again and again without starting a thread each time.
+//
+// thread_pool_run sets the function and its arguments and posts work once for
+// each worker it wants, then takes tasks itself. Workers take tasks, under the
+// mutex, until none are left, then post done, and the caller waits for one
+// done per worker woken, so no worker is still running when it returns.
+// -----------------------------------------------------------------------------
+typedef struct thread_pool
+{
+    int worker_count;
+    thread_t** workers;
+    semaphore_t* work;
+    semaphore_t* done;
+    mutex_t* mutex;
+    thread_function function;
+    unsigned char* args;
+    size_t arg_size;
+    int task_count;
+    int next_task;
+    bool stopping;
+} thread_pool_t;
+
+// Lock for process-wide state, initialised statically so that it needs no
+// creating before its first use.
+#ifdef _WIN32
+static SRWLOCK global_mutex = SRWLOCK_INIT;
+#else
+static pthread_mutex_t global_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void thread_pool_worker(void* arg);
+void thread_pool_take_tasks(thread_pool_t* pool);
+
+#ifdef _WIN32
+DWORD WINAPI thread_entry(LPVOID param)
+{
+    thread_t* thread = (thread_t*)param;
+    thread->function(thread->arg);
+    return 0;
+}
+#else
+void* thread_entry(void* param)
+{
+    thread_t* thread = (thread_t*)param;
+    thread->function(thread->arg);
+    return NULL;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Starts a thread running function(arg).
+//
+// Arguments:
+//     function - function to run
+//     arg      - argument passed to function
+//
+// Returns:
+//     pointer to new thread_t object, or NULL if the thread could not start
+// -----------------------------------------------------------------------------
+thread_t* thread_start(thread_function function, void* arg)
+{
+    thread_t* thread = (thread_t*)malloc(sizeof(thread_t));
+    if (!thread)
+        return NULL;
+
+    thread->function = function;
+    thread->arg = arg;
+
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+    if (thread->handle == NULL)
+#else
+    if (pthread_create(&thread->handle, NULL, thread_entry, thread))
+#endif
+    {
+        free(thread);
+        return NULL;
+    }
+
+    return thread;
+}
+
+// -----------------------------------------------------------------------------
+// Waits for a thread to finish and deallocates it.
+//
+// Arguments:
+//     thread - thread_t to join
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void thread_join(thread_t* thread)
+{
+    if (!thread)
+        return;
+
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+
+    free(thread);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of hardware threads available to the process.
+//
+// Returns:
+//     number of logical processors, at least 1
+// -----------------------------------------------------------------------------
+int thread_hardware_concurrency(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long count = (long)info.dwNumberOfProcessors;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return count > 0 ? (int)count : 1;
+}
+
+// -----------------------------------------------------------------------------
+// Allocates a counting semaphore.
+//
+// Arguments:
+//     initial_count - number of waits that succeed without a post
+//
+// Returns:
+//     pointer to new semaphore_t object, or NULL on failure
+// -----------------------------------------------------------------------------
+semaphore_t* semaphore_create(int initial_count)
+{
+    semaphore_t* semaphore = (semaphore_t*)malloc(sizeof(semaphore_t));
+    if (!semaphore)
+        return NULL;
+
+#ifdef _WIN32
+    semaphore->handle = CreateSemaphore(NULL, initial_count, 0x7FFFFFFF, NULL);
+    if (semaphore->handle == NULL)
+    {
+        free(semaphore);
+        return NULL;
+    }
+#else
+    pthread_mutex_init(&semaphore->mutex, NULL);
+    pthread_cond_init(&semaphore->condition, NULL);
+    semaphore->count = initial_count;
+#endif
+
+    return semaphore;
+}
+
+// -----------------------------------------------------------------------------
+// Blocks until the count is positive, then decrements it.
+// -----------------------------------------------------------------------------
+void semaphore_wait(semaphore_t* semaphore)
+{
+#ifdef _WIN32
+    WaitForSingleObject(semaphore->handle, INFINITE);
+#else
+    pthread_mutex_lock(&semaphore->mutex);
+    while (semaphore->count == 0)
+        pthread_cond_wait(&semaphore->condition, &semaphore->mutex);
+    --semaphore->count;
+    pthread_mutex_unlock(&semaphore->mutex);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Increments the count, waking one waiting thread.
+// -----------------------------------------------------------------------------
+void semaphore_post(semaphore_t* semaphore)
+{
+#ifdef _WIN32
+    ReleaseSemaphore(semaphore->handle, 1, NULL);
+#else
+    pthread_mutex_lock(&semaphore->mutex);
+    ++semaphore->count;
+    pthread_cond_signal(&semaphore->condition);
+    pthread_mutex_unlock(&semaphore->mutex);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Deallocates a semaphore. No thread may be waiting on it.
+//
+// Arguments:
+//      semaphore - semaphore_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void semaphore_destroy(semaphore_t* semaphore)
+{
+    if (!semaphore)
+        return;
+
+#ifdef _WIN32
+    CloseHandle(semaphore->handle);
+#else
+    pthread_mutex_destroy(&semaphore->mutex);
+    pthread_cond_destroy(&semaphore->condition);
+#endif
+
+    free(semaphore);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates a mutex.
+//
+// Returns:
+//     pointer to new mutex_t object, or NULL on failure
+// -----------------------------------------------------------------------------
+mutex_t* mutex_create(void)
+{
+    mutex_t* mutex = (mutex_t*)malloc(sizeof(mutex_t));
+    if (!mutex)
+        return NULL;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&mutex->section);
+#else
+    pthread_mutex_init(&mutex->handle, NULL);
+#endif
+
+    return mutex;
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&mutex->section);
+#else
+    pthread_mutex_lock(&mutex->handle);
+#endif
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&mutex->section);
+#else
+    pthread_mutex_unlock(&mutex->handle);
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Deallocates a mutex. It must not be locked.
+//
+// Arguments:
+//      mutex - mutex_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void mutex_destroy(mutex_t* mutex)
+{
+    if (!mutex)
+        return;
+
+#ifdef _WIN32
+    DeleteCriticalSection(&mutex->section);
+#else
+    pthread_mutex_destroy(&mutex->handle);
+#endif
+
+    free(mutex);
+}
+
+// -----------------------------------------------------------------------------
+// Starts a pool of thread_count - 1 workers, the calling thread of
+// thread_pool_run making up the count. Workers that fail to start are left
+// out, so the pool may be smaller than asked for.
+//
+// Arguments:
+//     thread_count - number of threads tasks are run on, the caller included
+//
+// Returns:
+//     pointer to new thread_pool_t object, or NULL on failure
+// -----------------------------------------------------------------------------
+thread_pool_t* thread_pool_create(int thread_count)
+{
+    thread_pool_t* pool = (thread_pool_t*)calloc(1, sizeof(thread_pool_t));
+    if (!pool)
+        return NULL;
+
+    const int worker_count = thread_count > 1 ? thread_count - 1 : 0;
+    pool->workers = (thread_t**)calloc(
+        worker_count > 0 ? worker_count : 1, sizeof(thread_t*));
+    pool->work = semaphore_create(0);
+    pool->done = semaphore_create(0);
+    pool->mutex = mutex_create();
+
+    if (!pool->workers || !pool->work || !pool->done || !pool->mutex)
+    {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < worker_count; ++i)
+    {
+        thread_t* worker = thread_start(thread_pool_worker, pool);
+        if (worker)
+            pool->workers[pool->worker_count++] = worker;
+    }
+
+    return pool;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the number of threads a pool runs tasks on, the caller included.
+// -----------------------------------------------------------------------------
+int thread_pool_size(const thread_pool_t* pool)
+{
+    return pool->worker_count + 1;
+}
+
+// -----------------------------------------------------------------------------
+// Runs function on each of task_count arguments, spread over the pool and the
+// calling thread, and returns once every task has finished.
+//
+// Arguments:
+//     pool       - pool to run on
+//     function   - function to run
+//     args       - array of task_count arguments, each arg_size bytes
+//     arg_size   - size of each argument
+//     task_count - number of tasks
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void thread_pool_run(thread_pool_t* pool,
+                     thread_function function,
+                     void* args,
+                     size_t arg_size,
+                     int task_count)
+{
+    pool->function = function;
+    pool->args = (unsigned char*)args;
+    pool->arg_size = arg_size;
+    pool->task_count = task_count;
+    pool->next_task = 0;
+
+    // the calling thread takes a task too, so one fewer worker is needed
+    const int woken = task_count - 1 < pool->worker_count ? task_count - 1
+                                                          : pool->worker_count;
+
+    for (int i = 0; i < woken; ++i)
+        semaphore_post(pool->work);
+
+    thread_pool_take_tasks(pool);
+
+    for (int i = 0; i < woken; ++i)
+        semaphore_wait(pool->done);
+}
+
+// -----------------------------------------------------------------------------
+// Stops a pool's workers and deallocates it. No tasks may be running.
+//
+// Arguments:
+//      pool - thread_pool_t to deallocate
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void thread_pool_destroy(thread_pool_t* pool)
+{
+    if (!pool)
+        return;
+
+    pool->stopping = true;
+    for (int i = 0; i < pool->worker_count; ++i)
+        semaphore_post(pool->work);
+    for (int i = 0; i < pool->worker_count; ++i)
+        thread_join(pool->workers[i]);
+
+    semaphore_destroy(pool->work);
+    semaphore_destroy(pool->done);
+    mutex_destroy(pool->mutex);
+    free(pool->workers);
+    free(pool);
+}
+
+// -----------------------------------------------------------------------------
+// Pool worker. Waits for work, takes tasks until none are left and reports
+// done, until the pool stops.
+// -----------------------------------------------------------------------------
+void thread_pool_worker(void* arg)
+{
+    thread_pool_t* pool = (thread_pool_t*)arg;
+
+    for (;;)
+    {
+        semaphore_wait(pool->work);
+        if (pool->stopping)
+            break;
+
+        thread_pool_take_tasks(pool);
+        semaphore_post(pool->done);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Runs the pool's unclaimed tasks one at a time until none are left.
+// -----------------------------------------------------------------------------
+void thread_pool_take_tasks(thread_pool_t* pool)
+{
+    for (;;)
+    {
+        mutex_lock(pool->mutex);
+        const int task =
+            pool->next_task < pool->task_count ? pool->next_task++ : -1;
+        mutex_unlock(pool->mutex);
+
+        if (task < 0)
+            break;
+
+        pool->function(pool->args + (size_t)task * pool->arg_size);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Locks the process-wide mutex, which guards state shared by every filter in
+// the process. Unlike a mutex_t it is always there, so it is safe to take the
+// first time any thread gets to it.
+// -----------------------------------------------------------------------------
+void global_lock(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&global_mutex);
+#else
+    pthread_mutex_lock(&global_mutex);
+#endif
+}
+
+void global_unlock(void)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&global_mutex);
+#else
+    pthread_mutex_unlock(&global_mutex);
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+
+typedef struct thread thread_t;
+typedef struct semaphore semaphore_t;
+typedef struct mutex mutex_t;
+typedef struct thread_pool thread_pool_t;
+
+typedef void (*thread_function)(void* arg);
+
+thread_t* thread_start(thread_function function, void* arg);
+void thread_join(thread_t* thread);
+
+int thread_hardware_concurrency(void);
+
+semaphore_t* semaphore_create(int initial_count);
+void semaphore_wait(semaphore_t* semaphore);
+void semaphore_post(semaphore_t* semaphore);
+void semaphore_destroy(semaphore_t* semaphore);
+
+mutex_t* mutex_create(void);
+void mutex_lock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+void mutex_destroy(mutex_t* mutex);
+
+thread_pool_t* thread_pool_create(int thread_count);
+int thread_pool_size(const thread_pool_t* pool);
+void thread_pool_run(thread_pool_t* pool,
+                     thread_function function,
+                     void* args,
+                     size_t arg_size,
+                     int task_count);
+void thread_pool_destroy(thread_pool_t* pool);
+
+void global_lock(void);
+void global_unlock(void);
@@ -0,0 +1,177 @@
+
+#include "window_cache.h"
+
+#include "thread.h"
+#include "window_functions.h"
+
+// Most windows kept at once. Sweeping the cutoff reuses one window, and a batch
+// needs one per distinct order and window, so this is only reached by a
+// process designing filters of ever changing length, whose windows are then
+// generated afresh rather than kept.
+#define WINDOW_CACHE_MAX_ENTRIES 64
+
+// -----------------------------------------------------------------------------
+// One generated window and the parameters it was generated with.
+// -----------------------------------------------------------------------------
+typedef struct window_cache_entry
+{
+    enum window_t window_type;
+    size_t num_coeffs;
+    float kaiser_beta;
+    float* window;
+    struct window_cache_entry* next;
+} window_cache_entry_t;
+
+// Windows shared by every filter in the process, guarded by global_lock.
+// Entries live until window_cache_clear, so a window found under the lock may
+// be read after it is released.
+static window_cache_entry_t* window_cache = NULL;
+static size_t window_cache_size = 0;
+
+void generate_window(float* coeffs,
+                     size_t num_coeffs,
+                     enum window_t window_type,
+                     float kaiser_beta);
+
+// -----------------------------------------------------------------------------
+// Multiplies coefficients by a window, generating it on first use and reusing
+// it after that, so that redesigning a filter of the same length costs one
+// multiply per tap for the window. Safe to call from several threads at once.
+//
+// Arguments:
+//     coeffs      - coefficients to multiply by the window
+//     num_coeffs  - length of the window
+//     window_type - window to apply
+//     kaiser_beta - shape of a kaiser window, ignored by the others
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void window_cache_apply(float* coeffs,
+                        size_t num_coeffs,
+                        enum window_t window_type,
+                        float kaiser_beta)
+{
+    if (window_type != BARTLETT && window_type != BLACKMAN &&
+        window_type != HAMMING && window_type != HANNING &&
+        window_type != KAISER)
+        return;
+
+    global_lock();
+
+    window_cache_entry_t* entry = window_cache;
+    while (entry && !(entry->window_type == window_type &&
+                      entry->num_coeffs == num_coeffs &&
+                      (window_type != KAISER ||
+                       entry->kaiser_beta == kaiser_beta)))
+        entry = entry->next;
+
+    if (!entry && window_cache_size < WINDOW_CACHE_MAX_ENTRIES)
+    {
+        entry = (window_cache_entry_t*)malloc(sizeof(window_cache_entry_t));
+        float* window = (float*)malloc(num_coeffs * sizeof(float));
+
+        if (entry && window)
+        {
+            for (size_t i = 0; i < num_coeffs; ++i)
+                window[i] = 1.0f;
+            generate_window(window, num_coeffs, window_type, kaiser_beta);
+
+            entry->window_type = window_type;
+            entry->num_coeffs = num_coeffs;
+            entry->kaiser_beta = kaiser_beta;
+            entry->window = window;
+            entry->next = window_cache;
+            window_cache = entry;
+            ++window_cache_size;
+        }
+        else
+        {
+            free(entry);
+            free(window);
+            entry = NULL;
+        }
+    }
+
+    global_unlock();
+
+    if (entry)
+    {
+        for (size_t i = 0; i < num_coeffs; ++i)
+            coeffs[i] *= entry->window[i];
+    }
+    else
+    {
+        generate_window(coeffs, num_coeffs, window_type, kaiser_beta);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Multiplies coefficients by a window computed from scratch.
+// -----------------------------------------------------------------------------
+void generate_window(float* coeffs,
+                     size_t num_coeffs,
+                     enum window_t window_type,
+                     float kaiser_beta)
+{
+    switch (window_type)
+    {
+    case BARTLETT: bartlett_window(coeffs, num_coeffs); break;
+    case BLACKMAN: blackman_window(coeffs, num_coeffs); break;
+    case HAMMING: hamming_window(coeffs, num_coeffs); break;
+    case HANNING: hanning_window(coeffs, num_coeffs); break;
+    case KAISER: kaiser_window(coeffs, num_coeffs, kaiser_beta); break;
+    default: break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Multiplies double coefficients by a window computed in double. These are
+// not cached, being only designed for the double arithmetic.
+//
+// Arguments:
+//     coeffs      - coefficients to multiply by the window
+//     num_coeffs  - length of the window
+//     window_type - window to apply
+//     kaiser_beta - beta of a kaiser window
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void window_apply_double(double* coeffs,
+                         size_t num_coeffs,
+                         enum window_t window_type,
+                         float kaiser_beta)
+{
+    switch (window_type)
+    {
+    case BARTLETT: bartlett_window_double(coeffs, num_coeffs); break;
+    case BLACKMAN: blackman_window_double(coeffs, num_coeffs); break;
+    case HAMMING: hamming_window_double(coeffs, num_coeffs); break;
+    case HANNING: hanning_window_double(coeffs, num_coeffs); break;
+    case KAISER: kaiser_window_double(coeffs, num_coeffs, kaiser_beta); break;
+    default: break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Frees every cached window. No filter may be being designed at the time.
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void window_cache_clear(void)
+{
+    global_lock();
+
+    while (window_cache)
+    {
+        window_cache_entry_t* next = window_cache->next;
+        free(window_cache->window);
+        free(window_cache);
+        window_cache = next;
+    }
+    window_cache_size = 0;
+
+    global_unlock();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "low_pass_filter.h"
+
+void window_cache_apply(float* coeffs,
+                        size_t num_coeffs,
+                        enum window_t window_type,
+                        float kaiser_beta);
+
+void window_apply_double(double* coeffs,
+                         size_t num_coeffs,
+                         enum window_t window_type,
+                         float kaiser_beta);
+
+void window_cache_clear(void);
@@ -1,6 +1,23 @@
 
 #include "window_functions.h"
 
+// Relative size of the last term summed by bessel_zero. Terms shrink faster
+// than geometrically once past the largest, so this is inside double
+// precision by the time the sum stops.
+#define BESSEL_TOLERANCE 1e-17
+
+void cosine_sum_window(float* coeffs,
+                       size_t num_coeffs,
+                       double a0,
+                       double a1,
+                       double a2);
+void cosine_sum_window_double(double* coeffs,
+                              size_t num_coeffs,
+                              double a0,
+                              double a1,
+                              double a2);
+double bessel_zero_double(double x);
+
 void bartlett_window(float* coeffs, size_t num_coeffs)
 {
     const float order = (float)num_coeffs - 1.0f;
@@ -10,52 +27,161 @@ void bartlett_window(float* coeffs, size_t num_coeffs)
 
 void blackman_window(float* coeffs, size_t num_coeffs)
 {
-    const float order = (float)num_coeffs - 1.0f;
-    for (int i = 0; i < num_coeffs; ++i)
-        coeffs[i] *= 0.42f - 0.5f * cosf(2 * M_PI * i / order) +
-                     0.08f * cosf(4 * M_PI * i / order);
+    cosine_sum_window(coeffs, num_coeffs, 0.42, 0.5, 0.08);
 }
 
 void hamming_window(float* coeffs, size_t num_coeffs)
 {
-    const float order = (float)num_coeffs - 1.0f;
-    for (int i = 0; i < num_coeffs; ++i)
-        coeffs[i] *= 0.54f - 0.46f * cosf(2 * M_PI * i / order);
+    cosine_sum_window(coeffs, num_coeffs, 0.54, 0.46, 0.0);
 }
 
 void hanning_window(float* coeffs, size_t num_coeffs)
 {
-    const float order = (float)num_coeffs - 1.0f;
-    for (int i = 0; i < num_coeffs; ++i)
-        coeffs[i] *= 0.5f - 0.5f * cosf(2 * M_PI * i / order);
+    cosine_sum_window(coeffs, num_coeffs, 0.5, 0.5, 0.0);
+}
+
+void bartlett_window_double(double* coeffs, size_t num_coeffs)
+{
+    const double order = (double)num_coeffs - 1.0;
+    for (size_t i = 0; i < num_coeffs; ++i)
+        coeffs[i] *= 1.0 - 2.0 * (fabs((double)i - order / 2.0) / order);
+}
+
+void blackman_window_double(double* coeffs, size_t num_coeffs)
+{
+    cosine_sum_window_double(coeffs, num_coeffs, 0.42, 0.5, 0.08);
+}
+
+void hamming_window_double(double* coeffs, size_t num_coeffs)
+{
+    cosine_sum_window_double(coeffs, num_coeffs, 0.54, 0.46, 0.0);
+}
+
+void hanning_window_double(double* coeffs, size_t num_coeffs)
+{
+    cosine_sum_window_double(coeffs, num_coeffs, 0.5, 0.5, 0.0);
+}
+
+// -----------------------------------------------------------------------------
+// Applies the window a0 - a1 cos(2 pi i / order) + a2 cos(4 pi i / order),
+// the form shared by the Hann, Hamming and Blackman windows, without a trig
+// call per tap. cos(2 pi i / order) is stepped by rotating a unit vector
+// through 2 pi / order, in double so the rounding stays far below float
+// resolution, and cos(4 pi i / order) is 2 cos^2 - 1. Only the first half is
+// computed, the window being symmetric.
+//
+// Arguments:
+//     coeffs     - coefficients to multiply by the window
+//     num_coeffs - length of the window
+//     a0, a1, a2 - weights of the constant and the two cosine terms
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void cosine_sum_window(float* coeffs,
+                       size_t num_coeffs,
+                       double a0,
+                       double a1,
+                       double a2)
+{
+    const double step = 2.0 * M_PI / ((double)num_coeffs - 1.0);
+    const double cos_step = cos(step);
+    const double sin_step = sin(step);
+    double c = 1.0;
+    double s = 0.0;
+
+    for (size_t i = 0; i < (num_coeffs + 1) / 2; ++i)
+    {
+        const float w = (float)(a0 - a1 * c + a2 * (2.0 * c * c - 1.0));
+        coeffs[i] *= w;
+        if (num_coeffs - 1 - i != i)
+            coeffs[num_coeffs - 1 - i] *= w;
+
+        const double next_c = c * cos_step - s * sin_step;
+        s = s * cos_step + c * sin_step;
+        c = next_c;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// cosine_sum_window for double coefficients, for the double precision design.
+// Each tap's cosine is computed directly, since stepping by rotation drifts by
+// a few ulps of double over a long window.
+// -----------------------------------------------------------------------------
+void cosine_sum_window_double(double* coeffs,
+                              size_t num_coeffs,
+                              double a0,
+                              double a1,
+                              double a2)
+{
+    const double step = 2.0 * M_PI / ((double)num_coeffs - 1.0);
+
+    for (size_t i = 0; i < (num_coeffs + 1) / 2; ++i)
+    {
+        const double c = cos(step * (double)i);
+        const double w = a0 - a1 * c + a2 * (2.0 * c * c - 1.0);
+        coeffs[i] *= w;
+        if (num_coeffs - 1 - i != i)
+            coeffs[num_coeffs - 1 - i] *= w;
+    }
 }
 
+// -----------------------------------------------------------------------------
+// Zeroth order modified Bessel function of the first kind, by its power series
+// sum of ((x / 2)^k / k!)^2. Each term is the one before times
+// (x / 2)^2 / k^2, so no powers or factorials are computed, and the sum runs
+// until the terms stop mattering rather than for a fixed count.
+// -----------------------------------------------------------------------------
 float bessel_zero(float x)
 {
-    float bessel_z = 1;
-    int factorial = 1;
+    return (float)bessel_zero_double(x);
+}
 
-    for (int i = 1; i <= 20; ++i)
+double bessel_zero_double(double x)
+{
+    const double quarter_x_squared = x * x / 4.0;
+    double term = 1.0;
+    double bessel_z = 1.0;
+
+    for (int k = 1; term > bessel_z * BESSEL_TOLERANCE; ++k)
     {
-        factorial *= i;
-        bessel_z += powf(x / 2.0f, 2.0f * (float)i) / powf(factorial, 2.0f);
+        term *= quarter_x_squared / ((double)k * k);
+        bessel_z += term;
     }
 
     return bessel_z;
 }
 
-void kaiser_window(float* coeffs, size_t num_coeffs)
+void kaiser_window(float* coeffs, size_t num_coeffs, float beta)
 {
-    const float beta = 2.0f * sqrtf(2.0f * M_PI);
     const float order = (float)num_coeffs - 1.0f;
     const float bessel_z_beta = bessel_zero(beta);
 
-    for (int i = 0; i < num_coeffs; ++i)
+    // symmetric, so only the first half needs a Bessel function
+    for (size_t i = 0; i < (num_coeffs + 1) / 2; ++i)
     {
-        coeffs[i] *=
-            bessel_zero(
-                beta *
-                sqrtf(1.0f - powf((2.0f * (float)i / order) - 1.0f, 2.0f))) /
-            bessel_z_beta;
+        const float x = 2.0f * (float)i / order - 1.0f;
+        const float w = bessel_zero(beta * sqrtf(1.0f - x * x)) / bessel_z_beta;
+
+        coeffs[i] *= w;
+        if (num_coeffs - 1 - i != i)
+            coeffs[num_coeffs - 1 - i] *= w;
     }
-}
\ No newline at end of file
+}
+
+void kaiser_window_double(double* coeffs, size_t num_coeffs, double beta)
+{
+    const double order = (double)num_coeffs - 1.0;
+    const double bessel_z_beta = bessel_zero_double(beta);
+
+    for (size_t i = 0; i < (num_coeffs + 1) / 2; ++i)
+    {
+        const double x = 2.0 * (double)i / order - 1.0;
+        const double w =
+            bessel_zero_double(beta * sqrt(1.0 - x * x)) / bessel_z_beta;
+
+        coeffs[i] *= w;
+        if (num_coeffs - 1 - i != i)
+            coeffs[num_coeffs - 1 - i] *= w;
+    }
+}
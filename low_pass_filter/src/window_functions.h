@@ -2,9 +2,16 @@
 #pragma once
 
 #include <math.h>
+#include <stddef.h>
 
 void bartlett_window(float* coeffs, size_t num_coeffs);
 void blackman_window(float* coeffs, size_t num_coeffs);
 void hamming_window(float* coeffs, size_t num_coeffs);
 void hanning_window(float* coeffs, size_t num_coeffs);
-void kaiser_window(float* coeffs, size_t num_coeffs);
\ No newline at end of file
+void kaiser_window(float* coeffs, size_t num_coeffs, float beta);
+
+void bartlett_window_double(double* coeffs, size_t num_coeffs);
+void blackman_window_double(double* coeffs, size_t num_coeffs);
+void hamming_window_double(double* coeffs, size_t num_coeffs);
+void hanning_window_double(double* coeffs, size_t num_coeffs);
+void kaiser_window_double(double* coeffs, size_t num_coeffs, double beta);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "workspace.h"
+
+// -----------------------------------------------------------------------------
+// Rounds a buffer size up to a whole number of WORKSPACE_ALIGNMENT blocks, so
+// that buffers carved one after another keep the alignment of the first.
+//
+// Arguments:
+//     bytes - size of buffer
+//
+// Returns:
+//     size rounded up
+// -----------------------------------------------------------------------------
+size_t workspace_round(size_t bytes)
+{
+    return (bytes + WORKSPACE_ALIGNMENT - 1) / WORKSPACE_ALIGNMENT *
+           WORKSPACE_ALIGNMENT;
+}
+
+// -----------------------------------------------------------------------------
+// Takes the next buffer from memory an object is being built in, for the
+// *_init functions that build an object and its arrays in memory sized by
+// their *_size counterpart. The memory is zeroed by whoever provides it, so
+// the buffer is not cleared here.
+//
+// Arguments:
+//     cursor - start of the memory not yet taken, advanced past the buffer
+//     bytes  - size of buffer
+//
+// Returns:
+//     pointer to buffer
+// -----------------------------------------------------------------------------
+void* workspace_carve(unsigned char** cursor, size_t bytes)
+{
+    unsigned char* buffer = *cursor;
+    *cursor += workspace_round(bytes);
+
+    return buffer;
+}
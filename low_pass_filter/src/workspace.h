@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+
+// Alignment of each buffer carved from a workspace, a cache line, which is
+// also enough for any SIMD load.
+#define WORKSPACE_ALIGNMENT 64
+
+size_t workspace_round(size_t bytes);
+
+void* workspace_carve(unsigned char** cursor, size_t bytes);
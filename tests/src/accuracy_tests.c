@@ -0,0 +1,485 @@
+#include "accuracy_tests.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "low_pass_filter.h"
+#include "test_signals.h"
+
+// Sample rate, cutoff, order and channel count every sweep varies one setting
+// away from: the command line's defaults.
+#define CHECK_SAMPLE_RATE 48000.0f
+#define CHECK_CUTOFF 5000.0f
+#define CHECK_DEFAULT_ORDER 126
+#define CHECK_DEFAULT_CHANNELS 2
+#define CHECK_DEFAULT_IIR_ORDER 4
+
+// Frequencies the magnitude responses are compared at, evenly from 0 to
+// Nyquist.
+#define CHECK_RESPONSE_POINTS 256
+
+// Largest difference from the reference allowed per sample, in units of the
+// float rounding of a sum as long as the filter, FLT_EPSILON * sqrt(length).
+// Kernels and engines only sum the same products in another order.
+#define CHECK_ERROR_ULPS 8.0
+
+// Largest allowed distance of the gain from 1 at DC, and from the gain every
+// design has at its cutoff: one half for a windowed sinc, the half power point
+// for a Butterworth filter.
+#define CHECK_DC_GAIN_LIMIT 1e-3
+#define CHECK_CUTOFF_GAIN_LIMIT 0.02
+
+// -----------------------------------------------------------------------------
+// One way of running the filter: an engine, and for direct form the tap
+// kernel's instruction set and whether channels are deinterleaved.
+// -----------------------------------------------------------------------------
+typedef struct check_engine
+{
+    const char* name;
+    enum lpf_engine engine;
+    enum lpf_simd simd;
+    bool planar;
+} check_engine_t;
+
+// -----------------------------------------------------------------------------
+// Settings of one accuracy check.
+// -----------------------------------------------------------------------------
+typedef struct check_case
+{
+    const char* sweep;
+    const check_engine_t* engine;
+    int order;
+    enum window_t window_type;
+    float sample_rate;
+    int channels;
+} check_case_t;
+
+// The first engine is the reference: the scalar direct form on interleaved
+// samples. Planar filtering has block kernels of its own at every instruction
+// set, so each is checked.
+static const check_engine_t engines[] = {
+    {"direct-scalar", LPF_ENGINE_DIRECT, LPF_SIMD_SCALAR, false},
+    {"direct-sse", LPF_ENGINE_DIRECT, LPF_SIMD_SSE, false},
+    {"direct-avx2", LPF_ENGINE_DIRECT, LPF_SIMD_AVX2, false},
+    {"direct-avx512", LPF_ENGINE_DIRECT, LPF_SIMD_AVX512, false},
+    {"direct-neon", LPF_ENGINE_DIRECT, LPF_SIMD_NEON, false},
+    {"planar-scalar", LPF_ENGINE_DIRECT, LPF_SIMD_SCALAR, true},
+    {"planar-sse", LPF_ENGINE_DIRECT, LPF_SIMD_SSE, true},
+    {"planar-avx2", LPF_ENGINE_DIRECT, LPF_SIMD_AVX2, true},
+    {"planar-avx512", LPF_ENGINE_DIRECT, LPF_SIMD_AVX512, true},
+    {"planar-neon", LPF_ENGINE_DIRECT, LPF_SIMD_NEON, true},
+    {"fft", LPF_ENGINE_FFT, LPF_SIMD_AUTO, false},
+    {"iir", LPF_ENGINE_IIR, LPF_SIMD_AUTO, false},
+};
+
+// Odd and even orders, as symmetric coefficients are folded differently, and
+// one long enough for the FFT to be worth using.
+static const int check_orders[] = {15, 126, 127, 1024};
+static const int iir_orders[] = {2, 4, 8, 16};
+static const int check_channel_counts[] = {1, 2, 5, 8};
+static const float check_sample_rates[] = {
+    22050.0f, 44100.0f, 48000.0f, 96000.0f};
+static const enum window_t window_types[] = {
+    KAISER, BLACKMAN, HAMMING, HANNING, BARTLETT, RECTANGULAR};
+
+// Sizes the engine checked is passed its input in, in turn, while the
+// reference is passed whole blocks, so that the output is also checked not to
+// depend on how the input is split.
+static const size_t check_chunks[] = {1, 97, 511, 4096};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+bool engine_supported(const check_engine_t* engine);
+bool check_engine(const check_engine_t* engine, FILE* results, int* failures);
+bool run_check(const check_case_t* check, FILE* results, int* failures);
+float* filter_signal(const check_case_t* check,
+                     const check_engine_t* engine,
+                     const float* signal,
+                     bool chunked);
+double magnitude_response(const float* impulse_response,
+                          size_t length,
+                          int stride,
+                          double frequency);
+void write_check(const check_case_t* check,
+                 const char* signal,
+                 double measured,
+                 double limit,
+                 FILE* results,
+                 int* failures);
+const char* window_name(enum window_t window_type);
+
+// -----------------------------------------------------------------------------
+// Checks the accuracy of every engine against the reference, writing a CSV row
+// per check. Each filters a sweep, noise and impulses generated in memory, and
+// the checks vary order, channel count, sample rate and window.
+//
+// Arguments:
+//     results  - file the CSV rows are written to
+//     failures - incremented for every check that fails
+//
+// Returns:
+//     true unless a filter could not be prepared
+// -----------------------------------------------------------------------------
+bool run_accuracy_tests(FILE* results, int* failures)
+{
+    fprintf(results,
+            "sweep,engine,signal,order,window,sample_rate,channels,"
+            "measured,limit,result\n");
+
+    bool ok = true;
+    for (size_t i = 0; i < COUNT(engines) && ok; ++i)
+        ok = check_engine(&engines[i], results, failures);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Checks whether this CPU has the instruction set an engine's kernel needs.
+// -----------------------------------------------------------------------------
+bool engine_supported(const check_engine_t* engine)
+{
+    low_pass_filter_t* probe = lpf_create(CHECK_CUTOFF, KAISER, 1);
+    const bool supported =
+        probe && lpf_set_simd(probe, engine->simd) == LPF_NO_ERROR;
+    lpf_destroy(probe);
+
+    return supported;
+}
+
+// -----------------------------------------------------------------------------
+// Runs every sweep of accuracy checks for one engine. The IIR engine sweeps its
+// own orders and has no window.
+//
+// Returns:
+//     true unless a filter could not be prepared
+// -----------------------------------------------------------------------------
+bool check_engine(const check_engine_t* engine, FILE* results, int* failures)
+{
+    // an instruction set this machine lacks is skipped, not failed
+    if (!engine_supported(engine))
+    {
+        eprintf("%s: not supported on this CPU, skipped\n", engine->name);
+        return true;
+    }
+
+    const bool iir = engine->engine == LPF_ENGINE_IIR;
+
+    check_case_t check;
+    check.engine = engine;
+    check.order = iir ? CHECK_DEFAULT_IIR_ORDER : CHECK_DEFAULT_ORDER;
+    check.window_type = KAISER;
+    check.sample_rate = CHECK_SAMPLE_RATE;
+    check.channels = CHECK_DEFAULT_CHANNELS;
+
+    bool ok = true;
+
+    check.sweep = "order";
+    const int* orders = iir ? iir_orders : check_orders;
+    const size_t order_count = iir ? COUNT(iir_orders) : COUNT(check_orders);
+    for (size_t i = 0; i < order_count && ok; ++i)
+    {
+        check.order = orders[i];
+        ok = run_check(&check, results, failures);
+    }
+    check.order = iir ? CHECK_DEFAULT_IIR_ORDER : CHECK_DEFAULT_ORDER;
+
+    check.sweep = "channels";
+    for (size_t i = 0; i < COUNT(check_channel_counts) && ok; ++i)
+    {
+        check.channels = check_channel_counts[i];
+        ok = run_check(&check, results, failures);
+    }
+    check.channels = CHECK_DEFAULT_CHANNELS;
+
+    check.sweep = "sample-rate";
+    for (size_t i = 0; i < COUNT(check_sample_rates) && ok; ++i)
+    {
+        check.sample_rate = check_sample_rates[i];
+        ok = run_check(&check, results, failures);
+    }
+    check.sample_rate = CHECK_SAMPLE_RATE;
+
+    check.sweep = "window";
+    for (size_t i = 0; i < COUNT(window_types) && ok && !iir; ++i)
+    {
+        check.window_type = window_types[i];
+        ok = run_check(&check, results, failures);
+    }
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Filters each test signal with the engine and the reference and compares
+// them sample by sample, then compares their magnitude responses, measured from
+// the impulse signal's first impulse, and checks the engine's gain at DC and
+// at the cutoff. The IIR engine has no reference, so only its gains are
+// checked.
+//
+// Arguments:
+//     check    - settings to check
+//     results  - file the CSV rows are written to
+//     failures - incremented for every check that fails
+//
+// Returns:
+//     true unless a filter could not be prepared
+// -----------------------------------------------------------------------------
+bool run_check(const check_case_t* check, FILE* results, int* failures)
+{
+    const bool iir = check->engine->engine == LPF_ENGINE_IIR;
+    const size_t samples = (size_t)TEST_SIGNAL_FRAMES * check->channels;
+    const double limit =
+        CHECK_ERROR_ULPS * FLT_EPSILON * sqrt(check->order + 1.0);
+
+    // the impulse signal is filtered last, so its outputs are kept for the
+    // responses
+    float* actual = NULL;
+    float* expected = NULL;
+    bool ok = true;
+
+    for (int kind = 0; kind < TEST_SIGNAL_COUNT && ok; ++kind)
+    {
+        free(actual);
+        free(expected);
+        actual = NULL;
+        expected = NULL;
+
+        float* signal = generate_test_signal(
+            (enum test_signal)kind, check->sample_rate, check->channels);
+        if (signal)
+        {
+            actual = filter_signal(check, check->engine, signal, true);
+            if (!iir)
+                expected = filter_signal(check, &engines[0], signal, false);
+        }
+        free(signal);
+
+        ok = actual && (iir || expected);
+        if (!ok || iir)
+            continue;
+
+        double error = 0.0;
+        for (size_t i = 0; i < samples; ++i)
+            error = fmax(error, fabs((double)actual[i] - expected[i]));
+
+        write_check(check,
+                    test_signal_name((enum test_signal)kind),
+                    error,
+                    limit,
+                    results,
+                    failures);
+    }
+
+    if (ok)
+    {
+        // a FIR filter's response ends after its last tap, and a stable IIR
+        // filter's has died away by the next impulse
+        const size_t length =
+            iir ? TEST_IMPULSE_SPACING : (size_t)check->order + 1;
+        const int stride = check->channels;
+
+        if (!iir)
+        {
+            double error = 0.0;
+            for (int k = 0; k <= CHECK_RESPONSE_POINTS; ++k)
+            {
+                const double frequency = 0.5 * k / CHECK_RESPONSE_POINTS;
+                error = fmax(
+                    error,
+                    fabs(magnitude_response(actual, length, stride, frequency) -
+                         magnitude_response(
+                             expected, length, stride, frequency)));
+            }
+
+            write_check(check, "response", error, limit, results, failures);
+        }
+
+        const double dc_gain = magnitude_response(actual, length, stride, 0.0);
+        const double cutoff_gain = magnitude_response(
+            actual, length, stride, CHECK_CUTOFF / check->sample_rate);
+
+        write_check(check,
+                    "dc-gain",
+                    fabs(dc_gain - 1.0),
+                    CHECK_DC_GAIN_LIMIT,
+                    results,
+                    failures);
+        write_check(check,
+                    "cutoff-gain",
+                    fabs(cutoff_gain - (iir ? M_SQRT1_2 : 0.5)),
+                    CHECK_CUTOFF_GAIN_LIMIT,
+                    results,
+                    failures);
+    }
+    else
+    {
+        eprintf("%s: unable to prepare order %d, %d channels at %.0f Hz\n",
+                check->engine->name,
+                check->order,
+                check->channels,
+                check->sample_rate);
+    }
+
+    free(actual);
+    free(expected);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Filters a test signal with one engine, through lpf_process.
+//
+// Arguments:
+//     check   - settings to filter with, apart from the engine
+//     engine  - engine to filter with
+//     signal  - TEST_SIGNAL_FRAMES frames of check->channels channels
+//     chunked - whether to pass the input in the sizes of check_chunks in
+//               turn, rather than in blocks of the filter's size
+//
+// Returns:
+//     pointer to the filtered signal, or NULL on failure
+// -----------------------------------------------------------------------------
+float* filter_signal(const check_case_t* check,
+                     const check_engine_t* engine,
+                     const float* signal,
+                     bool chunked)
+{
+    const int channels = check->channels;
+
+    low_pass_filter_t* lpf =
+        lpf_create(CHECK_CUTOFF, check->window_type, LPF_BLOCK_AUTO);
+    if (!lpf)
+        return NULL;
+
+    lpf_set_engine(lpf, engine->engine);
+    if (engine->engine == LPF_ENGINE_IIR)
+        lpf_set_iir_design(lpf, LPF_IIR_BUTTERWORTH, check->order);
+    else
+        lpf_set_order(lpf, check->order);
+    lpf_set_simd(lpf, engine->simd);
+    lpf_set_planar(lpf, engine->planar);
+
+    float* output = (float*)malloc((size_t)TEST_SIGNAL_FRAMES * channels *
+                                   sizeof(float));
+
+    if (!output ||
+        lpf_prepare(lpf, check->sample_rate, channels) != LPF_NO_ERROR)
+    {
+        free(output);
+        lpf_destroy(lpf);
+        return NULL;
+    }
+
+    const size_t block_frames = lpf_get_block_size(lpf);
+    size_t done = 0;
+    for (size_t i = 0; done < TEST_SIGNAL_FRAMES; ++i)
+    {
+        size_t frames =
+            chunked ? check_chunks[i % COUNT(check_chunks)] : block_frames;
+        if (frames > TEST_SIGNAL_FRAMES - done)
+            frames = TEST_SIGNAL_FRAMES - done;
+
+        lpf_process(lpf,
+                    signal + done * channels,
+                    output + done * channels,
+                    frames);
+        done += frames;
+    }
+
+    lpf_destroy(lpf);
+
+    return output;
+}
+
+// -----------------------------------------------------------------------------
+// Computes a filter's gain at one frequency from its impulse response.
+//
+// Arguments:
+//     impulse_response - first sample of the response
+//     length           - number of samples in the response
+//     stride           - distance between consecutive samples, the channel
+//                        count of an interleaved buffer
+//     frequency        - frequency in cycles per sample, from 0 to 0.5
+//
+// Returns:
+//     magnitude of the response at frequency
+// -----------------------------------------------------------------------------
+double magnitude_response(const float* impulse_response,
+                          size_t length,
+                          int stride,
+                          double frequency)
+{
+    double real = 0.0;
+    double imag = 0.0;
+
+    for (size_t n = 0; n < length; ++n)
+    {
+        const double phase = 2.0 * M_PI * frequency * n;
+        real += impulse_response[n * stride] * cos(phase);
+        imag -= impulse_response[n * stride] * sin(phase);
+    }
+
+    return sqrt(real * real + imag * imag);
+}
+
+// -----------------------------------------------------------------------------
+// Writes the CSV row of one check, and counts it if it failed.
+//
+// Arguments:
+//     check    - settings checked
+//     signal   - name of the signal or property checked
+//     measured - error measured
+//     limit    - largest error that passes
+//     results  - file the CSV row is written to
+//     failures - incremented if the check failed
+//
+// Returns:
+//     void
+// -----------------------------------------------------------------------------
+void write_check(const check_case_t* check,
+                 const char* signal,
+                 double measured,
+                 double limit,
+                 FILE* results,
+                 int* failures)
+{
+    // NaN never passes
+    const bool pass = measured <= limit;
+    if (!pass)
+        ++*failures;
+
+    fprintf(results,
+            "%s,%s,%s,%d,%s,%.0f,%d,%.3e,%.3e,%s\n",
+            check->sweep,
+            check->engine->name,
+            signal,
+            check->order,
+            check->engine->engine == LPF_ENGINE_IIR
+                ? "none"
+                : window_name(check->window_type),
+            check->sample_rate,
+            check->channels,
+            measured,
+            limit,
+            pass ? "pass" : "fail");
+    fflush(results);
+}
+
+// -----------------------------------------------------------------------------
+// Gets the command line name of a window.
+// -----------------------------------------------------------------------------
+const char* window_name(enum window_t window_type)
+{
+    switch (window_type)
+    {
+    case KAISER: return "kaiser";
+    case BLACKMAN: return "blackman";
+    case HAMMING: return "hamming";
+    case HANNING: return "hanning";
+    case BARTLETT: return "bartlett";
+    case RECTANGULAR: return "rectangular";
+    default: return "none";
+    }
+}
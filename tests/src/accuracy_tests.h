@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+bool run_accuracy_tests(FILE* results, int* failures);
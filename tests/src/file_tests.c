@@ -0,0 +1,391 @@
+#include "file_tests.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter_design.h"
+#include "low_pass_filter.h"
+#include "test_signals.h"
+
+// Sample rate, cutoff and order of every file filtered, and the files, written
+// to the working directory and removed afterwards.
+#define FILE_SAMPLE_RATE 48000
+#define FILE_CUTOFF 5000.0f
+#define FILE_ORDER 126
+#define FILE_TEST_INPUT "tests_in.wav"
+#define FILE_TEST_OUTPUT "tests_out.wav"
+
+// Largest difference allowed per sample from the exact output of the taps each
+// path filters with, computed in long double from the input as read back, in
+// LSBs of the file's sample format. An LSB of a float or double file is taken
+// as FLT_EPSILON, a float rounding at full scale.
+//
+// A float sum of 127 products is off by a few roundings of the largest of them
+// whatever order it is summed in, however the work is split between threads.
+// Fixed point rounds the exact sum of its Q15 or Q31 taps once, to the output
+// width, so it must be within half an LSB, with a little room for the
+// reference's own rounding where long double is only double. The higher
+// precision arithmetics read and write doubles, so they write double files:
+// the compensated float sum is within a float rounding, and the double sums
+// within a double rounding, which is 2^-29 of a float one.
+#define FILE_FLOAT_LSBS 4.0
+#define FILE_FIXED_LSBS 0.501
+#define FILE_KAHAN_LSBS 1.0
+#define FILE_DOUBLE_LSBS 1e-6
+
+// -----------------------------------------------------------------------------
+// One path through lpf_filter_file, and the error allowed on it.
+// -----------------------------------------------------------------------------
+typedef struct file_case
+{
+    const char* path;
+    int format;
+    int channels;
+    int thread_count;
+    int pipeline_depth;
+    enum lpf_arithmetic arithmetic;
+    double limit;
+} file_case_t;
+
+// Parallel chunks are cut into runs of channel frames, one per thread: whole
+// channels when the threads divide the channels, a channel and a half each for
+// 3 on 2, and one channel cut in time otherwise. WAV files of 16 or 24 bit PCM
+// or float are mapped into memory, which the pipeline is not used with, so the
+// pipelined paths write double files, which libsndfile reads and writes.
+static const file_case_t file_cases[] = {
+    {"serial", SF_FORMAT_FLOAT, 2, 1, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"channel-split",
+     SF_FORMAT_FLOAT, 4, 2, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"channel-split",
+     SF_FORMAT_FLOAT, 8, 4, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"uneven-split",
+     SF_FORMAT_FLOAT, 3, 2, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"time-split",
+     SF_FORMAT_FLOAT, 1, 2, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"time-split",
+     SF_FORMAT_FLOAT, 1, 3, 0, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"pipeline",
+     SF_FORMAT_DOUBLE, 2, 1, 2, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"pipeline",
+     SF_FORMAT_DOUBLE, 2, 1, 3, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"pipeline",
+     SF_FORMAT_DOUBLE, 2, 1, 4, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"threaded-pipeline",
+     SF_FORMAT_DOUBLE, 3, 2, 3, LPF_ARITHMETIC_FLOAT, FILE_FLOAT_LSBS},
+    {"fixed", SF_FORMAT_PCM_16, 2, 1, 0, LPF_ARITHMETIC_FIXED, FILE_FIXED_LSBS},
+    {"fixed", SF_FORMAT_PCM_24, 2, 1, 0, LPF_ARITHMETIC_FIXED, FILE_FIXED_LSBS},
+    {"double-sum",
+     SF_FORMAT_DOUBLE, 2, 1, 0, LPF_ARITHMETIC_DOUBLE_SUM, FILE_DOUBLE_LSBS},
+    {"kahan", SF_FORMAT_DOUBLE, 2, 1, 0, LPF_ARITHMETIC_KAHAN, FILE_KAHAN_LSBS},
+    {"double",
+     SF_FORMAT_DOUBLE, 2, 1, 0, LPF_ARITHMETIC_DOUBLE, FILE_DOUBLE_LSBS},
+};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+bool run_file_case(const file_case_t* test, FILE* results, int* failures);
+double file_case_error(const file_case_t* test,
+                       enum test_signal kind,
+                       bool* ok);
+bool write_test_file(enum test_signal kind, int format, int channels);
+double* read_test_file(const char* file_name, int channels, sf_count_t* frames);
+bool design_taps(const file_case_t* test, long double* taps);
+double format_lsb(int format);
+const char* format_name(int format);
+
+// -----------------------------------------------------------------------------
+// Filters a sweep, noise and impulses written to WAV files through
+// lpf_filter_file on every path in file_cases, and compares each output with
+// the exact output of the same taps, writing a CSV row per path and signal.
+//
+// Arguments:
+//     results  - file the CSV rows are written to
+//     failures - incremented for every check that fails
+//
+// Returns:
+//     true unless a file could not be written or filtered
+// -----------------------------------------------------------------------------
+bool run_file_tests(FILE* results, int* failures)
+{
+    fprintf(results,
+            "path,format,channels,threads,pipeline,signal,measured_lsbs,"
+            "limit_lsbs,result\n");
+
+    bool ok = true;
+    for (size_t i = 0; i < COUNT(file_cases) && ok; ++i)
+        ok = run_file_case(&file_cases[i], results, failures);
+
+    remove(FILE_TEST_INPUT);
+    remove(FILE_TEST_OUTPUT);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Runs one path on every test signal.
+//
+// Returns:
+//     true unless a file could not be written or filtered
+// -----------------------------------------------------------------------------
+bool run_file_case(const file_case_t* test, FILE* results, int* failures)
+{
+    bool ok = true;
+    for (int kind = 0; kind < TEST_SIGNAL_COUNT && ok; ++kind)
+    {
+        const double measured =
+            file_case_error(test, (enum test_signal)kind, &ok);
+        if (!ok)
+        {
+            eprintf("%s: unable to filter the %s file\n",
+                    test->path,
+                    test_signal_name((enum test_signal)kind));
+            break;
+        }
+
+        // NaN never passes
+        const bool pass = measured <= test->limit;
+        if (!pass)
+            ++*failures;
+
+        fprintf(results,
+                "%s,%s,%d,%d,%d,%s,%.3e,%.3e,%s\n",
+                test->path,
+                format_name(test->format),
+                test->channels,
+                test->thread_count,
+                test->pipeline_depth,
+                test_signal_name((enum test_signal)kind),
+                measured,
+                test->limit,
+                pass ? "pass" : "fail");
+        fflush(results);
+    }
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Writes one test signal to a file, filters it through lpf_filter_file on one
+// path and measures the output against the exact output of the path's taps.
+//
+// Arguments:
+//     test - path to filter on
+//     kind - signal to filter
+//     ok   - set to false if the file could not be written or filtered
+//
+// Returns:
+//     largest error per sample in LSBs of the file's format, or NaN if the
+//     output is not as long as the input
+// -----------------------------------------------------------------------------
+double file_case_error(const file_case_t* test,
+                       enum test_signal kind,
+                       bool* ok)
+{
+    const int channels = test->channels;
+    const int length = FILE_ORDER + 1;
+
+    long double taps[FILE_ORDER + 1];
+    *ok = write_test_file(kind, test->format, channels) &&
+          design_taps(test, taps);
+    if (!*ok)
+        return NAN;
+
+    low_pass_filter_t* lpf = lpf_create(FILE_CUTOFF, KAISER, LPF_BLOCK_AUTO);
+    *ok = lpf != NULL;
+    if (!*ok)
+        return NAN;
+
+    lpf_set_order(lpf, FILE_ORDER);
+    lpf_set_thread_count(lpf, test->thread_count);
+    lpf_set_pipeline_depth(lpf, test->pipeline_depth);
+    lpf_set_arithmetic(lpf, test->arithmetic);
+
+    sf_count_t frames_filtered = 0;
+    *ok = lpf_filter_file(lpf,
+                          FILE_TEST_INPUT,
+                          FILE_TEST_OUTPUT,
+                          KAISER,
+                          &frames_filtered) == LPF_NO_ERROR;
+    lpf_destroy(lpf);
+    if (!*ok)
+        return NAN;
+
+    sf_count_t input_frames = 0;
+    sf_count_t output_frames = 0;
+    double* input = read_test_file(FILE_TEST_INPUT, channels, &input_frames);
+    double* output =
+        read_test_file(FILE_TEST_OUTPUT, channels, &output_frames);
+    *ok = input && output;
+
+    double error = NAN;
+    if (*ok && input_frames == TEST_SIGNAL_FRAMES &&
+        output_frames == TEST_SIGNAL_FRAMES &&
+        frames_filtered == TEST_SIGNAL_FRAMES)
+    {
+        error = 0.0;
+        for (size_t i = 0; i < TEST_SIGNAL_FRAMES; ++i)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                long double exact = 0.0L;
+                for (int k = 0; k < length && (size_t)k <= i; ++k)
+                    exact += taps[k] * input[(i - k) * channels + c];
+
+                error = fmax(error,
+                             fabs((double)(exact - output[i * channels + c])));
+            }
+        }
+
+        error /= format_lsb(test->format);
+    }
+
+    free(input);
+    free(output);
+
+    return error;
+}
+
+// -----------------------------------------------------------------------------
+// Writes TEST_SIGNAL_FRAMES frames of a test signal to FILE_TEST_INPUT, a WAV
+// file of the given sample format, through libsndfile.
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool write_test_file(enum test_signal kind, int format, int channels)
+{
+    float* signal =
+        generate_test_signal(kind, (float)FILE_SAMPLE_RATE, channels);
+    if (!signal)
+        return false;
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.samplerate = FILE_SAMPLE_RATE;
+    info.channels = channels;
+    info.format = SF_FORMAT_WAV | format;
+
+    SNDFILE* file = sf_open(FILE_TEST_INPUT, SFM_WRITE, &info);
+    bool ok = file && sf_writef_float(file, signal, TEST_SIGNAL_FRAMES) ==
+                          TEST_SIGNAL_FRAMES;
+
+    if (file && sf_close(file))
+        ok = false;
+
+    free(signal);
+
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Reads a whole file as doubles through libsndfile.
+//
+// Arguments:
+//     file_name - name of file to read
+//     channels  - number of channels the file must have
+//     frames    - receives the number of frames read
+//
+// Returns:
+//     pointer to the interleaved samples, or NULL on failure
+// -----------------------------------------------------------------------------
+double* read_test_file(const char* file_name, int channels, sf_count_t* frames)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+
+    SNDFILE* file = sf_open(file_name, SFM_READ, &info);
+    if (!file)
+        return NULL;
+
+    double* samples = NULL;
+    if (info.channels == channels && info.frames > 0)
+        samples =
+            (double*)malloc((size_t)info.frames * channels * sizeof(double));
+    if (samples)
+        *frames = sf_readf_double(file, samples, info.frames);
+
+    sf_close(file);
+
+    return samples;
+}
+
+// -----------------------------------------------------------------------------
+// Designs the taps lpf_filter_file filters with on a path: designed in double
+// for double arithmetic, and in float for every other, then for fixed point
+// rounded to Q15 for 16 bit samples or Q31 for 24 bit ones, the shifts
+// fixed_fir_t picks for a low pass filter, whose taps sum below 2 in
+// magnitude.
+//
+// Arguments:
+//     test - path to design for
+//     taps - receives FILE_ORDER + 1 taps
+//
+// Returns:
+//     true on success
+// -----------------------------------------------------------------------------
+bool design_taps(const file_case_t* test, long double* taps)
+{
+    filter_design_t design;
+    design.cutoff = FILE_CUTOFF;
+    design.sample_rate = (float)FILE_SAMPLE_RATE;
+    design.order = FILE_ORDER;
+    design.window_type = KAISER;
+    design.kaiser_beta = DEFAULT_KAISER_BETA;
+    design.phase = LPF_PHASE_LINEAR;
+
+    if (test->arithmetic == LPF_ARITHMETIC_DOUBLE)
+    {
+        double coeffs[FILE_ORDER + 1];
+        if (!design_low_pass_double(coeffs, &design))
+            return false;
+        for (int k = 0; k <= FILE_ORDER; ++k)
+            taps[k] = coeffs[k];
+    }
+    else
+    {
+        float coeffs[FILE_ORDER + 1];
+        if (!design_low_pass(coeffs, &design))
+            return false;
+        for (int k = 0; k <= FILE_ORDER; ++k)
+            taps[k] = coeffs[k];
+    }
+
+    if (test->arithmetic == LPF_ARITHMETIC_FIXED)
+    {
+        const int shift = test->format == SF_FORMAT_PCM_16 ? 15 : 31;
+        for (int k = 0; k <= FILE_ORDER; ++k)
+            taps[k] = ldexpl(nearbyintl(ldexpl(taps[k], shift)), -shift);
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Gets the step between samples of a sample format at full scale.
+// -----------------------------------------------------------------------------
+double format_lsb(int format)
+{
+    switch (format)
+    {
+    case SF_FORMAT_PCM_16: return 1.0 / 0x8000;
+    case SF_FORMAT_PCM_24: return 1.0 / 0x800000;
+    default: return FLT_EPSILON;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Gets the name a sample format is reported by.
+// -----------------------------------------------------------------------------
+const char* format_name(int format)
+{
+    switch (format)
+    {
+    case SF_FORMAT_PCM_16: return "pcm16";
+    case SF_FORMAT_PCM_24: return "pcm24";
+    case SF_FORMAT_FLOAT: return "float";
+    case SF_FORMAT_DOUBLE: return "double";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,519 @@
+#include "kernel_tests.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cpu_features.h"
+#include "fir_kernels.h"
+
+// Longest filter checked, and the outputs each block kernel check computes,
+// more than one output tile of fir_filter_line so that a tile edge is crossed.
+#define KERNEL_MAX_LENGTH 1024
+#define KERNEL_BLOCK_OUTPUTS 300
+
+// Largest difference from the scalar reference allowed, in ULPs of the sum of
+// the absolute products, that is FLT_EPSILON or DBL_EPSILON times that sum.
+// The vector kernels sum the same products in another order, which on these
+// signals stays within a ULP or so at every length, while a wrong or missing
+// tap is off by about a whole product, thousands of ULPs even at 1024 taps.
+// The compensated kernels are both within a rounding of the exact sum. The
+// integer kernels must match exactly.
+#define KERNEL_FLOAT_ULPS 4.0
+#define KERNEL_COMPENSATED_ULPS 2.0
+#define KERNEL_DOUBLE_ULPS 4.0
+#define KERNEL_INTEGER_ULPS 0.0
+
+// -----------------------------------------------------------------------------
+// Inputs shared by every check: random coefficients and samples in each type a
+// kernel takes, with room for the history of every block output, and the
+// symmetric coefficients and outputs each check fills in.
+// -----------------------------------------------------------------------------
+typedef struct kernel_buffers
+{
+    float* coeffs;
+    float* symmetric;
+    float* samples;
+    float* outputs;
+    double* coeffs_double;
+    double* samples_double;
+    int16_t* coeffs_q15;
+    int16_t* samples_q15;
+    int32_t* coeffs_q31;
+    int32_t* samples_q31;
+} kernel_buffers_t;
+
+// -----------------------------------------------------------------------------
+// One family of kernels: how to check it at one instruction set and length,
+// and the largest error allowed.
+// -----------------------------------------------------------------------------
+typedef struct kernel_check
+{
+    const char* name;
+    double (*check)(enum simd_level level,
+                    kernel_buffers_t* buffers,
+                    int length);
+    double limit;
+} kernel_check_t;
+
+double check_plain(enum simd_level level,
+                   kernel_buffers_t* buffers,
+                   int length);
+double check_folded(enum simd_level level,
+                    kernel_buffers_t* buffers,
+                    int length);
+double check_block(enum simd_level level,
+                   kernel_buffers_t* buffers,
+                   int length);
+double check_block_folded(enum simd_level level,
+                          kernel_buffers_t* buffers,
+                          int length);
+double check_q15(enum simd_level level, kernel_buffers_t* buffers, int length);
+double check_q31(enum simd_level level, kernel_buffers_t* buffers, int length);
+double check_wide(enum simd_level level, kernel_buffers_t* buffers, int length);
+double check_compensated(enum simd_level level,
+                         kernel_buffers_t* buffers,
+                         int length);
+double check_double(enum simd_level level,
+                    kernel_buffers_t* buffers,
+                    int length);
+double check_block_line(enum simd_level level,
+                        const float* coeffs,
+                        int length,
+                        bool folded,
+                        kernel_buffers_t* buffers);
+double absolute_sum(const float* coeffs, const float* samples, int length);
+float random_float(uint32_t* seed);
+bool allocate_buffers(kernel_buffers_t* buffers);
+void free_buffers(kernel_buffers_t* buffers);
+
+static const kernel_check_t kernel_checks[] = {
+    {"plain", check_plain, KERNEL_FLOAT_ULPS},
+    {"folded", check_folded, KERNEL_FLOAT_ULPS},
+    {"block", check_block, KERNEL_FLOAT_ULPS},
+    {"block-folded", check_block_folded, KERNEL_FLOAT_ULPS},
+    {"q15", check_q15, KERNEL_INTEGER_ULPS},
+    {"q31", check_q31, KERNEL_INTEGER_ULPS},
+    {"wide", check_wide, KERNEL_DOUBLE_ULPS},
+    {"compensated", check_compensated, KERNEL_COMPENSATED_ULPS},
+    {"double", check_double, KERNEL_DOUBLE_ULPS},
+};
+
+static const char* const level_names[] = {
+    "scalar", "sse", "avx2", "avx512", "neon"};
+
+// Every length up to 70 covers each remainder of every vector width and
+// unroll, up to the 64 floats of four AVX-512 accumulators; then either side
+// of a power of two, and one whole tap tile of fir_filter_line.
+#define KERNEL_SHORT_LENGTHS 70
+static const int kernel_long_lengths[] = {127, 128, KERNEL_MAX_LENGTH};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+// -----------------------------------------------------------------------------
+// Checks every kernel family at every instruction set this CPU supports
+// against the scalar kernel of the family, at every length, and writes the
+// worst error of each as a CSV row.
+//
+// Arguments:
+//     results  - file the CSV rows are written to
+//     failures - incremented for every family and instruction set that fails
+//
+// Returns:
+//     true unless the inputs could not be allocated
+// -----------------------------------------------------------------------------
+bool run_kernel_tests(FILE* results, int* failures)
+{
+    kernel_buffers_t buffers;
+    if (!allocate_buffers(&buffers))
+    {
+        free_buffers(&buffers);
+        return false;
+    }
+
+    fprintf(results, "kernel,level,worst_length,measured,limit,result\n");
+
+    for (int level = SIMD_SCALAR; level <= SIMD_NEON; ++level)
+    {
+        if (!cpu_supports((enum simd_level)level))
+        {
+            fprintf(stderr,
+                    "%s: not supported on this CPU, skipped\n",
+                    level_names[level]);
+            continue;
+        }
+
+        for (size_t i = 0; i < COUNT(kernel_checks); ++i)
+        {
+            const kernel_check_t* check = &kernel_checks[i];
+            const size_t length_count =
+                KERNEL_SHORT_LENGTHS + COUNT(kernel_long_lengths);
+
+            double worst = 0.0;
+            int worst_length = 1;
+            for (size_t n = 0; n < length_count; ++n)
+            {
+                const int length =
+                    n < KERNEL_SHORT_LENGTHS
+                        ? (int)n + 1
+                        : kernel_long_lengths[n - KERNEL_SHORT_LENGTHS];
+                const double error =
+                    check->check((enum simd_level)level, &buffers, length);
+
+                // NaN is always the worst
+                if (!(error <= worst))
+                {
+                    worst = error;
+                    worst_length = length;
+                }
+            }
+
+            const bool pass = worst <= check->limit;
+            if (!pass)
+                ++*failures;
+
+            fprintf(results,
+                    "%s,%s,%d,%.3e,%.3e,%s\n",
+                    check->name,
+                    level_names[level],
+                    worst_length,
+                    worst,
+                    check->limit,
+                    pass ? "pass" : "fail");
+            fflush(results);
+        }
+    }
+
+    free_buffers(&buffers);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Checks the plain float kernel against dot_product_scalar.
+//
+// Returns:
+//     error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_plain(enum simd_level level,
+                   kernel_buffers_t* buffers,
+                   int length)
+{
+    const float actual = fir_dot_product_kernel(level)(
+        buffers->coeffs, buffers->samples, length);
+    const float expected =
+        dot_product_scalar(buffers->coeffs, buffers->samples, length);
+
+    return fabs((double)actual - expected) /
+           (FLT_EPSILON *
+            absolute_sum(buffers->coeffs, buffers->samples, length));
+}
+
+// -----------------------------------------------------------------------------
+// Checks the folded float kernel against dot_product_scalar, with coefficients
+// made symmetric.
+//
+// Returns:
+//     error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_folded(enum simd_level level,
+                    kernel_buffers_t* buffers,
+                    int length)
+{
+    float* symmetric = buffers->symmetric;
+    for (int j = 0; j < length; ++j)
+        symmetric[j] = buffers->coeffs[j < length - 1 - j ? j : length - 1 - j];
+
+    const float actual = fir_folded_dot_product_kernel(level)(
+        symmetric, buffers->samples, length);
+    const float expected =
+        dot_product_scalar(symmetric, buffers->samples, length);
+
+    return fabs((double)actual - expected) /
+           (FLT_EPSILON * absolute_sum(symmetric, buffers->samples, length));
+}
+
+// -----------------------------------------------------------------------------
+// Checks the block kernel, through fir_filter_line, against dot_product_scalar
+// for each output.
+//
+// Returns:
+//     worst error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_block(enum simd_level level,
+                   kernel_buffers_t* buffers,
+                   int length)
+{
+    return check_block_line(level, buffers->coeffs, length, false, buffers);
+}
+
+// -----------------------------------------------------------------------------
+// Checks the folded block kernel, through fir_filter_line, against
+// dot_product_scalar for each output, with coefficients made symmetric.
+//
+// Returns:
+//     worst error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_block_folded(enum simd_level level,
+                          kernel_buffers_t* buffers,
+                          int length)
+{
+    float* symmetric = buffers->symmetric;
+    for (int j = 0; j < length; ++j)
+        symmetric[j] = buffers->coeffs[j < length - 1 - j ? j : length - 1 - j];
+
+    return check_block_line(level, symmetric, length, true, buffers);
+}
+
+// -----------------------------------------------------------------------------
+// Checks the Q15 kernel against the scalar one. Coefficients are kept small
+// enough that no sum can overflow, as fixed_fir_t keeps them.
+//
+// Returns:
+//     absolute difference of the sums
+// -----------------------------------------------------------------------------
+double check_q15(enum simd_level level, kernel_buffers_t* buffers, int length)
+{
+    const int32_t limit = 65535 / length < 32767 ? 65535 / length : 32767;
+
+    uint32_t seed = (uint32_t)length;
+    for (int j = 0; j < length; ++j)
+        buffers->coeffs_q15[j] = (int16_t)(random_float(&seed) * limit);
+
+    const int32_t actual = fir_dot_product_q15_kernel(level)(
+        buffers->coeffs_q15, buffers->samples_q15, length);
+    const int32_t expected = fir_dot_product_q15_kernel(SIMD_SCALAR)(
+        buffers->coeffs_q15, buffers->samples_q15, length);
+
+    return fabs((double)actual - expected);
+}
+
+// -----------------------------------------------------------------------------
+// Checks the Q31 kernel against the scalar one, with 24 bit samples as the
+// fixed point path gives it and coefficients small enough that no sum can
+// overflow.
+//
+// Returns:
+//     absolute difference of the sums
+// -----------------------------------------------------------------------------
+double check_q31(enum simd_level level, kernel_buffers_t* buffers, int length)
+{
+    const int64_t bound = ((int64_t)1 << 39) / length;
+    const double limit = (double)(bound < INT32_MAX ? bound : INT32_MAX);
+
+    uint32_t seed = (uint32_t)length;
+    for (int j = 0; j < length; ++j)
+        buffers->coeffs_q31[j] = (int32_t)(random_float(&seed) * limit);
+
+    const int64_t actual = fir_dot_product_q31_kernel(level)(
+        buffers->coeffs_q31, buffers->samples_q31, length);
+    const int64_t expected = fir_dot_product_q31_kernel(SIMD_SCALAR)(
+        buffers->coeffs_q31, buffers->samples_q31, length);
+
+    return actual == expected ? 0.0 : fabs((double)(actual - expected));
+}
+
+// -----------------------------------------------------------------------------
+// Checks the kernel that sums float products in double against the scalar
+// one.
+//
+// Returns:
+//     error in double ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_wide(enum simd_level level, kernel_buffers_t* buffers, int length)
+{
+    const double actual = fir_dot_product_wide_kernel(level)(
+        buffers->coeffs, buffers->samples, length);
+    const double expected = fir_dot_product_wide_kernel(SIMD_SCALAR)(
+        buffers->coeffs, buffers->samples, length);
+
+    return fabs(actual - expected) /
+           (DBL_EPSILON *
+            absolute_sum(buffers->coeffs, buffers->samples, length));
+}
+
+// -----------------------------------------------------------------------------
+// Checks the Kahan compensated float kernel against the scalar one.
+//
+// Returns:
+//     error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_compensated(enum simd_level level,
+                         kernel_buffers_t* buffers,
+                         int length)
+{
+    const float actual = fir_dot_product_compensated_kernel(level)(
+        buffers->coeffs, buffers->samples, length);
+    const float expected = fir_dot_product_compensated_kernel(SIMD_SCALAR)(
+        buffers->coeffs, buffers->samples, length);
+
+    return fabs((double)actual - expected) /
+           (FLT_EPSILON *
+            absolute_sum(buffers->coeffs, buffers->samples, length));
+}
+
+// -----------------------------------------------------------------------------
+// Checks the double kernel against the scalar one.
+//
+// Returns:
+//     error in double ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_double(enum simd_level level,
+                    kernel_buffers_t* buffers,
+                    int length)
+{
+    const double* coeffs = buffers->coeffs_double;
+    const double* samples = buffers->samples_double;
+
+    const double actual =
+        fir_dot_product_double_kernel(level)(coeffs, samples, length);
+    const double expected =
+        fir_dot_product_double_kernel(SIMD_SCALAR)(coeffs, samples, length);
+
+    double magnitude = 0.0;
+    for (int j = 0; j < length; ++j)
+        magnitude += fabs(coeffs[j] * samples[j]);
+
+    return fabs(actual - expected) / (DBL_EPSILON * magnitude);
+}
+
+// -----------------------------------------------------------------------------
+// Filters KERNEL_BLOCK_OUTPUTS outputs with fir_filter_line, with or without
+// the folded block kernel, and compares each with dot_product_scalar over the
+// same window.
+//
+// Arguments:
+//     level   - instruction set of the kernels
+//     coeffs  - coefficients, symmetric if folded
+//     length  - number of coefficients
+//     folded  - whether to use the folded block kernel
+//     buffers - samples and outputs
+//
+// Returns:
+//     worst error in ULPs of the sum of the absolute products
+// -----------------------------------------------------------------------------
+double check_block_line(enum simd_level level,
+                        const float* coeffs,
+                        int length,
+                        bool folded,
+                        kernel_buffers_t* buffers)
+{
+    // each output's window starts one sample before the last's
+    const float* history = buffers->samples + KERNEL_BLOCK_OUTPUTS - 1;
+
+    fir_filter_line(fir_block_dot_product_kernel(level),
+                    folded ? fir_block_folded_dot_product_kernel(level) : NULL,
+                    coeffs,
+                    length,
+                    history,
+                    buffers->outputs,
+                    KERNEL_BLOCK_OUTPUTS);
+
+    double worst = 0.0;
+    for (int k = 0; k < KERNEL_BLOCK_OUTPUTS; ++k)
+    {
+        const float expected = dot_product_scalar(coeffs, history - k, length);
+        const double error =
+            fabs((double)buffers->outputs[k] - expected) /
+            (FLT_EPSILON * absolute_sum(coeffs, history - k, length));
+
+        if (!(error <= worst))
+            worst = error;
+    }
+
+    return worst;
+}
+
+// -----------------------------------------------------------------------------
+// Sums the absolute products of coefficients and samples in double, the scale
+// of the rounding any order of summing them can make.
+// -----------------------------------------------------------------------------
+double absolute_sum(const float* coeffs, const float* samples, int length)
+{
+    double sum = 0.0;
+    for (int j = 0; j < length; ++j)
+        sum += fabs((double)coeffs[j] * samples[j]);
+
+    return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Draws a uniform value from -1 up to 1 from a linear congruential generator,
+// so that every run checks the same inputs.
+// -----------------------------------------------------------------------------
+float random_float(uint32_t* seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+
+    return (float)((double)(*seed >> 8) / (1 << 23) - 1.0);
+}
+
+// -----------------------------------------------------------------------------
+// Allocates the inputs and fills them. Samples are long enough for the window
+// of every block output.
+//
+// Returns:
+//     true on success; on failure, free_buffers frees what was allocated
+// -----------------------------------------------------------------------------
+bool allocate_buffers(kernel_buffers_t* buffers)
+{
+    const size_t samples = KERNEL_MAX_LENGTH + KERNEL_BLOCK_OUTPUTS;
+
+    buffers->coeffs = (float*)malloc(KERNEL_MAX_LENGTH * sizeof(float));
+    buffers->symmetric = (float*)malloc(KERNEL_MAX_LENGTH * sizeof(float));
+    buffers->samples = (float*)malloc(samples * sizeof(float));
+    buffers->outputs = (float*)malloc(KERNEL_BLOCK_OUTPUTS * sizeof(float));
+    buffers->coeffs_double =
+        (double*)malloc(KERNEL_MAX_LENGTH * sizeof(double));
+    buffers->samples_double = (double*)malloc(samples * sizeof(double));
+    buffers->coeffs_q15 =
+        (int16_t*)malloc(KERNEL_MAX_LENGTH * sizeof(int16_t));
+    buffers->samples_q15 = (int16_t*)malloc(samples * sizeof(int16_t));
+    buffers->coeffs_q31 =
+        (int32_t*)malloc(KERNEL_MAX_LENGTH * sizeof(int32_t));
+    buffers->samples_q31 = (int32_t*)malloc(samples * sizeof(int32_t));
+
+    if (!buffers->coeffs || !buffers->symmetric || !buffers->samples ||
+        !buffers->outputs || !buffers->coeffs_double ||
+        !buffers->samples_double || !buffers->coeffs_q15 ||
+        !buffers->samples_q15 || !buffers->coeffs_q31 ||
+        !buffers->samples_q31)
+        return false;
+
+    uint32_t seed = 1;
+    for (size_t j = 0; j < KERNEL_MAX_LENGTH; ++j)
+    {
+        buffers->coeffs[j] = random_float(&seed);
+        buffers->coeffs_double[j] =
+            random_float(&seed) + random_float(&seed) / 16777216.0;
+    }
+
+    for (size_t i = 0; i < samples; ++i)
+    {
+        buffers->samples[i] = random_float(&seed);
+        buffers->samples_double[i] =
+            random_float(&seed) + random_float(&seed) / 16777216.0;
+        buffers->samples_q15[i] = (int16_t)(random_float(&seed) * 32767.0f);
+        buffers->samples_q31[i] = (int32_t)(random_float(&seed) * 8388607.0f);
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Frees the inputs.
+// -----------------------------------------------------------------------------
+void free_buffers(kernel_buffers_t* buffers)
+{
+    free(buffers->coeffs);
+    free(buffers->symmetric);
+    free(buffers->samples);
+    free(buffers->outputs);
+    free(buffers->coeffs_double);
+    free(buffers->samples_double);
+    free(buffers->coeffs_q15);
+    free(buffers->samples_q15);
+    free(buffers->coeffs_q31);
+    free(buffers->samples_q31);
+}
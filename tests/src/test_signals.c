@@ -0,0 +1,76 @@
+#include "test_signals.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// -----------------------------------------------------------------------------
+// Gets the name a signal is reported by.
+// -----------------------------------------------------------------------------
+const char* test_signal_name(enum test_signal kind)
+{
+    switch (kind)
+    {
+    case TEST_SWEEP: return "sweep";
+    case TEST_NOISE: return "noise";
+    case TEST_IMPULSE: return "impulse";
+    default: return "none";
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Generates TEST_SIGNAL_FRAMES interleaved frames of a test signal, peaking
+// near full scale. The sweep's frequency rises exponentially, so its phase is
+// the integral of that, and the noise comes from a fixed seed, so every run
+// tests the same signals.
+//
+// Arguments:
+//     kind        - signal to generate
+//     sample_rate - sample rate of the signal
+//     channels    - number of channels
+//
+// Returns:
+//     pointer to the signal, or NULL on failure
+// -----------------------------------------------------------------------------
+float* generate_test_signal(enum test_signal kind,
+                            float sample_rate,
+                            int channels)
+{
+    float* signal = (float*)malloc((size_t)TEST_SIGNAL_FRAMES * channels *
+                                   sizeof(float));
+    if (!signal)
+        return NULL;
+
+    const double start = 20.0;
+    const double stop = 0.45 * sample_rate;
+    const double rate = log(stop / start) * sample_rate / TEST_SIGNAL_FRAMES;
+
+    unsigned int seed = 1;
+    for (size_t i = 0; i < TEST_SIGNAL_FRAMES; ++i)
+    {
+        const double t = (double)i / sample_rate;
+
+        for (int c = 0; c < channels; ++c)
+        {
+            float sample = 0.0f;
+            switch (kind)
+            {
+            case TEST_SWEEP:
+                sample = (float)(0.9 * sin(2.0 * M_PI * start *
+                                           (exp(rate * t) - 1.0) / rate));
+                break;
+            case TEST_NOISE:
+                seed = seed * 1664525u + 1013904223u;
+                sample = (float)(1.8 * ((double)(seed >> 8) / (1 << 24) - 0.5));
+                break;
+            case TEST_IMPULSE:
+                sample = i % TEST_IMPULSE_SPACING == (size_t)c ? 1.0f : 0.0f;
+                break;
+            default: break;
+            }
+
+            signal[i * channels + c] = sample;
+        }
+    }
+
+    return signal;
+}
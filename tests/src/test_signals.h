@@ -0,0 +1,25 @@
+#pragma once
+
+// Length of each test signal, and the spacing of the impulses in the impulse
+// signal, wide enough for the longest filter tested to ring out.
+#define TEST_SIGNAL_FRAMES 16384
+#define TEST_IMPULSE_SPACING 4096
+
+// -----------------------------------------------------------------------------
+// Signals the tests filter: a logarithmic sweep from 20 Hz to near Nyquist,
+// white noise, and an impulse every TEST_IMPULSE_SPACING frames, one frame
+// later in each channel than the channel before.
+// -----------------------------------------------------------------------------
+enum test_signal
+{
+    TEST_SWEEP,
+    TEST_NOISE,
+    TEST_IMPULSE,
+    TEST_SIGNAL_COUNT,
+};
+
+const char* test_signal_name(enum test_signal kind);
+
+float* generate_test_signal(enum test_signal kind,
+                            float sample_rate,
+                            int channels);
@@ -0,0 +1,141 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "accuracy_tests.h"
+#include "file_tests.h"
+#include "kernel_tests.h"
+#include "low_pass_filter.h"
+
+enum errors
+{
+    NO_ERROR,
+    COMMAND_LINE_ARGS_ERROR,
+    OUTPUT_FILE_ERROR,
+    TEST_ERROR,
+    TEST_FAILED_ERROR,
+};
+
+// -----------------------------------------------------------------------------
+// A group of checks that writes its own CSV table: a header row, then a row per
+// check, incrementing failures for each that fails.
+// -----------------------------------------------------------------------------
+typedef struct test_suite
+{
+    const char* name;
+    bool (*run)(FILE* results, int* failures);
+} test_suite_t;
+
+static const test_suite_t suites[] = {
+    {"kernels", run_kernel_tests},
+    {"accuracy", run_accuracy_tests},
+    {"files", run_file_tests},
+};
+
+#define COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
+void print_usage(const char* prog_name);
+
+int main(int argc, const char** argv)
+{
+    if ((argc - 1) % 2)
+    {
+        eprintf("invalid arguments\n\n");
+        print_usage(argv[0]);
+        return COMMAND_LINE_ARGS_ERROR;
+    }
+
+    const char* output_file_name = NULL;
+    const char* only_suite = NULL;
+    for (int i = 1; i < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "-o"))
+        {
+            output_file_name = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], "-s"))
+        {
+            only_suite = argv[i + 1];
+
+            bool known = false;
+            for (size_t s = 0; s < COUNT(suites); ++s)
+                known = known || !strcmp(only_suite, suites[s].name);
+            if (!known)
+            {
+                eprintf("unknown suite %s.\n", only_suite);
+                return COMMAND_LINE_ARGS_ERROR;
+            }
+        }
+        else
+        {
+            eprintf("unknown command line option %s.\n", argv[i]);
+            print_usage(argv[0]);
+            return COMMAND_LINE_ARGS_ERROR;
+        }
+    }
+
+    FILE* results = output_file_name ? fopen(output_file_name, "w") : stdout;
+    if (!results)
+    {
+        eprintf("unable to open output file %s\n", output_file_name);
+        return OUTPUT_FILE_ERROR;
+    }
+
+    int failures = 0;
+    bool ok = true;
+    for (size_t s = 0; s < COUNT(suites) && ok; ++s)
+    {
+        if (only_suite && strcmp(only_suite, suites[s].name))
+            continue;
+
+        ok = suites[s].run(results, &failures);
+        if (!ok)
+            eprintf("%s: unable to run the suite\n", suites[s].name);
+        fprintf(results, "\n");
+    }
+
+    if (results != stdout)
+        fclose(results);
+
+    if (!ok)
+        return TEST_ERROR;
+
+    if (failures)
+    {
+        eprintf("%d checks failed\n", failures);
+        return TEST_FAILED_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+// -----------------------------------------------------------------------------
+// Prints usage instructions.
+// -----------------------------------------------------------------------------
+void print_usage(const char* prog_name)
+{
+    printf("usage: %s [-o <results_file>] [-s <suite>]\n\n", prog_name);
+    printf("Runs every test suite, or only [-s <suite>], and writes a CSV ");
+    printf("table per suite to\n<results_file>, or stdout. Each row states ");
+    printf("what it measured and the limit it\nmust stay within. Exits ");
+    printf("with %d if any check failed.\n\n", TEST_FAILED_ERROR);
+    printf("kernels checks every dot product kernel, at every instruction ");
+    printf("set the CPU\nsupports, against the scalar kernel at lengths 1 ");
+    printf("to 70, 127, 128 and 1024.\nThe error is in ULPs of the sum of ");
+    printf("the absolute products; the integer kernels\nmust match ");
+    printf("exactly.\n\n");
+    printf("accuracy checks every engine, and planar filtering at every ");
+    printf("instruction set,\nagainst the scalar direct form through ");
+    printf("lpf_process, on a sweep, noise and\nimpulses across orders, ");
+    printf("channel counts, sample rates and windows. Each must\nstay ");
+    printf("within a few float roundings of a sum as long as the filter at ");
+    printf("every\nsample and in its magnitude response, with unit gain at ");
+    printf("DC and half at the\ncutoff.\n\n");
+    printf("files writes the same signals to WAV files and filters them ");
+    printf("through\nlpf_filter_file on several threads, split by channel ");
+    printf("and in time, with a\npipeline 2 to 4 blocks deep, in fixed ");
+    printf("point on 16 and 24 bit PCM, and in each\nhigher precision ");
+    printf("arithmetic. Each output must stay within a limit, in LSBs,\nof ");
+    printf("the exact output of the taps the path filters with. The files ");
+    printf("are written\nto the working directory and removed afterwards.\n");
+}